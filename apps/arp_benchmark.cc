@@ -0,0 +1,112 @@
+#include "network_interface.hh"
+#include "router_test_harness.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_neighbours = 10 * 1000;
+constexpr size_t n_datagrams = 1000 * 1000;
+constexpr size_t n_ticks = 100 * 1000;
+
+constexpr uint32_t local_address = 0x0a000001;  // 10.0.0.1
+
+EthernetAddress neighbour_mac(const size_t i) { return {2, 0, 0, uint8_t(i >> 16), uint8_t(i >> 8), uint8_t(i)}; }
+
+// 10.0.0.0/8中的邻居，地址分散在几个子网里
+uint32_t neighbour_ip(const size_t i) { return 0x0a000000 | uint32_t(i % 64) << 16 | uint32_t(2 + i / 64); }
+
+int main() {
+    try {
+        const EthernetAddress local_mac{2, 0, 0, 0xff, 0xff, 0xff};
+        NetworkInterface interface{local_mac, Address::from_ipv4_numeric(local_address)};
+
+        vector<EthernetFrame> replies;
+        vector<Address> next_hops;
+        for (size_t i = 0; i < n_neighbours; i++) {
+            replies.push_back(arp_reply(neighbour_mac(i), neighbour_ip(i), local_mac, local_address));
+            next_hops.push_back(Address::from_ipv4_numeric(neighbour_ip(i)));
+        }
+
+        // 学习所有邻居的地址
+        const auto first_time = high_resolution_clock::now();
+        for (const auto &reply : replies) {
+            interface.recv_frame(reply);
+        }
+        const auto learned_time = high_resolution_clock::now();
+
+        // 发往随机的邻居
+        IPv4Datagram dgram;
+        dgram.header().src = local_address;
+        dgram.header().len = IPv4Header::LENGTH + 64;
+        dgram.payload() = Buffer(string(64, 'x'));
+
+        auto rd = get_random_generator();
+        vector<uint32_t> order(n_datagrams);
+        for (auto &index : order) {
+            index = rd() % n_neighbours;
+        }
+
+        size_t sent = 0;
+        const auto send_time = high_resolution_clock::now();
+        for (const uint32_t index : order) {
+            interface.send_datagram(dgram, next_hops[index]);
+            if (interface.frames_out().front().header().dst != neighbour_mac(index)) {
+                throw runtime_error("frame sent to the wrong Ethernet address");
+            }
+            interface.frames_out().pop();
+            sent++;
+        }
+        const auto sent_time = high_resolution_clock::now();
+
+        // 没有表项到期时的tick()
+        for (size_t i = 0; i < n_ticks; i++) {
+            interface.tick(0);
+        }
+        const auto ticked_time = high_resolution_clock::now();
+
+        // 发往还不知道地址的邻居：datagram等待ARP回复，收到回复后才发出
+        NetworkInterface resolver{local_mac, Address::from_ipv4_numeric(local_address)};
+        size_t resolved = 0;
+        const auto resolve_time = high_resolution_clock::now();
+        for (size_t i = 0; i < n_neighbours; i++) {
+            resolver.send_datagram(dgram, next_hops[i]);
+            resolver.send_datagram(dgram, next_hops[i]);
+            resolver.frames_out().pop();  // ARP请求
+            resolver.recv_frame(replies[i]);
+            while (not resolver.frames_out().empty()) {
+                resolver.frames_out().pop();
+                resolved++;
+            }
+        }
+        const auto final_time = high_resolution_clock::now();
+
+        if (sent != n_datagrams or resolved != 2 * n_neighbours) {
+            throw runtime_error("not every datagram was sent");
+        }
+
+        const auto learn_ns = duration_cast<nanoseconds>(learned_time - first_time).count();
+        const auto send_ns = duration_cast<nanoseconds>(sent_time - send_time).count();
+        const auto tick_ns = duration_cast<nanoseconds>(ticked_time - sent_time).count();
+        const auto resolve_ns = duration_cast<nanoseconds>(final_time - resolve_time).count();
+
+        cout << fixed << setprecision(1);
+        cout << n_neighbours << " neighbours: learn " << double(learn_ns) / double(n_neighbours)
+             << " ns/ARP reply, send_datagram " << double(send_ns) / double(n_datagrams) << " ns/datagram, tick "
+             << double(tick_ns) / double(n_ticks) << " ns/tick\n";
+        cout << n_neighbours << " unresolved neighbours: " << double(resolve_ns) / double(resolved)
+             << " ns/datagram (queued, then sent when the ARP reply arrives)\n";
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -34,8 +34,8 @@ void program_body() {
                 cerr << "Learned new address for X ( " << x.local_address().to_string() << " at "
                      << x_peer.value().to_string() << "\n";
             }
-            if (y_peer.has_value() and not rec.payload.empty()) {
-                y.sendto(y_peer.value(), rec.payload);
+            if (y_peer.has_value() and rec.payload.size() > 0) {
+                y.sendto(y_peer.value(), rec.payload.str());
             }
         });
 
@@ -46,8 +46,8 @@ void program_body() {
                 cerr << "Learned new address for Y ( " << y.local_address().to_string() << " at "
                      << y_peer.value().to_string() << "\n";
             }
-            if (x_peer.has_value() and not rec.payload.empty()) {
-                x.sendto(x_peer.value(), rec.payload);
+            if (x_peer.has_value() and rec.payload.size() > 0) {
+                x.sendto(x_peer.value(), rec.payload.str());
             }
         });
     }
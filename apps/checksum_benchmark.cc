@@ -0,0 +1,198 @@
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t total_bytes = 256 * 1024 * 1024;
+
+// 逐字节计算的参考实现（InternetChecksum原来的做法）
+uint16_t reference_checksum(const string_view data) {
+    uint32_t sum = 0;
+    bool parity = false;
+    for (size_t i = 0; i < data.size(); i++) {
+        uint16_t val = uint8_t(data[i]);
+        if (not parity) {
+            val <<= 8;
+        }
+        sum += val;
+        parity = !parity;
+    }
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return ~sum;
+}
+
+//! Checksum `total_bytes` in buffers of `size` bytes, starting at `offset` into the buffer
+//! \returns the throughput in GB/s
+template <typename ChecksumT>
+double measure(const size_t size, const size_t offset, const ChecksumT &checksum) {
+    string buffer(size + offset, '\0');
+    auto rd = get_random_generator();
+    for (auto &ch : buffer) {
+        ch = rd();
+    }
+    const string_view data{buffer.data() + offset, size};
+
+    const size_t iterations = total_bytes / size;
+    uint32_t sink = 0;
+
+    const auto first_time = high_resolution_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        sink += checksum(data);
+    }
+    const auto final_time = high_resolution_clock::now();
+
+    if (sink == 0x12345678) {
+        cerr << "(unlikely)\n";
+    }
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    return double(iterations * size) / double(duration);
+}
+
+// 时间戳计数器的周期数（其他架构上用纳秒代替）
+uint64_t cycles() {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//! Copy and checksum `total_bytes` in payloads of `size` bytes, as TCPSender does when it reads a segment's
+//! payload out of its ByteStream, either with memcpy() followed by add() or with copy_and_checksum()
+//! \returns the throughput in bytes per cycle
+double measure_copy(const size_t size, const bool fused) {
+    // 源数据比缓存大，和真实的发送缓冲区一样需要从内存中读取
+    string source(64 * 1024 * 1024, '\0');
+    auto rd = get_random_generator();
+    for (auto &ch : source) {
+        ch = rd();
+    }
+    string payload(size, '\0');
+
+    const size_t iterations = total_bytes / size;
+    const size_t n_payloads = source.size() / size;
+    uint32_t sink = 0;
+
+    const uint64_t first_cycle = cycles();
+    for (size_t i = 0; i < iterations; i++) {
+        const string_view data{source.data() + (i % n_payloads) * size, size};
+        InternetChecksum check;
+        if (fused) {
+            copy_and_checksum(payload.data(), data, check);
+        } else {
+            memcpy(payload.data(), data.data(), size);
+            check.add(payload);
+        }
+        sink += check.value();
+    }
+    const uint64_t final_cycle = cycles();
+
+    if (sink == 0x12345678) {
+        cerr << "(unlikely)\n";
+    }
+
+    return double(iterations * size) / double(final_cycle - first_cycle);
+}
+
+//! Verify the checksums of packets of `size` bytes in batches of MAX_CHECKSUM_BATCH, either one at a time
+//! with InternetChecksum (as IPv4Header::parse and TCPSegment::parse do) or with verify_checksums()
+//! \returns the throughput in millions of packets per second
+double measure_batch(const size_t size, const bool batched) {
+    // 1024个packet（最大约1.5MB），都带有正确的校验和
+    constexpr size_t n_packets = 1024;
+    auto rd = get_random_generator();
+    vector<string> packets(n_packets, string(size, '\0'));
+    vector<string_view> views;
+    for (auto &packet : packets) {
+        for (auto &ch : packet) {
+            ch = rd();
+        }
+        packet[0] = packet[1] = 0;
+        InternetChecksum check;
+        check.add(packet);
+        packet[0] = char(check.value() >> 8);
+        packet[1] = char(check.value() & 0xff);
+        views.emplace_back(packet);
+    }
+
+    const size_t iterations = total_bytes / size / n_packets;
+    size_t valid = 0;
+
+    const auto first_time = high_resolution_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        for (size_t first = 0; first < n_packets; first += MAX_CHECKSUM_BATCH) {
+            if (batched) {
+                valid += __builtin_popcountll(verify_checksums(&views[first], nullptr, MAX_CHECKSUM_BATCH));
+            } else {
+                for (size_t k = first; k < first + MAX_CHECKSUM_BATCH; k++) {
+                    InternetChecksum check;
+                    check.add(views[k]);
+                    valid += check.value() == 0;
+                }
+            }
+        }
+    }
+    const auto final_time = high_resolution_clock::now();
+
+    if (valid != iterations * n_packets) {
+        throw runtime_error("valid packets failed verification");
+    }
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    return double(iterations * n_packets) * 1000.0 / double(duration);
+}
+
+int main() {
+    try {
+        const auto word_at_a_time = [](const string_view data) {
+            InternetChecksum check;
+            check.add(data);
+            return check.value();
+        };
+
+        cout << fixed << setprecision(2);
+        for (const size_t size : {20, 64, 576, 1500, 65536}) {
+            for (const size_t offset : {0, 1}) {
+                const double before = measure(size, offset, reference_checksum);
+                const double after = measure(size, offset, word_at_a_time);
+                cout << setw(6) << size << " bytes at offset " << offset << ": byte loop " << setw(6) << before
+                     << " GB/s, InternetChecksum " << setw(6) << after << " GB/s (" << after / before << "x)\n";
+            }
+        }
+
+        for (const size_t size : {64, 536, 1452, 65536}) {
+            const double separate = measure_copy(size, false);
+            const double fused = measure_copy(size, true);
+            cout << setw(6) << size << " byte payloads: memcpy+add " << setw(6) << separate
+                 << " bytes/cycle, copy_and_checksum " << setw(6) << fused << " bytes/cycle (" << fused / separate
+                 << "x)\n";
+        }
+
+        for (const size_t size : {64, 512, 1500}) {
+            const double separate = measure_batch(size, false);
+            const double batched = measure_batch(size, true);
+            cout << setw(6) << size << " byte packets: one at a time " << setw(7) << separate
+                 << " Mpps, verify_checksums " << setw(7) << batched << " Mpps (" << batched / separate << "x)\n";
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
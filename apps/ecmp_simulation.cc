@@ -0,0 +1,137 @@
+#include "router_test_harness.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t n_trials = 20;
+constexpr size_t payload_size = 1000;
+constexpr size_t max_flow_packets = 2000;
+constexpr size_t round_size = 256;  // 两次route()之间到达的datagram数
+
+//! A router with an ingress interface (0) and `n_paths` links to routers that all lead to 192.168.0.0/16
+//! \param[in] ecmp whether the links are equal-cost routes, or only the first is used
+Router make_router(const size_t n_paths, const bool ecmp) {
+    Router router;
+
+    // 网卡和路由都会打印DEBUG信息，这里不需要
+    const QuietCerr quiet{};
+    add_interfaces(router, n_paths + 1);
+
+    router.add_route(0xc0a80000, 16, Address::from_ipv4_numeric(gateway_ip(1)), 1);
+    for (size_t i = 2; ecmp and i <= n_paths; i++) {
+        router.add_equal_cost_route(0xc0a80000, 16, Address::from_ipv4_numeric(gateway_ip(i)), i);
+    }
+    return router;
+}
+
+//! One datagram of each TCP connection, and how many datagrams the connection sends
+struct Connection {
+    InternetDatagram dgram;
+    size_t packets;
+};
+
+//! `n_connections` TCP connections from random clients in 10.0.0.0/16, with heavy-tailed sizes
+//! \param[in] one_server whether every connection goes to the same server (on port 443)
+vector<Connection> make_connections(const size_t n_connections, const bool one_server, mt19937 &rd) {
+    // 大小服从Pareto分布（alpha = 1.2）：大多数连接很短，少数"大象流"占了大部分流量
+    uniform_real_distribution<double> uniform{0, 1};
+    vector<Connection> connections;
+    for (size_t i = 0; i < n_connections; i++) {
+        const uint16_t sport = 1024 + rd() % 60000;
+        const uint16_t dport = one_server ? 443 : 1 + rd() % 1024;
+        string payload(payload_size, 'x');
+        payload[0] = char(sport >> 8);
+        payload[1] = char(sport & 0xff);
+        payload[2] = char(dport >> 8);
+        payload[3] = char(dport & 0xff);
+
+        InternetDatagram dgram;
+        dgram.header().src = 0x0a000000 | (rd() & 0xffff);
+        dgram.header().dst = one_server ? 0xc0a80050 : 0xc0a80000 | (rd() & 0xffff);
+        dgram.header().ttl = 64;
+        dgram.header().len = IPv4Header::LENGTH + payload_size;
+        dgram.payload() = Buffer(move(payload));
+
+        const double packets = ceil(1 / pow(1 - uniform(rd), 1 / 1.2));
+        connections.push_back({move(dgram), size_t(min(packets, double(max_flow_packets)))});
+    }
+    return connections;
+}
+
+//! Send every connection's datagrams through `router`, interleaved at random
+//! \returns the bytes sent on each of the router's links
+vector<size_t> simulate(Router &router, const size_t n_paths, const vector<Connection> &connections, mt19937 &rd) {
+    vector<size_t> sends;
+    for (size_t i = 0; i < connections.size(); i++) {
+        sends.insert(sends.end(), connections[i].packets, i);
+    }
+    shuffle(sends.begin(), sends.end(), rd);
+
+    vector<size_t> bytes(n_paths + 1, 0);
+    for (size_t first = 0; first < sends.size(); first += round_size) {
+        for (size_t i = first; i < min(first + round_size, sends.size()); i++) {
+            router.interface(0).datagrams_out().push(connections[sends[i]].dgram);
+        }
+        router.route();
+        for (size_t link = 1; link <= n_paths; link++) {
+            auto &frames = router.interface(link).frames_out();
+            while (not frames.empty()) {
+                bytes[link] += frames.front().serialize().size();
+                frames.pop();
+            }
+        }
+    }
+    return vector<size_t>(bytes.begin() + 1, bytes.end());
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        cout << "Load on the busiest of N equal-cost links, as a multiple of the average (1.00 is a perfect\n"
+             << "balance), over " << n_trials << " trials of TCP connections with Pareto-distributed sizes.\n\n";
+        cout << fixed << setprecision(2);
+        cout << "                                 busiest link / average\n";
+        cout << "traffic          connections     N=2     N=4     N=8    (one route, N=4)\n";
+
+        for (const bool one_server : {false, true}) {
+            for (const size_t n_connections : {size_t(16), size_t(128), size_t(1024), size_t(8192)}) {
+                cout << (one_server ? "to one server  " : "to many hosts  ") << setw(12) << n_connections;
+                for (const size_t n_paths : {size_t(2), size_t(4), size_t(8), size_t(0)}) {
+                    const bool ecmp = n_paths > 0;
+                    const size_t links = ecmp ? n_paths : 4;
+
+                    double imbalance = 0;
+                    for (size_t trial = 0; trial < n_trials; trial++) {
+                        Router router = make_router(links, ecmp);
+                        const vector<size_t> bytes =
+                            simulate(router, links, make_connections(n_connections, one_server, rd), rd);
+
+                        double total = 0;
+                        for (const size_t b : bytes) {
+                            total += b;
+                        }
+                        imbalance += *max_element(bytes.begin(), bytes.end()) / (total / links);
+                    }
+                    cout << (ecmp ? "  " : "      ") << setw(6) << imbalance / n_trials;
+                }
+                cout << "\n";
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
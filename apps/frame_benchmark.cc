@@ -0,0 +1,99 @@
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_segment.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_frames = 1000 * 1000;
+
+// 统计堆分配次数
+static size_t heap_allocations = 0;
+
+void *operator new(size_t size) {
+    heap_allocations++;
+    if (void *ret = malloc(size ? size : 1)) {
+        return ret;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+//! Copy `payload` into a slab with headroom (as TCPSender does), wrap it in a TCP segment, an IPv4 datagram
+//! and an Ethernet frame, and gather the frame into the iovecs that FileDescriptor::write would pass to
+//! writev(), `n_frames` times
+void build_frames(const string &payload) {
+    size_t bytes = 0;
+    size_t pieces = 0;
+    const size_t first_allocations = heap_allocations;
+    const auto first_time = high_resolution_clock::now();
+
+    for (size_t i = 0; i < n_frames; i++) {
+        TCPSegment seg;
+        seg.header().sport = 1024;
+        seg.header().dport = 80;
+        seg.header().seqno = WrappingInt32{uint32_t(i)};
+        seg.header().ack = true;
+        PacketPool::Slab slab = PacketPool::allocate();
+        payload.copy(slab.data() + PacketPool::HEADROOM, payload.size());
+        seg.payload() = Buffer(move(slab), payload.size(), PacketPool::HEADROOM);
+
+        IPv4Datagram dgram;
+        dgram.header().src = 0x0a000002;
+        dgram.header().dst = 0x0a000001;
+        dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + payload.size();
+        dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+
+        EthernetFrame frame;
+        frame.header().type = EthernetHeader::TYPE_IPv4;
+        frame.header().dst = {2, 0, 0, 0, 0, 1};
+        frame.header().src = {2, 0, 0, 0, 0, 2};
+        frame.payload() = dgram.serialize();
+
+        const BufferList serialized = frame.serialize();
+        const BufferViewList views{serialized};
+        const auto iovecs = views.as_iovecs();
+        pieces += iovecs.size();
+        for (size_t j = 0; j < iovecs.size(); j++) {
+            bytes += iovecs.data()[j].iov_len;
+        }
+    }
+
+    const auto final_time = high_resolution_clock::now();
+    const size_t allocations = heap_allocations - first_allocations;
+
+    if (bytes != n_frames * (EthernetHeader::LENGTH + IPv4Header::LENGTH + TCPHeader::LENGTH + payload.size())) {
+        throw runtime_error("frames came out the wrong size");
+    }
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+
+    cout << fixed << setprecision(1);
+    cout << "Ethernet/IPv4/TCP frame with " << setw(4) << payload.size()
+         << "-byte payload: " << double(duration) / double(n_frames) << " ns/frame, " << setprecision(2)
+         << double(allocations) / double(n_frames) << " allocations/frame, " << double(pieces) / double(n_frames)
+         << " buffers/frame\n";
+}
+
+int main() {
+    try {
+        for (const size_t payload_size : {0, 536, 1452}) {
+            build_frames(string(payload_size, 'x'));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -89,7 +89,7 @@ class NetworkInterfaceAdapter : public TCPOverIPv4Adapter {
 
     optional<TCPSegment> read() {
         EthernetFrame frame;
-        if (frame.parse(_data_socket_pair.first.read()) != ParseResult::NoError) {
+        if (frame.parse(_data_socket_pair.first.read_packet()) != ParseResult::NoError) {
             return {};
         }
 
@@ -111,6 +111,7 @@ class NetworkInterfaceAdapter : public TCPOverIPv4Adapter {
         send_pending();
     }
     void tick(const size_t ms_since_last_tick) {
+        TCPOverIPv4Adapter::tick(ms_since_last_tick);
         _interface.tick(ms_since_last_tick);
         send_pending();
     }
@@ -197,7 +198,7 @@ void program_body(bool is_client, const string &bounce_host, const string &bounc
             // Frames from host to router
             event_loop.add_rule(sock.adapter().frame_fd(), Direction::In, [&] {
                 EthernetFrame frame;
-                if (frame.parse(sock.adapter().frame_fd().read()) != ParseResult::NoError) {
+                if (frame.parse(sock.adapter().frame_fd().read_packet()) != ParseResult::NoError) {
                     return;
                 }
                 if (debug) {
@@ -236,7 +237,7 @@ void program_body(bool is_client, const string &bounce_host, const string &bounc
             // Frames from Internet to router
             event_loop.add_rule(internet_socket, Direction::In, [&] {
                 EthernetFrame frame;
-                if (frame.parse(internet_socket.read()) != ParseResult::NoError) {
+                if (frame.parse(internet_socket.read_packet()) != ParseResult::NoError) {
                     return;
                 }
                 if (debug) {
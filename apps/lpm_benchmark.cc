@@ -0,0 +1,138 @@
+#include "lpm_table.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_lookups = 10 * 1000 * 1000;
+constexpr size_t n_updates = 100 * 1000;
+
+// 线性扫描每次查找大约要检查这么多条规则（总共）
+constexpr size_t linear_work = 200 * 1000 * 1000;
+
+struct Prefix {
+    uint32_t prefix;
+    uint8_t length;
+};
+
+// Router原来的做法：逐条比较，保留最长的匹配
+optional<uint32_t> linear_lookup(const vector<Prefix> &prefixes, const uint32_t address) {
+    optional<uint32_t> matched;
+    for (uint32_t i = 0; i < prefixes.size(); i++) {
+        const uint8_t length = prefixes[i].length;
+        if (length == 0 or (prefixes[i].prefix >> (32 - length)) == (address >> (32 - length))) {
+            if (not matched or length > prefixes[*matched].length) {
+                matched = i;
+            }
+        }
+    }
+    return matched;
+}
+
+//! Random distinct prefixes whose lengths are distributed roughly like a full Internet routing table
+vector<Prefix> random_prefixes(const size_t count, mt19937 &rd) {
+    // 大约六成是/24，其余集中在/16到/23，很少比/24更长
+    discrete_distribution<int> length_dist{{
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 2, 5, 10, 10, 150,          // /0../16
+        20, 40, 100, 120, 250, 400, 480, 6000, 2, 2, 2, 2, 2, 2, 2, 2,  // /17../32
+    }};
+
+    vector<Prefix> prefixes;
+    unordered_set<uint64_t> seen;
+    while (prefixes.size() < count) {
+        const uint8_t length = length_dist(rd);
+        const uint32_t prefix = length == 0 ? 0 : uint32_t(rd()) & (~uint32_t(0) << (32 - length));
+        if (seen.insert(uint64_t(length) << 32 | prefix).second) {
+            prefixes.push_back({prefix, length});
+        }
+    }
+    return prefixes;
+}
+
+void measure(const size_t count, mt19937 &rd) {
+    const vector<Prefix> prefixes = random_prefixes(count, rd);
+
+    // 一半的地址落在某个前缀里，一半完全随机
+    vector<uint32_t> addresses(n_lookups);
+    for (size_t i = 0; i < n_lookups; i++) {
+        const Prefix &p = prefixes[rd() % count];
+        addresses[i] = i % 2 ? uint32_t(rd()) : p.prefix | (uint32_t(rd()) & ~(~uint64_t(0) << (32 - p.length)));
+    }
+
+    LPMTable table;
+    const auto build_time = high_resolution_clock::now();
+    for (uint32_t i = 0; i < count; i++) {
+        table.insert(prefixes[i].prefix, prefixes[i].length, i);
+    }
+    const auto built_time = high_resolution_clock::now();
+
+    uint64_t checksum = 0;
+    for (const uint32_t address : addresses) {
+        checksum += table.lookup(address).value_or(0);
+    }
+    const auto looked_up_time = high_resolution_clock::now();
+    if (checksum == 0) {
+        throw runtime_error("no address matched");
+    }
+
+    // 线性扫描太慢，只查一部分地址，并核对结果
+    const size_t n_linear = min(n_lookups, max<size_t>(100, linear_work / count));
+    const auto linear_time = high_resolution_clock::now();
+    for (size_t i = 0; i < n_linear; i++) {
+        const optional<uint32_t> linear = linear_lookup(prefixes, addresses[i]);
+        const optional<uint32_t> matched = table.lookup(addresses[i]);
+        if (linear.has_value() != matched.has_value() or
+            (linear and prefixes[*linear].length != prefixes[*matched].length)) {
+            throw runtime_error("LPMTable disagrees with the linear scan");
+        }
+    }
+    const auto linear_done_time = high_resolution_clock::now();
+
+    // 增量更新：删除一个前缀，再加回去
+    const auto update_time = high_resolution_clock::now();
+    for (size_t i = 0; i < n_updates; i++) {
+        const uint32_t index = rd() % count;
+        table.erase(prefixes[index].prefix, prefixes[index].length);
+        table.insert(prefixes[index].prefix, prefixes[index].length, index);
+    }
+    const auto updated_time = high_resolution_clock::now();
+
+    const double build_s = duration_cast<duration<double>>(built_time - build_time).count();
+    const double lookup_s = duration_cast<duration<double>>(looked_up_time - built_time).count();
+    const double linear_s = duration_cast<duration<double>>(linear_done_time - linear_time).count();
+    const double update_s = duration_cast<duration<double>>(updated_time - update_time).count();
+    const double lookup_rate = double(n_lookups) / lookup_s;
+    const double linear_rate = double(n_linear) / linear_s;
+
+    cout << fixed << setprecision(2);
+    cout << setw(7) << count << " prefixes: LPMTable " << setw(7) << lookup_rate / 1e6 << " M lookups/s, linear scan "
+         << setw(10) << setprecision(4) << linear_rate / 1e6 << " M lookups/s (" << setprecision(0)
+         << lookup_rate / linear_rate << "x); build " << setprecision(2) << build_s * 1e3 << " ms, "
+         << double(n_updates) / update_s / 1e6 << " M updates/s, " << double(table.memory_usage()) / (1 << 20)
+         << " MiB\n";
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        for (const size_t count : {size_t(1000), size_t(100 * 1000), size_t(900 * 1000)}) {
+            measure(count, rd);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_datagrams = 1000 * 1000;
+constexpr size_t n_distinct = 4096;
+
+//! Make datagrams that look like the ones in tests/ipv4_parser.data: TCP over IPv4, mostly small
+//! segments (some with TCP options, a few with IP options), plus full-sized ones
+vector<Buffer> make_datagrams() {
+    auto rd = get_random_generator();
+    const vector<size_t> payload_sizes{0, 0, 0, 1, 12, 100, 536, 1448};
+
+    vector<Buffer> ret;
+    ret.reserve(n_distinct);
+    for (size_t i = 0; i < n_distinct; i++) {
+        TCPSegment seg;
+        seg.header().sport = 1024 + rd() % 60000;
+        seg.header().dport = 443;
+        seg.header().seqno = WrappingInt32{uint32_t(rd())};
+        seg.header().ackno = WrappingInt32{uint32_t(rd())};
+        seg.header().ack = true;
+        seg.header().psh = i % 3 == 0;
+        seg.header().win = rd();
+        seg.header().doff = i % 2 ? 8 : 5;  // 12 bytes of options (e.g. timestamps)
+
+        string payload(payload_sizes[rd() % payload_sizes.size()], '\0');
+        for (auto &ch : payload) {
+            ch = rd();
+        }
+        seg.payload() = Buffer(move(payload));
+
+        IPv4Datagram dgram;
+        dgram.header().hlen = i % 16 ? 5 : 6;  // a few datagrams carry IP options
+        dgram.header().src = rd();
+        dgram.header().dst = rd();
+        dgram.header().id = rd();
+        dgram.header().df = true;
+        dgram.header().len = 4 * dgram.header().hlen + 4 * seg.header().doff + seg.payload().size();
+        dgram.payload() = seg.serialize(dgram.header().pseudo_cksum()).concatenate();
+
+        ret.emplace_back(dgram.serialize().concatenate());
+    }
+    return ret;
+}
+
+int main() {
+    try {
+        const vector<Buffer> datagrams = make_datagrams();
+
+        size_t payload_bytes = 0;
+        const auto first_time = high_resolution_clock::now();
+        for (size_t i = 0; i < n_datagrams; i++) {
+            IPv4Datagram dgram;
+            TCPSegment seg;
+            if (dgram.parse(datagrams[i % n_distinct]) != ParseResult::NoError or
+                seg.parse(dgram.payload(), dgram.header().pseudo_cksum()) != ParseResult::NoError) {
+                throw runtime_error("datagram failed to parse");
+            }
+            payload_bytes += seg.payload().size();
+        }
+        const auto parsed_time = high_resolution_clock::now();
+
+        size_t header_bytes = 0;
+        for (size_t i = 0; i < n_datagrams; i++) {
+            IPv4Header ip_header;
+            TCPHeader tcp_header;
+            NetParser p{datagrams[i % n_distinct]};
+            ip_header.parse(p);
+            tcp_header.parse(p);
+            header_bytes += ip_header.serialize().size() + tcp_header.serialize().size();
+        }
+        const auto final_time = high_resolution_clock::now();
+
+        if (payload_bytes == 0 or header_bytes == 0) {
+            throw runtime_error("nothing was parsed");
+        }
+
+        const auto parse_ns = duration_cast<nanoseconds>(parsed_time - first_time).count();
+        const auto header_ns = duration_cast<nanoseconds>(final_time - parsed_time).count();
+
+        cout << fixed << setprecision(1);
+        cout << n_datagrams << " datagrams, IPv4Datagram + TCPSegment parse (with checksums): "
+             << double(parse_ns) / double(n_datagrams) << " ns/datagram\n";
+        cout << n_datagrams << " datagrams, IPv4Header + TCPHeader parse and serialize:        "
+             << double(header_ns) / double(n_datagrams) << " ns/datagram\n";
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+#include "ip_reassembler.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t total_bytes = 64 * 1024 * 1024;  // 每种大小的datagram合计的字节数
+constexpr size_t n_passes = 10;
+constexpr size_t mtu = 1500;
+
+//! How the fragments arrive
+enum class Order { InOrder, Reversed, Shuffled, Interleaved };
+
+//! The fragments of `count` datagrams of `size` bytes, parsed as if they had just arrived, in `order`
+vector<InternetDatagram> make_fragments(const size_t count, const size_t size, const Order order, mt19937 &rd) {
+    vector<InternetDatagram> fragments;
+    for (size_t i = 0; i < count; i++) {
+        InternetDatagram dgram;
+        dgram.header().src = 0x0a000001;
+        dgram.header().dst = 0x0a000002;
+        dgram.header().id = i;
+        dgram.header().df = false;
+        dgram.header().len = size;
+        dgram.payload() = Buffer(string(size - IPv4Header::LENGTH, 'x'));
+
+        vector<InternetDatagram> pieces;
+        for (const auto &fragment : dgram.fragment(mtu)) {
+            InternetDatagram parsed;
+            if (parsed.parse(Buffer(fragment.serialize().concatenate())) != ParseResult::NoError) {
+                throw runtime_error("fragment didn't parse");
+            }
+            pieces.push_back(move(parsed));
+        }
+        if (order == Order::Reversed) {
+            reverse(pieces.begin(), pieces.end());
+        } else if (order != Order::InOrder) {
+            shuffle(pieces.begin(), pieces.end(), rd);
+        }
+        fragments.insert(fragments.end(), pieces.begin(), pieces.end());
+    }
+
+    // 32个datagram的分片互相交错到达（65000字节的datagram这样已经占用了默认内存上限的一半）
+    if (order == Order::Interleaved) {
+        const size_t window = 32 * ((size + mtu - 1) / mtu);
+        for (size_t first = 0; first < fragments.size(); first += window) {
+            shuffle(fragments.begin() + first, fragments.begin() + min(first + window, fragments.size()), rd);
+        }
+    }
+    return fragments;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        cout << fixed << setprecision(2);
+        cout << "datagram  order         fragments/s   payload Gbit/s   peak memory\n";
+        for (const size_t size : {size_t(4000), size_t(9000), size_t(65000)}) {
+            for (const Order order : {Order::InOrder, Order::Reversed, Order::Shuffled, Order::Interleaved}) {
+                const size_t n_datagrams = total_bytes / size;
+                const vector<InternetDatagram> fragments = make_fragments(n_datagrams, size, order, rd);
+
+                IPv4Reassembler reassembler;
+                size_t reassembled = 0, peak_memory = 0;
+                const auto start_time = high_resolution_clock::now();
+                for (size_t pass = 0; pass < n_passes; pass++) {
+                    for (const auto &fragment : fragments) {
+                        reassembled += reassembler.push(fragment).has_value();
+                        peak_memory = max(peak_memory, reassembler.memory_usage());
+                    }
+                }
+                const auto end_time = high_resolution_clock::now();
+
+                if (reassembled != n_passes * n_datagrams) {
+                    throw runtime_error("not every datagram was reassembled");
+                }
+                const double seconds = duration_cast<duration<double>>(end_time - start_time).count();
+                const double payload_bits = 8.0 * (size - IPv4Header::LENGTH) * reassembled;
+                const char *names[] = {"in order", "reversed", "shuffled", "interleaved"};
+                cout << setw(8) << size << "  " << left << setw(12) << names[int(order)] << right << setw(12)
+                     << n_passes * fragments.size() / seconds / 1e6 << " M" << setw(17) << payload_bits / seconds / 1e9
+                     << setw(11) << peak_memory / 1024 << " KiB\n";
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
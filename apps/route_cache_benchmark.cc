@@ -0,0 +1,140 @@
+#include "router_test_harness.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_interfaces = 4;
+constexpr size_t n_prefixes = 100 * 1000;
+constexpr size_t n_destinations = 100 * 1000;
+constexpr size_t n_datagrams = 2 * 1000 * 1000;
+constexpr size_t burst = 64;
+
+//! A router whose interfaces each have a gateway (with a known Ethernet address), and random routes through them
+Router make_router(const vector<pair<uint32_t, uint8_t>> &prefixes, const size_t cache_slots) {
+    RouterConfig config;
+    config.route_cache_slots = cache_slots;
+    Router router{config};
+
+    // 网卡和路由都会打印DEBUG信息，这里不需要
+    const QuietCerr quiet{};
+    add_interfaces(router, n_interfaces);
+
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        const size_t interface_num = i % n_interfaces;
+        router.add_route(
+            prefixes[i].first, prefixes[i].second, Address::from_ipv4_numeric(gateway_ip(interface_num)), interface_num);
+    }
+    return router;
+}
+
+//! Destinations drawn from `destinations` with a Zipf distribution of exponent `s` (rank 1 is the most popular)
+vector<uint32_t> zipf_mix(const vector<uint32_t> &destinations, const double s, mt19937 &rd) {
+    vector<double> cdf(destinations.size());
+    double total = 0;
+    for (size_t rank = 0; rank < destinations.size(); rank++) {
+        total += 1.0 / pow(double(rank + 1), s);
+        cdf[rank] = total;
+    }
+
+    uniform_real_distribution<double> uniform{0, total};
+    vector<uint32_t> mix(n_datagrams);
+    for (auto &dst : mix) {
+        dst = destinations[lower_bound(cdf.begin(), cdf.end(), uniform(rd)) - cdf.begin()];
+    }
+    return mix;
+}
+
+//! Route each of `datagrams` (all arriving on interface 0), in bursts
+//! \returns datagrams per second
+double measure(Router &router, const vector<InternetDatagram> &datagrams) {
+    size_t sent = 0;
+    const auto start_time = high_resolution_clock::now();
+    for (size_t first = 0; first < datagrams.size(); first += burst) {
+        auto &queue = router.interface(0).datagrams_out();
+        for (size_t i = first; i < min(first + burst, datagrams.size()); i++) {
+            queue.push(datagrams[i]);
+        }
+        router.route();
+        for (size_t i = 0; i < n_interfaces; i++) {
+            auto &frames = router.interface(i).frames_out();
+            sent += frames.size();
+            while (not frames.empty()) {
+                frames.pop();
+            }
+        }
+    }
+    const auto end_time = high_resolution_clock::now();
+
+    if (sent != datagrams.size()) {
+        throw runtime_error("not every datagram was sent");
+    }
+    return double(datagrams.size()) / duration_cast<duration<double>>(end_time - start_time).count();
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // 随机的/16到/24前缀，外加一条默认路由，保证每个目的地址都有路由
+        vector<pair<uint32_t, uint8_t>> prefixes{{0, 0}};
+        while (prefixes.size() < n_prefixes) {
+            const uint8_t length = 16 + rd() % 9;
+            prefixes.emplace_back(uint32_t(rd()) & (~uint32_t(0) << (32 - length)), length);
+        }
+        vector<uint32_t> destinations(n_destinations);
+        for (auto &dst : destinations) {
+            dst = rd();
+        }
+
+        cout << fixed << setprecision(2);
+        for (const double s : {0.8, 1.0, 1.2}) {
+            // 收到的datagram：和从网络上parse出来的一样
+            vector<InternetDatagram> datagrams;
+            for (const uint32_t dst : zipf_mix(destinations, s, rd)) {
+                InternetDatagram dgram;
+                dgram.header().src = 0x0a000063;
+                dgram.header().dst = dst;
+                dgram.header().ttl = 64;
+                dgram.header().len = IPv4Header::LENGTH + 64;
+                dgram.payload() = Buffer(string(64, 'x'));
+                InternetDatagram parsed;
+                if (parsed.parse(Buffer(dgram.serialize().concatenate())) != ParseResult::NoError) {
+                    throw runtime_error("datagram didn't parse");
+                }
+                datagrams.push_back(move(parsed));
+            }
+
+            for (const size_t slots : {size_t(0), size_t(1024), size_t(16384)}) {
+                Router router = make_router(prefixes, slots);
+                const double rate = measure(router, datagrams);
+                const auto &counters = router.counters();
+                const uint64_t lookups = counters.route_cache_hits + counters.route_cache_misses;
+
+                cout << "Zipf s=" << s << ", " << setw(5) << slots << " cache slots: " << setw(6) << rate / 1e6
+                     << " M datagrams/s";
+                if (lookups > 0) {
+                    cout << ", hit rate " << setw(5) << 100.0 * double(counters.route_cache_hits) / double(lookups)
+                         << "%";
+                }
+                cout << "\n";
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
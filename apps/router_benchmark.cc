@@ -0,0 +1,172 @@
+#include "router_test_harness.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_hosts = 256;  // 每个直连子网里的主机数
+constexpr size_t n_extra_routes = 100 * 1000;
+constexpr size_t n_datagrams = 2 * 1000 * 1000;
+constexpr size_t round_size = 256;  // 两次route()之间到达的datagram数
+
+//! One of the router's interfaces: its address, and the neighbours it has learned
+struct Link {
+    uint32_t local;
+    vector<uint32_t> neighbours;
+};
+
+uint32_t ip(const string &str) { return Address(str).ipv4_numeric(); }
+
+//! The neighbours of each interface in the network_simulator topology, with `n_hosts` on each LAN
+vector<Link> topology() {
+    vector<Link> links{
+        {ip("171.67.76.46"), {ip("171.67.76.1")}},  // default: default_router
+        {ip("10.0.0.1"), {}},                       // eth0
+        {ip("172.16.0.1"), {}},                     // eth1
+        {ip("192.168.0.1"), {}},                    // eth2
+        {ip("198.178.229.1"), {}},                  // uun3
+        {ip("143.195.0.2"), {ip("143.195.0.1")}},   // hs4: hs_router
+        {ip("128.30.76.255"), {ip("128.30.0.1")}},  // mit5
+    };
+    for (const size_t lan : {1, 2, 3, 4}) {
+        for (uint32_t host = 2; host < 2 + n_hosts; host++) {
+            links[lan].neighbours.push_back((links[lan].local & 0xffffff00) | host);
+        }
+    }
+    return links;
+}
+
+//! Is `dst` on one of the directly attached LANs?
+bool on_lan(const uint32_t dst) {
+    return dst >> 24 == 10 or dst >> 16 == 0xac10 or dst >> 8 == 0xc0a800 or dst >> 8 == 0xc6b2e5;
+}
+
+EthernetAddress mac(const size_t link, const size_t host) {
+    return {2, 0, uint8_t(link), 0, uint8_t(host >> 8), uint8_t(host)};
+}
+
+Router make_router(const vector<Link> &links, const RouterConfig &config, mt19937 &rd) {
+    Router router{config};
+
+    // 网卡和路由都会打印DEBUG信息，这里不需要
+    const QuietCerr quiet{};
+    for (size_t i = 0; i < links.size(); i++) {
+        router.add_interface(AsyncNetworkInterface{mac(i, 0xffff), Address::from_ipv4_numeric(links[i].local)});
+
+        // 事先学好所有邻居的MAC地址
+        for (size_t j = 0; j < links[i].neighbours.size(); j++) {
+            router.interface(i).recv_frame(
+                arp_reply(mac(i, j), links[i].neighbours[j], mac(i, 0xffff), links[i].local));
+        }
+    }
+
+    // network_simulator的路由表
+    router.add_route(ip("0.0.0.0"), 0, Address("171.67.76.1"), 0);
+    router.add_route(ip("10.0.0.0"), 8, {}, 1);
+    router.add_route(ip("172.16.0.0"), 16, {}, 2);
+    router.add_route(ip("192.168.0.0"), 24, {}, 3);
+    router.add_route(ip("198.178.229.0"), 24, {}, 4);
+    router.add_route(ip("143.195.0.0"), 17, Address("143.195.0.1"), 5);
+    router.add_route(ip("143.195.128.0"), 18, Address("143.195.0.1"), 5);
+    router.add_route(ip("143.195.192.0"), 19, Address("143.195.0.1"), 5);
+    router.add_route(ip("128.30.76.255"), 16, Address("128.30.0.1"), 6);
+
+    // 再加上经过三个网关的随机路由
+    const size_t gateways[] = {0, 5, 6};
+    for (size_t i = 0; i < n_extra_routes; i++) {
+        const size_t link = gateways[i % 3];
+        const uint8_t length = 16 + rd() % 9;
+        const uint32_t prefix = 0x20000000 | (uint32_t(rd()) & 0x7fffffff & (~uint32_t(0) << (32 - length)));
+        router.add_route(prefix, length, Address::from_ipv4_numeric(links[link].neighbours[0]), link);
+    }
+    return router;
+}
+
+//! Route every datagram (each arriving on the interface paired with it), `round_size` at a time
+//! \returns datagrams per second
+double measure(Router &router, const vector<pair<size_t, InternetDatagram>> &datagrams, const size_t n_links) {
+    size_t sent = 0;
+    const auto start_time = high_resolution_clock::now();
+    for (size_t first = 0; first < datagrams.size(); first += round_size) {
+        for (size_t i = first; i < min(first + round_size, datagrams.size()); i++) {
+            router.interface(datagrams[i].first).datagrams_out().push(datagrams[i].second);
+        }
+        router.route();
+        for (size_t i = 0; i < n_links; i++) {
+            auto &frames = router.interface(i).frames_out();
+            sent += frames.size();
+            while (not frames.empty()) {
+                frames.pop();
+            }
+        }
+    }
+    const auto end_time = high_resolution_clock::now();
+
+    if (sent != datagrams.size()) {
+        throw runtime_error("not every datagram was sent");
+    }
+    return double(datagrams.size()) / duration_cast<duration<double>>(end_time - start_time).count();
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        const vector<Link> links = topology();
+
+        // 从随机的网卡进来，一半发往各个子网里已知的主机，一半发往外部（经过网关）
+        vector<pair<size_t, InternetDatagram>> datagrams;
+        for (size_t i = 0; i < n_datagrams; i++) {
+            uint32_t dst = rd();
+            while (on_lan(dst)) {
+                dst = rd();
+            }
+            if (i % 2) {
+                const Link &lan = links[1 + rd() % 4];
+                dst = lan.neighbours[rd() % lan.neighbours.size()];
+            }
+
+            InternetDatagram dgram;
+            dgram.header().src = 0x0a000063;
+            dgram.header().dst = dst;
+            dgram.header().ttl = 64;
+            dgram.header().len = IPv4Header::LENGTH + 64;
+            dgram.payload() = Buffer(string(64, 'x'));
+            InternetDatagram parsed;
+            if (parsed.parse(Buffer(dgram.serialize().concatenate())) != ParseResult::NoError) {
+                throw runtime_error("datagram didn't parse");
+            }
+            datagrams.emplace_back(rd() % links.size(), move(parsed));
+        }
+
+        cout << fixed << setprecision(2);
+        double scalar_rate = 0;
+        for (const size_t burst_size : {size_t(0), size_t(8), size_t(32), size_t(64)}) {
+            RouterConfig config;
+            config.burst_size = burst_size;
+            Router router = make_router(links, config, rd);
+            const double rate = measure(router, datagrams, links.size());
+            if (burst_size == 0) {
+                scalar_rate = rate;
+                cout << "one at a time:  " << setw(6) << rate / 1e6 << " M datagrams/s\n";
+            } else {
+                cout << "bursts of " << setw(4) << burst_size << ": " << setw(6) << rate / 1e6 << " M datagrams/s ("
+                     << rate / scalar_rate << "x)\n";
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
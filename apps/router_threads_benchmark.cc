@@ -0,0 +1,114 @@
+#include "router_test_harness.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_interfaces = 16;
+constexpr size_t n_routes = 100 * 1000;
+constexpr size_t n_datagrams = 2 * 1000 * 1000;
+constexpr size_t round_size = 4096;  // 两次route()之间到达的datagram数
+
+//! A router with `n_interfaces` interfaces, each with one gateway (whose Ethernet address is known),
+//! and `n_routes` random routes spread over the gateways
+Router make_router(const RouterConfig &config, const vector<pair<uint32_t, uint8_t>> &prefixes) {
+    Router router{config};
+
+    // 网卡和路由都会打印DEBUG信息，这里不需要
+    const QuietCerr quiet{};
+    add_interfaces(router, n_interfaces);
+
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        const size_t interface_num = i % n_interfaces;
+        router.add_route(
+            prefixes[i].first, prefixes[i].second, Address::from_ipv4_numeric(gateway_ip(interface_num)), interface_num);
+    }
+    return router;
+}
+
+//! Route every datagram (each arriving on the interface paired with it), `round_size` at a time
+//! \returns datagrams per second
+double measure(Router &router, const vector<pair<size_t, InternetDatagram>> &datagrams) {
+    size_t sent = 0;
+    const auto start_time = high_resolution_clock::now();
+    for (size_t first = 0; first < datagrams.size(); first += round_size) {
+        for (size_t i = first; i < min(first + round_size, datagrams.size()); i++) {
+            router.interface(datagrams[i].first).datagrams_out().push(datagrams[i].second);
+        }
+        router.route();
+        for (size_t i = 0; i < n_interfaces; i++) {
+            auto &frames = router.interface(i).frames_out();
+            sent += frames.size();
+            while (not frames.empty()) {
+                frames.pop();
+            }
+        }
+    }
+    const auto end_time = high_resolution_clock::now();
+
+    if (sent != datagrams.size()) {
+        throw runtime_error("not every datagram was sent");
+    }
+    return double(datagrams.size()) / duration_cast<duration<double>>(end_time - start_time).count();
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // 随机的/16到/24前缀，外加一条默认路由，保证每个目的地址都有路由
+        vector<pair<uint32_t, uint8_t>> prefixes{{0, 0}};
+        while (prefixes.size() < n_routes) {
+            const uint8_t length = 16 + rd() % 9;
+            prefixes.emplace_back(uint32_t(rd()) & (~uint32_t(0) << (32 - length)), length);
+        }
+
+        vector<pair<size_t, InternetDatagram>> datagrams;
+        for (size_t i = 0; i < n_datagrams; i++) {
+            InternetDatagram dgram;
+            dgram.header().src = 0x0a000063;
+            dgram.header().dst = rd();
+            dgram.header().ttl = 64;
+            dgram.header().len = IPv4Header::LENGTH + 64;
+            dgram.payload() = Buffer(string(64, 'x'));
+            InternetDatagram parsed;
+            if (parsed.parse(Buffer(dgram.serialize().concatenate())) != ParseResult::NoError) {
+                throw runtime_error("datagram didn't parse");
+            }
+            datagrams.emplace_back(rd() % n_interfaces, move(parsed));
+        }
+
+        cout << n_interfaces << " interfaces, " << thread::hardware_concurrency() << " hardware threads\n";
+        cout << fixed << setprecision(2);
+        double single_rate = 0;
+        for (const size_t threads : {size_t(0), size_t(1), size_t(2), size_t(4), size_t(8), size_t(16)}) {
+            RouterConfig config;
+            config.threads = threads;
+            Router router = make_router(config, prefixes);
+            const double rate = measure(router, datagrams);
+            if (threads == 0) {
+                single_rate = rate;
+                cout << "calling thread: " << setw(6) << rate / 1e6 << " M datagrams/s\n";
+            } else {
+                cout << setw(2) << threads << " workers:     " << setw(6) << rate / 1e6 << " M datagrams/s ("
+                     << rate / single_rate << "x)\n";
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
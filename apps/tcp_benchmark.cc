@@ -4,6 +4,7 @@
 #include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <new>
 #include <string>
 
 using namespace std;
@@ -11,7 +12,23 @@ using namespace std::chrono;
 
 constexpr size_t len = 100 * 1024 * 1024;
 
-void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments, const bool reorder) {
+// 统计堆分配次数，用来比较打开和关闭packet pool时每个segment的分配次数
+static size_t heap_allocations = 0;
+
+void *operator new(size_t size) {
+    heap_allocations++;
+    if (void *ret = malloc(size ? size : 1)) {
+        return ret;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+//! \returns the number of segments moved from x to y
+size_t move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments, const bool reorder) {
     while (not x.segments_out().empty()) {
         segments.emplace_back(move(x.segments_out().front()));
         x.segments_out().pop();
@@ -25,10 +42,13 @@ void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segme
             y.segment_received(move(*it));
         }
     }
+    const size_t count = segments.size();
     segments.clear();
+    return count;
 }
 
-void main_loop(const bool reorder) {
+void main_loop(const bool reorder, const bool pool) {
+    PacketPool::set_enabled(pool);
     TCPConfig config;
     TCPConnection x{config}, y{config};
 
@@ -46,6 +66,8 @@ void main_loop(const bool reorder) {
     string string_received;
     string_received.reserve(len);
 
+    size_t segments_moved = 0;
+    const size_t first_allocations = heap_allocations;
     const auto first_time = high_resolution_clock::now();
 
     auto loop = [&] {
@@ -66,8 +88,8 @@ void main_loop(const bool reorder) {
 
         // exchange segments between x and y but in reverse order
         vector<TCPSegment> segments;
-        move_segments(x, y, segments, reorder);
-        move_segments(y, x, segments, false);
+        segments_moved += move_segments(x, y, segments, reorder);
+        segments_moved += move_segments(y, x, segments, false);
 
         // read output from y
         const auto available_output = y.inbound_stream().buffer_size();
@@ -89,6 +111,7 @@ void main_loop(const bool reorder) {
     }
 
     const auto final_time = high_resolution_clock::now();
+    const size_t allocations = heap_allocations - first_allocations;
 
     const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
 
@@ -96,7 +119,8 @@ void main_loop(const bool reorder) {
 
     cout << fixed << setprecision(2);
     cout << "CPU-limited throughput" << (reorder ? " with reordering: " : "                : ") << gigabits_per_second
-         << " Gbit/s\n";
+         << " Gbit/s, " << double(allocations) / double(segments_moved) << " allocations/segment (packet pool "
+         << (pool ? "on" : "off") << ")\n";
 
     while (x.active() or y.active()) {
         loop();
@@ -105,8 +129,10 @@ void main_loop(const bool reorder) {
 
 int main() {
     try {
-        main_loop(false);
-        main_loop(true);
+        for (const bool pool : {false, true}) {
+            main_loop(false, pool);
+            main_loop(true, pool);
+        }
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
@@ -0,0 +1,116 @@
+#include "tcp_connection.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t len = 16 * 1024 * 1024;
+constexpr size_t state_queries = 10 * 1000 * 1000;
+
+// 把x发出的segment全部交给y，返回交付的segment数量
+size_t move_segments(TCPConnection &x, TCPConnection &y) {
+    size_t count = 0;
+    while (not x.segments_out().empty()) {
+        y.segment_received(x.segments_out().front());
+        x.segments_out().pop();
+        count++;
+    }
+    return count;
+}
+
+//! Measure how many segments per second TCPConnection::segment_received() can process
+//! while transferring a stream between two connections
+void segment_received_loop() {
+    TCPConfig config;
+    TCPConnection x{config}, y{config};
+
+    const string chunk(TCPConfig::MAX_PAYLOAD_SIZE, 'x');
+    size_t bytes_left = len;
+    size_t segments = 0;
+    bool x_closed = false;
+
+    x.connect();
+    y.end_input_stream();
+
+    const auto first_time = high_resolution_clock::now();
+
+    while (not y.inbound_stream().eof()) {
+        while (bytes_left and x.remaining_outbound_capacity()) {
+            const auto want = min({x.remaining_outbound_capacity(), bytes_left, chunk.size()});
+            bytes_left -= x.write(chunk.substr(0, want));
+        }
+        if (bytes_left == 0 and not x_closed) {
+            x.end_input_stream();
+            x_closed = true;
+        }
+
+        segments += move_segments(x, y);
+        segments += move_segments(y, x);
+
+        y.inbound_stream().pop_output(y.inbound_stream().buffer_size());
+    }
+
+    const auto final_time = high_resolution_clock::now();
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+
+    cout << fixed << setprecision(2);
+    cout << "segment_received(): " << segments * 1000.0 / double(duration) << " Msegments/s (" << segments
+         << " segments, " << double(duration) / double(segments) << " ns/segment)\n";
+
+    while (x.active() or y.active()) {
+        move_segments(x, y);
+        move_segments(y, x);
+        x.tick(1000);
+        y.tick(1000);
+    }
+}
+
+//! Measure the cost of asking an established connection for its state
+void state_loop() {
+    TCPConfig config;
+    TCPConnection x{config}, y{config};
+    x.connect();
+    move_segments(x, y);
+    move_segments(y, x);
+    move_segments(x, y);
+
+    size_t established = 0;
+    const auto first_time = high_resolution_clock::now();
+    for (size_t i = 0; i < state_queries; i++) {
+        established += (x.state() == TCPState::State::ESTABLISHED);
+    }
+    const auto final_time = high_resolution_clock::now();
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+
+    if (established != state_queries) {
+        throw runtime_error("connection unexpectedly left ESTABLISHED");
+    }
+
+    cout << "state() == ESTABLISHED: " << double(duration) / double(state_queries) << " ns/query\n";
+
+    x.end_input_stream();
+    y.end_input_stream();
+    while (x.active() or y.active()) {
+        move_segments(x, y);
+        move_segments(y, x);
+        x.tick(1000);
+        y.tick(1000);
+    }
+}
+
+int main() {
+    try {
+        segment_received_loop();
+        state_loop();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
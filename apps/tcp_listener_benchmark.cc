@@ -0,0 +1,235 @@
+#include "parser.hh"
+#include "tcp_demux.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t len = 32 * 1024 * 1024;
+
+constexpr uint32_t server_address = 0x0a000001;  // 10.0.0.1
+constexpr uint32_t client_address = 0x0a000002;  // 10.0.0.2
+constexpr uint16_t server_port = 80;
+
+// 把x发出的segment序列化后交给y（y看到的四元组是反过来的），返回交付的segment数量
+size_t move_segments(TCPDemultiplexer &x, TCPDemultiplexer &y) {
+    size_t count = 0;
+    auto &out = x.segments_out();
+    while (not out.empty()) {
+        TCPSegment seg;
+        if (seg.parse(out.front().second.serialize().concatenate()) != ParseResult::NoError) {
+            throw runtime_error("segment failed to parse");
+        }
+        y.segment_received(out.front().first.reversed(), seg);
+        out.pop();
+        count++;
+    }
+    return count;
+}
+
+//! Transfer `len` bytes from a client to a server over `n_conns` concurrent connections,
+//! all of which share one TCPDemultiplexer on each side
+void main_loop(const size_t n_conns, const bool syn_cookies) {
+    TCPConfig config;
+    TCPDemultiplexer client{config, n_conns}, server{config, n_conns, syn_cookies};
+
+    const string chunk(TCPConfig::MAX_PAYLOAD_SIZE, 'x');
+    const size_t per_conn = len / n_conns;
+
+    struct Flow {
+        TCPFourTuple id;
+        size_t bytes_left;
+        bool closed;
+    };
+    vector<Flow> flows;
+    vector<TCPFourTuple> accepted;
+    flows.reserve(n_conns);
+    accepted.reserve(n_conns);
+
+    const auto first_time = high_resolution_clock::now();
+
+    for (size_t i = 0; i < n_conns; i++) {
+        const TCPFourTuple id{client_address, uint16_t(1024 + i), server_address, server_port};
+        client.connect(id);
+        flows.push_back({id, per_conn, false});
+    }
+
+    // 三次握手
+    size_t segments = 0;
+    while (accepted.size() < n_conns) {
+        segments += move_segments(client, server);
+        segments += move_segments(server, client);
+        for (auto id = server.accept(); id.has_value(); id = server.accept()) {
+            accepted.push_back(id.value());
+        }
+    }
+
+    const auto established_time = high_resolution_clock::now();
+
+    size_t bytes_received = 0;
+    size_t finished = 0;
+    while (finished < n_conns) {
+        for (auto &flow : flows) {
+            TCPConnection &conn = client.connection(flow.id);
+            while (flow.bytes_left and conn.remaining_outbound_capacity()) {
+                const auto want = min({conn.remaining_outbound_capacity(), flow.bytes_left, chunk.size()});
+                flow.bytes_left -= client.write(flow.id, chunk.substr(0, want));
+            }
+            if (flow.bytes_left == 0 and not flow.closed) {
+                client.end_input_stream(flow.id);
+                flow.closed = true;
+            }
+        }
+
+        segments += move_segments(client, server);
+        segments += move_segments(server, client);
+
+        finished = 0;
+        for (const auto &id : accepted) {
+            ByteStream &inbound = server.connection(id).inbound_stream();
+            bytes_received += inbound.buffer_size();
+            inbound.pop_output(inbound.buffer_size());
+            finished += inbound.eof();
+        }
+    }
+
+    const auto final_time = high_resolution_clock::now();
+
+    if (bytes_received != per_conn * n_conns) {
+        throw runtime_error("bytes received (" + to_string(bytes_received) + ") don't match bytes sent (" +
+                            to_string(per_conn * n_conns) + ")");
+    }
+
+    const auto setup = duration_cast<nanoseconds>(established_time - first_time).count();
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+
+    cout << fixed << setprecision(2);
+    cout << setw(5) << n_conns << " connections" << (syn_cookies ? " (SYN cookies): " : ":               ")
+         << bytes_received * 8.0 / double(duration) << " Gbit/s, "
+         << double(duration) / double(segments) << " ns/segment, handshakes "
+         << double(setup) / 1000.0 / double(n_conns) << " us/connection\n";
+
+    for (const auto &id : accepted) {
+        server.end_input_stream(id);
+    }
+    while (client.size() or server.size()) {
+        move_segments(client, server);
+        move_segments(server, client);
+        client.tick(1000);
+        server.tick(1000);
+        for (const auto &flow : flows) {
+            if (client.contains(flow.id) and not client.connection(flow.id).active()) {
+                client.erase(flow.id);
+            }
+        }
+        for (const auto &id : accepted) {
+            if (server.contains(id) and not server.connection(id).active()) {
+                server.erase(id);
+            }
+        }
+    }
+}
+
+//! Measure the heap memory that a server holds for each connection whose handshake is incomplete
+void half_open_memory(const bool syn_cookies) {
+    constexpr size_t n_conns = 4096;
+
+    TCPConfig config;
+    TCPDemultiplexer client{config, n_conns};
+    for (size_t i = 0; i < n_conns; i++) {
+        client.connect({client_address, uint16_t(1024 + i), server_address, server_port});
+    }
+
+    vector<pair<TCPFourTuple, TCPSegment>> syns;
+    while (not client.segments_out().empty()) {
+        syns.emplace_back(client.segments_out().front().first.reversed(), client.segments_out().front().second);
+        client.segments_out().pop();
+    }
+
+    const size_t heap_before = mallinfo2().uordblks;
+    {
+        TCPDemultiplexer server{config, n_conns, syn_cookies};
+
+        // 只把SYN交给server，它的SYN/ACK被丢弃，所有连接都停留在半开状态
+        for (const auto &[id, syn] : syns) {
+            server.segment_received(id, syn);
+            server.segments_out().pop();
+        }
+
+        const size_t heap_after = mallinfo2().uordblks;
+        cout << "half-open connections" << (syn_cookies ? " (SYN cookies): " : ":               ")
+             << double(heap_after - heap_before) / double(n_conns) << " bytes/connection (" << server.size()
+             << " connections held)\n";
+    }
+
+    for (size_t i = 0; i < n_conns; i++) {
+        client.erase({client_address, uint16_t(1024 + i), server_address, server_port});
+    }
+}
+
+//! Measure the heap memory held by each end of an established connection that has gone idle
+//! after exchanging a short message
+void idle_memory(const bool release_idle_buffers) {
+    constexpr size_t n_conns = 4096;
+
+    TCPConfig config;
+    config.release_idle_buffers = release_idle_buffers;
+
+    const size_t heap_before = mallinfo2().uordblks;
+    {
+        TCPDemultiplexer client{config, n_conns}, server{config, n_conns};
+        for (size_t i = 0; i < n_conns; i++) {
+            const TCPFourTuple id{client_address, uint16_t(1024 + i), server_address, server_port};
+            client.connect(id);
+            client.write(id, "hello");
+        }
+
+        size_t accepted = 0;
+        while (accepted < n_conns) {
+            move_segments(client, server);
+            move_segments(server, client);
+            for (auto id = server.accept(); id.has_value(); id = server.accept()) {
+                server.connection(id.value()).inbound_stream().read(5);
+                accepted++;
+            }
+        }
+        // 让server对已读数据的ACK到达client
+        move_segments(server, client);
+        move_segments(client, server);
+
+        const size_t heap_after = mallinfo2().uordblks;
+        cout << "idle connections" << (release_idle_buffers ? " (release buffers): " : ":                   ")
+             << double(heap_after - heap_before) / double(2 * n_conns) << " bytes/endpoint\n";
+
+        for (size_t i = 0; i < n_conns; i++) {
+            const TCPFourTuple id{client_address, uint16_t(1024 + i), server_address, server_port};
+            client.erase(id);
+            server.erase(id.reversed());
+        }
+    }
+}
+
+int main() {
+    try {
+        for (const size_t n_conns : {1, 64, 1024}) {
+            main_loop(n_conns, false);
+        }
+        main_loop(1024, true);
+        half_open_memory(false);
+        half_open_memory(true);
+        idle_memory(false);
+        idle_memory(true);
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -7,6 +7,13 @@ add_test(NAME t_wrapping_ints_unwrap      COMMAND wrapping_integers_unwrap)
 add_test(NAME t_wrapping_ints_wrap        COMMAND wrapping_integers_wrap)
 add_test(NAME t_wrapping_ints_roundtrip   COMMAND wrapping_integers_roundtrip)
 
+add_test(NAME t_internet_checksum    COMMAND internet_checksum)
+add_test(NAME t_net_parser           COMMAND net_parser)
+add_test(NAME t_header_views         COMMAND header_views)
+add_test(NAME t_buffer_list          COMMAND buffer_list)
+add_test(NAME t_mpsc_ring            COMMAND mpsc_ring)
+add_test(NAME t_ip_reassembler       COMMAND ip_reassembler)
+
 add_test(NAME t_recv_connect         COMMAND recv_connect)
 add_test(NAME t_recv_transmit        COMMAND recv_transmit)
 add_test(NAME t_recv_window          COMMAND recv_window)
@@ -36,12 +43,22 @@ add_test(NAME t_byte_stream_one_write    COMMAND byte_stream_one_write)
 add_test(NAME t_byte_stream_two_writes   COMMAND byte_stream_two_writes)
 add_test(NAME t_byte_stream_capacity     COMMAND byte_stream_capacity)
 add_test(NAME t_byte_stream_many_writes  COMMAND byte_stream_many_writes)
+add_test(NAME t_byte_stream_storage      COMMAND byte_stream_storage)
 
 add_test(NAME t_webget               COMMAND "${PROJECT_SOURCE_DIR}/tests/webget_t.sh")
 
 add_test(NAME arp_network_interface    COMMAND net_interface)
+add_test(NAME arp_cache                COMMAND arp_cache)
+
+add_test(NAME t_tcp_demux            COMMAND tcp_demux)
 
 add_test(NAME router_test    COMMAND network_simulator)
+add_test(NAME router_lpm     COMMAND lpm_table)
+add_test(NAME router_cache   COMMAND router_cache)
+add_test(NAME router_burst   COMMAND router_burst)
+add_test(NAME router_threads COMMAND router_threads)
+add_test(NAME router_ecmp    COMMAND router_ecmp)
+add_test(NAME router_mtu     COMMAND router_mtu)
 
 add_test(NAME t_tcp_parser           COMMAND tcp_parser "${PROJECT_SOURCE_DIR}/tests/ipv4_parser.data")
 add_test(NAME t_ipv4_parser          COMMAND ipv4_parser "${PROJECT_SOURCE_DIR}/tests/ipv4_parser.data")
@@ -0,0 +1,107 @@
+#include "arp_cache.hh"
+
+using namespace std;
+
+// 初始容量（2的幂），最多装一半
+static constexpr size_t INITIAL_SLOTS = 16;
+
+ARPCache::ARPCache(const size_t ttl_ms) : _slots(INITIAL_SLOTS), _ttl_ms(ttl_ms) {}
+
+size_t ARPCache::_home(const uint32_t ip_address) const {
+    // 同一子网的地址只有低位不同：乘以黄金比例常数，取高位，把它们均匀地分散开
+    return ((uint64_t(ip_address) * 0x9e3779b97f4a7c15ull) >> 32) & (_slots.size() - 1);
+}
+
+size_t ARPCache::_find(const uint32_t ip_address) const {
+    const size_t mask = _slots.size() - 1;
+    size_t index = _home(ip_address);
+    while (_slots[index].occupied and _slots[index].ip_address != ip_address) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+void ARPCache::_grow() {
+    vector<Slot> old(2 * _slots.size());
+    swap(old, _slots);
+    for (const auto &slot : old) {
+        if (slot.occupied) {
+            _slots[_find(slot.ip_address)] = slot;
+        }
+    }
+}
+
+//! \details Linear probing without tombstones: after the gap is made, each following mapping in the
+//! same run is moved into the gap if the gap lies between its home slot and where it is now.
+void ARPCache::_erase(size_t index) {
+    const size_t mask = _slots.size() - 1;
+    _slots[index].occupied = false;
+    _size--;
+
+    for (size_t next = (index + 1) & mask; _slots[next].occupied; next = (next + 1) & mask) {
+        const size_t home = _home(_slots[next].ip_address);
+        // home不在(index, next]这一段（环形）内时，这个表项可以挪到空位上
+        const bool movable = index <= next ? (home <= index or home > next) : (home <= index and home > next);
+        if (movable) {
+            _slots[index] = _slots[next];
+            _slots[next].occupied = false;
+            index = next;
+        }
+    }
+}
+
+const EthernetAddress *ARPCache::lookup(const uint32_t ip_address) const {
+    const Slot &slot = _slots[_find(ip_address)];
+    return slot.occupied ? &slot.ethernet_address : nullptr;
+}
+
+void ARPCache::insert(const uint32_t ip_address, const EthernetAddress &ethernet_address) {
+    size_t index = _find(ip_address);
+    if (not _slots[index].occupied) {
+        if (2 * (_size + 1) > _slots.size()) {
+            _grow();
+            index = _find(ip_address);
+        }
+        _slots[index].occupied = true;
+        _slots[index].ip_address = ip_address;
+        _size++;
+    }
+
+    _slots[index].ethernet_address = ethernet_address;
+    _slots[index].refreshing = false;
+    _slots[index].expires = _now + _ttl_ms;
+    _deadlines.push_back({_now + _ttl_ms, ip_address});
+}
+
+bool ARPCache::start_refresh(const uint32_t ip_address, const size_t window_ms) {
+    Slot &slot = _slots[_find(ip_address)];
+    if (not slot.occupied or slot.refreshing or slot.expires > _now + window_ms) {
+        return false;
+    }
+
+    slot.refreshing = true;
+    return true;
+}
+
+void ARPCache::erase(const uint32_t ip_address) {
+    const size_t index = _find(ip_address);
+    if (_slots[index].occupied) {
+        _erase(index);
+    }
+}
+
+void ARPCache::tick(const size_t ms_since_last_tick) {
+    _now += ms_since_last_tick;
+
+    // 和原来一样，表项的年龄超过ttl（而不是等于）时才删除
+    while (not _deadlines.empty() and _deadlines.front().expires < _now) {
+        const Deadline deadline = _deadlines.front();
+        _deadlines.pop_front();
+
+        // 表项在这之后被刷新过（或已经删除）时，这个deadline已经作废
+        const size_t index = _find(deadline.ip_address);
+        if (_slots[index].occupied and _slots[index].expires == deadline.expires) {
+            _erase(index);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef SPONGE_LIBSPONGE_ARP_CACHE_HH
+#define SPONGE_LIBSPONGE_ARP_CACHE_HH
+
+#include "ethernet_header.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+//! \brief The IPv4-to-Ethernet mappings that a NetworkInterface has learned, each remembered for a fixed time
+
+//! The mappings are kept in an open-addressing hash table (linear probing, at most half full) keyed by
+//! the 32-bit IPv4 address, so a lookup costs about one cache line no matter how many neighbours there are.
+//!
+//! Because every mapping lives for the same #ttl_ms, mappings expire in the order in which they were
+//! (last) learned. Expiry is therefore driven by a FIFO of deadlines, and tick() only looks at the
+//! mappings that are actually due. Re-learning a mapping adds a new deadline and leaves the old one
+//! in the queue; it is skipped when it comes up, because it no longer matches the mapping's deadline.
+class ARPCache {
+  private:
+    struct Slot {
+        uint32_t ip_address{};
+        EthernetAddress ethernet_address{};
+        bool occupied{};
+        bool refreshing{};   //!< Has start_refresh() already said yes for this mapping?
+        uint64_t expires{};  //!< Time (in ms since construction) after which the mapping is forgotten
+    };
+
+    struct Deadline {
+        uint64_t expires;
+        uint32_t ip_address;
+    };
+
+    std::vector<Slot> _slots;
+    size_t _size{0};
+    size_t _ttl_ms;
+    uint64_t _now{0};
+    std::deque<Deadline> _deadlines{};
+
+    //! Index of the slot that holds `ip_address`, or of the empty slot where it would go
+    size_t _find(const uint32_t ip_address) const;
+
+    //! Index where `ip_address` would be stored if it had no collisions
+    size_t _home(const uint32_t ip_address) const;
+
+    //! Double the table, re-inserting every mapping
+    void _grow();
+
+    //! Remove the mapping in slot `index`, shifting later colliding mappings back into the gap
+    void _erase(size_t index);
+
+  public:
+    //! Construct an empty cache whose mappings are forgotten `ttl_ms` milliseconds after they are learned
+    explicit ARPCache(const size_t ttl_ms);
+
+    //! The Ethernet address of `ip_address`, or nullptr if it isn't known
+    //! \note The pointer is only valid until the cache is next modified
+    const EthernetAddress *lookup(const uint32_t ip_address) const;
+
+    //! Learn (or re-learn) that `ip_address` is at `ethernet_address`, for the next #ttl_ms
+    void insert(const uint32_t ip_address, const EthernetAddress &ethernet_address);
+
+    //! \brief Is it time to refresh the mapping for `ip_address` (which is about to be used)?
+    //! \returns true, once per time the mapping is learned, if it expires within `window_ms`
+    bool start_refresh(const uint32_t ip_address, const size_t window_ms);
+
+    //! Forget the mapping for `ip_address`, if there is one
+    void erase(const uint32_t ip_address);
+
+    //! Advance time, forgetting the mappings that have expired
+    void tick(const size_t ms_since_last_tick);
+
+    //! Number of mappings currently known
+    size_t size() const { return _size; }
+
+    //! How long a mapping is remembered, in milliseconds
+    size_t ttl_ms() const { return _ttl_ms; }
+};
+
+#endif  // SPONGE_LIBSPONGE_ARP_CACHE_HH
@@ -1,5 +1,7 @@
 #include "byte_stream.hh"
 
+#include <algorithm>
+
 // Dummy implementation of a flow-controlled in-memory byte stream.
 
 // For Lab 0, please replace with a real implementation that passes the
@@ -12,30 +14,58 @@ void DUMMY_CODE(Targs &&... /* unused */) {}
 
 using namespace std;
 
+// 第一次分配的最小空间
+static constexpr size_t MIN_ALLOCATION = 2048;
+
 // 这个鬼地方有风格要求，一定得用成员初始化列表
 // 不能在函数体里面赋值
 ByteStream::ByteStream(const size_t capacity)
-    : buffer(capacity + 1, '\0')  // 环状队列，可写部分的最后一个元素始终是不用的
-    , buf_size(capacity + 1)
+    : buffer()  // 第一次写入时才分配
+    , _capacity(capacity)
     , rpointer(0)
-    , wpointer(0)
     , input_end_flag(0)
+    , _release_when_empty(false)
     , read_count(0)
     , write_count(0)
     , unused_capacity(capacity) {  // 在发生读写时，手动改变剩余空间的数量
 }
 
+void ByteStream::_reserve(const size_t size) {
+    if (size <= buffer.size()) {
+        return;
+    }
+
+    // 按倍数扩容，但不超过_capacity
+    const size_t new_size = min(_capacity, max({size, 2 * buffer.size(), MIN_ALLOCATION}));
+    const size_t used = buffer_size();
+
+    // 把环形队列中的数据按顺序搬到新空间的开头
+    string new_buffer(new_size, '\0');
+    if (used > 0) {
+        const size_t first = min(used, buffer.size() - rpointer);
+        new_buffer.replace(0, first, buffer, rpointer, first);
+        new_buffer.replace(first, used - first, buffer, 0, used - first);
+    }
+    buffer.swap(new_buffer);
+    rpointer = 0;
+}
+
 size_t ByteStream::write(const string &data) {
-    size_t count;
-    size_t data_len = data.length();
-
-    // 从wpointer所指处开始写入环形队列，并更新wpointer
-    // 约束：写指针没有越过读指针；当前访问的data元素下标没有超出data的总长度
-    for (count = 0; (rpointer != (wpointer + 1) % buf_size) && (count < data_len); count++) {
-        buffer[wpointer] = data[count];
-        wpointer = (wpointer + 1) % buf_size;
+    // 最多写入剩余空间那么多的字节
+    const size_t count = min(data.length(), unused_capacity);
+    if (count == 0) {
+        return 0;
     }
 
+    const size_t used = buffer_size();
+    _reserve(used + count);
+
+    // 从写位置开始写入，到达buffer末尾时绕回开头
+    const size_t wpointer = (rpointer + used) % buffer.size();
+    const size_t first = min(count, buffer.size() - wpointer);
+    buffer.replace(wpointer, first, data, 0, first);
+    buffer.replace(0, count - first, data, first, count - first);
+
     // 更新总计写入数量
     write_count += count;
 
@@ -46,27 +76,37 @@ size_t ByteStream::write(const string &data) {
 
 //! \param[in] len bytes will be copied from the output side of the buffer
 string ByteStream::peek_output(const size_t len) const {
-    std::string res;
-    size_t count;
-
-    // 从rpointer指针处开始读取数据，附加到字符串末尾
-    // 约束：在buffer中所读取的区域没有越过写指针；
-    for (count = 0; ((rpointer + count) % buf_size != wpointer) && (count < len); count++) {
-        res.insert(res.end(), buffer[(rpointer + count) % buf_size]);
+    // 读取的区域不能越过已写入的数据，到达buffer末尾时绕回开头
+    const size_t count = min(len, buffer_size());
+    if (count == 0) {
+        return {};
     }
+
+    const size_t first = min(count, buffer.size() - rpointer);
+    string res = buffer.substr(rpointer, first);
+    res.append(buffer, 0, count - first);
     return res;
 }
 
 //! \param[in] len bytes will be removed from the output side of the buffer
 void ByteStream::pop_output(const size_t len) {
-    // 更新读指针
-    rpointer = (rpointer + len) % buf_size;
+    const size_t count = min(len, buffer_size());
 
     // 更新可写空间容量
-    unused_capacity += len;
+    unused_capacity += count;
 
     // 更新累计读取数量
-    read_count += len;
+    read_count += count;
+
+    // 更新读指针；buffer读空时让下一次写入从头开始，并按需释放空间
+    if (buffer_empty()) {
+        rpointer = 0;
+        if (_release_when_empty) {
+            string().swap(buffer);
+        }
+    } else {
+        rpointer = (rpointer + count) % buffer.size();
+    }
 }
 
 //! Read (i.e., copy and then pop) the next "len" bytes of the stream
@@ -84,13 +124,32 @@ std::string ByteStream::read(const size_t len) {
     return res;
 }
 
+//! \param[out] out receives the bytes, and must have room for `len` of them
+//! \param[in] len bytes will be popped and copied to `out`
+//! \param[in,out] checksum accumulates the sum of the copied bytes
+//! \returns the number of bytes copied
+size_t ByteStream::read(char *out, const size_t len, InternetChecksum &checksum) {
+    const size_t count = min(len, buffer_size());
+    if (count == 0) {
+        return 0;
+    }
+
+    // 和peek_output()一样分两段复制，复制的同时求和，不再单独读一遍payload
+    const size_t first = min(count, buffer.size() - rpointer);
+    copy_and_checksum(out, string_view(buffer).substr(rpointer, first), checksum);
+    copy_and_checksum(out + first, string_view(buffer).substr(0, count - first), checksum);
+    pop_output(count);
+
+    return count;
+}
+
 void ByteStream::end_input() { input_end_flag = 1; }
 
 bool ByteStream::input_ended() const { return input_end_flag; }
 
-size_t ByteStream::buffer_size() const { return buf_size - 1 - unused_capacity; }
+size_t ByteStream::buffer_size() const { return _capacity - unused_capacity; }
 
-bool ByteStream::buffer_empty() const { return rpointer == wpointer; }
+bool ByteStream::buffer_empty() const { return unused_capacity == _capacity; }
 
 bool ByteStream::eof() const { return buffer_empty() && input_ended(); }
 
@@ -1,6 +1,8 @@
 #ifndef SPONGE_LIBSPONGE_BYTE_STREAM_HH
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 
+#include "util.hh"
+
 #include <string>
 
 //! \brief An in-order byte stream.
@@ -21,24 +23,28 @@ class ByteStream {
 
     /*
       用string对象设置一个环形队列，
-      buf_size为整个buffer的大小，即string的长度，
-      wpoiter指向下一个可写的位置，
+      buffer.size()为已经分配的空间大小，第一次写入时才分配，
+      之后按需倍增，最大为_capacity（不再浪费一个元素来区分空和满，
+      已用空间由_capacity - unused_capacity得出），
       rpointer指向下一个可读的位置，
-
-      buffer为空：rpointer == wpointer;
-      buffer已满：rpointer == (wpointer + 1) % buf_size;
+      下一个可写的位置为(rpointer + buffer_size()) % buffer.size()
     */
 
     std::string buffer;
-    size_t buf_size;
+    size_t _capacity;
     size_t rpointer;
-    size_t wpointer;
     bool input_end_flag;
 
+    // buffer被读空时是否释放存储空间
+    bool _release_when_empty;
+
     size_t read_count;
     size_t write_count;
     size_t unused_capacity;
 
+    // 保证buffer至少能容纳size个字节，扩容时把数据整理到buffer的开头
+    void _reserve(const size_t size);
+
   public:
     //! Construct a stream with room for `capacity` bytes.
     ByteStream(const size_t capacity);
@@ -59,6 +65,9 @@ class ByteStream {
 
     //! Indicate that the stream suffered an error.
     void set_error() { _error = true; }
+
+    //! Free the buffer's storage whenever the stream is emptied (the next write allocates it again)
+    void set_release_when_empty(const bool release) { _release_when_empty = release; }
     //!@}
 
     //! \name "Output" interface for the reader
@@ -75,6 +84,10 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read the next "len" bytes of the stream into caller's storage, adding them to `checksum` as they are copied
+    //! \returns the number of bytes read
+    size_t read(char *out, const size_t len, InternetChecksum &checksum);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -99,6 +112,9 @@ class ByteStream {
 
     //! Total number of bytes popped
     size_t bytes_read() const;
+
+    //! Number of bytes of storage currently allocated for the buffer
+    size_t bytes_allocated() const { return buffer.size(); }
     //!@}
 };
 
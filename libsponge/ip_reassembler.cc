@@ -0,0 +1,148 @@
+#include "ip_reassembler.hh"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+// 每个未完成的datagram、每个分片除了数据之外占用的内存（计入memory_limit）
+static constexpr size_t PARTIAL_OVERHEAD = 256;
+static constexpr size_t PIECE_OVERHEAD = 64;
+
+// IPv4 datagram的最大长度
+static constexpr size_t MAX_DATAGRAM = 65535;
+
+size_t IPv4Reassembler::KeyHash::operator()(const Key &key) const {
+    // 乘以黄金比例常数，取高位
+    const uint64_t addresses = uint64_t(key.src) << 32 | key.dst;
+    const uint64_t rest = uint64_t(key.id) << 8 | key.proto;
+    return ((addresses ^ (rest * 0xc2b2ae3d27d4eb4full)) * 0x9e3779b97f4a7c15ull) >> 32;
+}
+
+IPv4Reassembler::IPv4Reassembler(const IPv4ReassemblerConfig &config) : _config(config) {}
+
+void IPv4Reassembler::_drop(const Key &key) {
+    const auto it = _partials.find(key);
+    _memory -= it->second.memory;
+    _ages.erase(it->second.age);
+    _partials.erase(it);
+}
+
+//! \details A fragment is dropped, together with the rest of its datagram, if it overlaps a fragment that
+//! has already arrived (other than as an exact duplicate), if it isn't the last fragment but its length
+//! isn't a multiple of 8, or if it reaches past the end of the datagram (as known from the last fragment,
+//! or from the maximum datagram length).
+optional<InternetDatagram> IPv4Reassembler::push(const InternetDatagram &dgram) {
+    const IPv4HeaderView &header = dgram.header_view();
+    if (not header.mf() and header.offset() == 0) {
+        return dgram;
+    }
+    _counters.fragments_received++;
+
+    const Key key{header.src(), header.dst(), header.id(), header.proto()};
+    const size_t start = 8 * size_t(header.offset());
+    const size_t length = header.payload_length();
+    const size_t end = start + length;
+    const bool last = not header.mf();
+
+    auto it = _partials.find(key);
+    if (it == _partials.end()) {
+        it = _partials.emplace(key, Partial{}).first;
+        Partial &partial = it->second;
+        partial.age = _ages.insert(_ages.end(), key);
+        partial.expires = _now + _config.timeout_ms;
+        partial.memory = PARTIAL_OVERHEAD;
+        _memory += PARTIAL_OVERHEAD;
+    }
+    Partial &partial = it->second;
+    vector<Piece> &pieces = partial.pieces;
+
+    // 找到新分片的位置：next是第一个起点不小于start的分片
+    const auto next = lower_bound(pieces.begin(), pieces.end(), start, [](const Piece &piece, const size_t offset) {
+        return piece.start < offset;
+    });
+    if (next != pieces.end() and next->start == start and next->end() == end) {
+        return {};  // 完全相同的重复分片
+    }
+
+    const bool malformed = dgram.payload().size() < length or (not last and length % 8 != 0) or length == 0 or
+                           end + 4 * header.hlen() > MAX_DATAGRAM or (partial.total and end > *partial.total) or
+                           (last and partial.total and end != *partial.total) or
+                           (last and not pieces.empty() and pieces.back().end() > end);
+    const bool overlaps =
+        (next != pieces.end() and next->start < end) or (next != pieces.begin() and prev(next)->end() > start);
+    if (malformed or overlaps) {
+        _counters.datagrams_invalid++;
+        _drop(key);
+        return {};
+    }
+
+    // 分片的数据通常就是收到的frame里的一个Buffer，不用复制（链路层的填充除外）；
+    // 但保留它就保留了它所在的整个slab（或string），很短的分片复制出来，免得一个8字节的分片占住2 KiB。
+    // 计入内存上限的是实际保留的存储
+    const BufferList &payload = dgram.payload();
+    Buffer data = payload.buffers().size() == 1 and payload.size() == length
+                      ? payload.buffers()[0]
+                      : Buffer(payload.concatenate().substr(0, length));
+    if (data.storage_size() > 2 * length) {
+        data = Buffer(data.copy());
+    }
+    const size_t charge = data.storage_size() + PIECE_OVERHEAD;
+    pieces.insert(next, Piece{start, move(data)});
+    if (start == 0) {
+        partial.header = dgram.header();
+    }
+    if (last) {
+        partial.total = end;
+    }
+    partial.received += length;
+    partial.memory += charge;
+    _memory += charge;
+
+    // 超出内存上限时，从最老的datagram开始放弃（可能就是这一个）
+    while (_memory > _config.memory_limit and not _ages.empty()) {
+        const Key oldest = _ages.front();
+        _counters.datagrams_evicted++;
+        _drop(oldest);
+        if (oldest == key) {
+            return {};
+        }
+    }
+
+    // 分片互不重叠，而且都在[0, total)之内：收到的字节数等于total时，数据就是完整的
+    if (not partial.total or partial.received != *partial.total) {
+        return {};
+    }
+
+    string whole;
+    whole.reserve(*partial.total);
+    for (const Piece &piece : pieces) {
+        whole.append(piece.data.str());
+    }
+
+    InternetDatagram result;
+    result.header() = *partial.header;
+    result.header().mf = false;
+    result.header().offset = 0;
+    result.header().len = 4 * partial.header->hlen + whole.size();
+    result.payload() = Buffer(move(whole));
+
+    _counters.datagrams_reassembled++;
+    _drop(key);
+    return result;
+}
+
+void IPv4Reassembler::tick(const size_t ms_since_last_tick) {
+    _now += ms_since_last_tick;
+
+    // 所有datagram的超时时间相同，最老的最先超时
+    while (not _ages.empty()) {
+        const Key key = _ages.front();
+        if (_partials.at(key).expires > _now) {
+            break;
+        }
+        _counters.datagrams_timed_out++;
+        _drop(key);
+    }
+}
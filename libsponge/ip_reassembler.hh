@@ -0,0 +1,117 @@
+#ifndef SPONGE_LIBSPONGE_IP_REASSEMBLER_HH
+#define SPONGE_LIBSPONGE_IP_REASSEMBLER_HH
+
+#include "ipv4_datagram.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//! Config for IPv4Reassembler
+class IPv4ReassemblerConfig {
+  public:
+    static constexpr size_t TIMEOUT_DFLT = 30 * 1000;       //!< Default time to wait for all of a datagram's fragments
+    static constexpr size_t MEMORY_DFLT = 4 * 1024 * 1024;  //!< Default cap on memory held by incomplete datagrams
+
+    //! How long (in ms) after its first fragment arrives an incomplete datagram is given up on
+    size_t timeout_ms = TIMEOUT_DFLT;
+
+    //! \brief Bytes that all the incomplete datagrams together may hold
+    //! \details A fragment counts all of the storage its data keeps alive (such as the whole PacketPool slab it
+    //! was received into). When a fragment would take more, the oldest incomplete datagrams are given up on to
+    //! make room.
+    size_t memory_limit = MEMORY_DFLT;
+};
+
+//! Counts of what IPv4Reassembler has done (they only ever go up)
+struct IPv4ReassemblerCounters {
+    uint64_t fragments_received = 0;     //!< Fragments pushed
+    uint64_t datagrams_reassembled = 0;  //!< Datagrams put back together from their fragments
+    uint64_t datagrams_timed_out = 0;    //!< Incomplete datagrams dropped after IPv4ReassemblerConfig::timeout_ms
+    uint64_t datagrams_evicted = 0;      //!< Incomplete datagrams dropped to stay under the memory limit
+    uint64_t datagrams_invalid = 0;      //!< Incomplete datagrams dropped for overlapping or malformed fragments
+};
+
+//! \brief Puts fragmented IPv4 datagrams back together ([RFC 791](\ref rfc::rfc791))
+
+//! Fragments belong to the same datagram when they have the same source, destination, identification
+//! and protocol. Each incomplete datagram keeps its fragments sorted by offset, so they may arrive in any
+//! order; it is complete when the fragments without gaps reach the one with MF clear.
+//!
+//! Fragments that overlap (other than exact duplicates, which are ignored) make the whole datagram be
+//! dropped, as Linux and [RFC 5722](https://tools.ietf.org/html/rfc5722) do, rather than trusting
+//! either copy of the overlapping bytes. Because every incomplete datagram has the same timeout, they
+//! expire in the order in which they were started, which is kept in a list; that is also the order in
+//! which they are evicted when memory runs out.
+class IPv4Reassembler {
+  private:
+    //! What the fragments of one datagram have in common
+    struct Key {
+        uint32_t src{};
+        uint32_t dst{};
+        uint16_t id{};
+        uint8_t proto{};
+
+        bool operator==(const Key &other) const {
+            return src == other.src and dst == other.dst and id == other.id and proto == other.proto;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    //! The data of one fragment
+    struct Piece {
+        size_t start{};  //!< Offset of the data in the datagram's payload, in bytes
+        Buffer data{};
+
+        size_t end() const { return start + data.size(); }
+    };
+
+    //! A datagram some of whose fragments have arrived
+    struct Partial {
+        std::list<Key>::iterator age{};      //!< Its place in #_ages
+        std::optional<IPv4Header> header{};  //!< The header of the first fragment, once it has arrived
+        std::vector<Piece> pieces{};         //!< Sorted by offset, and never overlapping
+        size_t received{0};                  //!< Bytes of payload in #pieces
+        std::optional<size_t> total{};       //!< Length of the payload, once the last fragment has arrived
+        uint64_t expires{0};                 //!< Time (in ms since construction) after which it is given up on
+        size_t memory{0};                    //!< What it counts towards IPv4ReassemblerConfig::memory_limit
+    };
+
+    IPv4ReassemblerConfig _config;
+    IPv4ReassemblerCounters _counters{};
+    std::unordered_map<Key, Partial, KeyHash> _partials{};
+    std::list<Key> _ages{};  //!< The incomplete datagrams, oldest (and so first to expire) first
+    size_t _memory{0};
+    uint64_t _now{0};
+
+    //! Drop the incomplete datagram `key`
+    void _drop(const Key &key);
+
+  public:
+    explicit IPv4Reassembler(const IPv4ReassemblerConfig &config = IPv4ReassemblerConfig{});
+
+    //! \brief Take a datagram that has arrived
+    //! \returns the datagram if it isn't a fragment, the whole datagram if this was its last missing
+    //! fragment, and otherwise nothing
+    std::optional<InternetDatagram> push(const InternetDatagram &dgram);
+
+    //! Advance time, dropping the incomplete datagrams that have timed out
+    void tick(const size_t ms_since_last_tick);
+
+    //! Number of incomplete datagrams
+    size_t size() const { return _partials.size(); }
+
+    //! Bytes held by the incomplete datagrams (counted against IPv4ReassemblerConfig::memory_limit)
+    size_t memory_usage() const { return _memory; }
+
+    //! \brief Counts of fragments and datagrams
+    const IPv4ReassemblerCounters &counters() const { return _counters; }
+};
+
+#endif  // SPONGE_LIBSPONGE_IP_REASSEMBLER_HH
@@ -0,0 +1,220 @@
+#include "lpm_table.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+// 前两级各自覆盖的前缀长度
+static constexpr uint8_t TOP_BITS = 16;
+static constexpr uint8_t MIDDLE_BITS = 24;
+
+// 批量查找时每一轮处理的地址数
+static constexpr size_t LOOKUP_BURST = 32;
+
+static inline void prefetch(const uint32_t *entry) {
+#if defined(__GNUC__)
+    __builtin_prefetch(entry);
+#else
+    static_cast<void>(entry);
+#endif
+}
+
+static uint32_t prefix_mask(const uint8_t length) { return length == 0 ? 0 : ~uint32_t(0) << (32 - length); }
+
+LPMTable::LPMTable() : _top(size_t(1) << TOP_BITS) {}
+
+uint32_t LPMTable::_new_chunk(const uint32_t entry) {
+    uint32_t index;
+    if (not _free_chunks.empty()) {
+        index = _free_chunks.back();
+        _free_chunks.pop_back();
+        fill_n(&_chunk_slot(index * CHUNK), CHUNK, entry);  // 一个chunk不会跨快照的段
+    } else {
+        index = _chunks.size() / CHUNK;
+        if (index > PAYLOAD) {
+            throw runtime_error("LPMTable: too many chunks");
+        }
+        _chunks.resize(_chunks.size() + CHUNK, entry);
+    }
+    return CHILD | index;
+}
+
+//! \details The prefix covers a run of consecutive slots in the level that holds prefixes of its length;
+//! the chunks on the way to that level are created (filled with the slot they replace) if `create` is set.
+//! Without `create`, a missing chunk means no slot was ever expanded from a prefix this long, so there's
+//! nothing to update.
+template <typename F>
+void LPMTable::_update(const uint32_t prefix, const uint8_t length, const bool create, F &&update) {
+    const size_t top = prefix >> 16;
+    if (length <= TOP_BITS) {
+        for (size_t i = 0; i < size_t(1) << (TOP_BITS - length); i++) {
+            update(_top_slot(top + i));
+        }
+        return;
+    }
+
+    if (not(_top[top] & CHILD)) {
+        if (not create) {
+            return;
+        }
+        // _new_chunk可能让_chunks重新分配，所以先拿到编号再赋值
+        const uint32_t chunk = _new_chunk(_top[top]);
+        _top_slot(top) = chunk;
+    }
+    const size_t middle = (_top[top] & PAYLOAD) * CHUNK + ((prefix >> 8) & 0xff);
+    if (length <= MIDDLE_BITS) {
+        for (size_t i = 0; i < size_t(1) << (MIDDLE_BITS - length); i++) {
+            update(_chunk_slot(middle + i));
+        }
+        return;
+    }
+
+    if (not(_chunks[middle] & CHILD)) {
+        if (not create) {
+            return;
+        }
+        const uint32_t chunk = _new_chunk(_chunks[middle]);
+        _chunk_slot(middle) = chunk;
+    }
+    const size_t bottom = (_chunks[middle] & PAYLOAD) * CHUNK + (prefix & 0xff);
+    for (size_t i = 0; i < size_t(1) << (32 - length); i++) {
+        update(_chunk_slot(bottom + i));
+    }
+}
+
+void LPMTable::_fill(uint32_t &entry, const uint32_t leaf) {
+    if (entry & CHILD) {
+        const size_t base = (entry & PAYLOAD) * CHUNK;
+        _chunk_snapshots.changed(base);
+        for (size_t i = 0; i < CHUNK; i++) {
+            _fill(_chunks[base + i], leaf);
+        }
+    } else if (not(entry & VALID) or _length(entry) <= _length(leaf)) {
+        entry = leaf;
+    }
+}
+
+void LPMTable::_replace(uint32_t &entry, const uint8_t length, const uint32_t leaf) {
+    if (entry & CHILD) {
+        const size_t base = (entry & PAYLOAD) * CHUNK;
+        _chunk_snapshots.changed(base);
+        for (size_t i = 0; i < CHUNK; i++) {
+            _replace(_chunks[base + i], length, leaf);
+        }
+    } else if ((entry & VALID) and _length(entry) == length) {
+        entry = leaf;
+    }
+}
+
+//! \details Only a chunk that no prefix longer than its parent level reaches can be folded into the parent
+//! slot; otherwise erasing that longer prefix later would find no chunk to update.
+void LPMTable::_collapse(uint32_t &entry, const uint8_t max_length) {
+    if (not(entry & CHILD)) {
+        return;
+    }
+    const uint32_t index = entry & PAYLOAD;
+    const auto first = _chunks.begin() + index * CHUNK;
+    const uint32_t leaf = *first;
+    if ((leaf & CHILD) or ((leaf & VALID) and _length(leaf) > max_length) or
+        any_of(first + 1, first + CHUNK, [&](const uint32_t other) { return other != leaf; })) {
+        return;
+    }
+    entry = leaf;
+    _free_chunks.push_back(index);
+}
+
+void LPMTable::insert(const uint32_t prefix, const uint8_t length, const uint32_t value) {
+    if (length > 32 or value > MAX_VALUE) {
+        throw runtime_error("LPMTable: bad prefix length or value");
+    }
+
+    const uint32_t masked = prefix & prefix_mask(length);
+    _prefixes[_key(masked, length)] = value;
+    const uint32_t leaf = _leaf(value, length);
+    _update(masked, length, true, [&](uint32_t &entry) { _fill(entry, leaf); });
+}
+
+bool LPMTable::erase(const uint32_t prefix, const uint8_t length) {
+    if (length > 32) {
+        return false;
+    }
+    const uint32_t masked = prefix & prefix_mask(length);
+    if (_prefixes.erase(_key(masked, length)) == 0) {
+        return false;
+    }
+
+    // 这个前缀的slot交还给覆盖它的、剩下的最长前缀
+    uint32_t leaf = 0;
+    for (uint8_t shorter = length; shorter-- > 0;) {
+        const auto it = _prefixes.find(_key(masked & prefix_mask(shorter), shorter));
+        if (it != _prefixes.end()) {
+            leaf = _leaf(it->second, shorter);
+            break;
+        }
+    }
+    _update(masked, length, false, [&](uint32_t &entry) { _replace(entry, length, leaf); });
+
+    // 整个chunk都变成同一个值时，把它收回
+    if (length > TOP_BITS and (_top[masked >> 16] & CHILD)) {
+        if (length > MIDDLE_BITS) {
+            const size_t middle = (_top[masked >> 16] & PAYLOAD) * CHUNK + ((masked >> 8) & 0xff);
+            _collapse(_chunk_slot(middle), MIDDLE_BITS);
+        }
+        _collapse(_top_slot(masked >> 16), TOP_BITS);
+    }
+    return true;
+}
+
+LPMTable::Snapshot LPMTable::snapshot() {
+    Snapshot snapshot;
+    snapshot._top = _top_snapshots.take(_top);
+    snapshot._chunks = _chunk_snapshots.take(_chunks);
+    return snapshot;
+}
+
+optional<uint32_t> LPMTable::find(const uint32_t prefix, const uint8_t length) const {
+    if (length > 32) {
+        return nullopt;
+    }
+    const auto it = _prefixes.find(_key(prefix & prefix_mask(length), length));
+    if (it == _prefixes.end()) {
+        return nullopt;
+    }
+    return it->second;
+}
+
+//! \details A lookup is a chain of up to three dependent reads, so looking up one address at a time
+//! waits for each cache miss in turn. Here the burst goes through the levels together: the slots of
+//! the next level are prefetched for every address before any of them is read.
+void LPMTable::lookup(const uint32_t *addresses, optional<uint32_t> *values, const size_t count) const {
+    uint32_t entries[LOOKUP_BURST];
+    for (size_t first = 0; first < count; first += LOOKUP_BURST) {
+        const size_t n = min(LOOKUP_BURST, count - first);
+        const uint32_t *burst = addresses + first;
+
+        for (size_t i = 0; i < n; i++) {
+            prefetch(&_top[burst[i] >> 16]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            entries[i] = _top[burst[i] >> 16];
+            if (entries[i] & CHILD) {
+                prefetch(&_chunks[(entries[i] & PAYLOAD) * CHUNK + ((burst[i] >> 8) & 0xff)]);
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (entries[i] & CHILD) {
+                entries[i] = _chunks[(entries[i] & PAYLOAD) * CHUNK + ((burst[i] >> 8) & 0xff)];
+                if (entries[i] & CHILD) {
+                    prefetch(&_chunks[(entries[i] & PAYLOAD) * CHUNK + (burst[i] & 0xff)]);
+                }
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (entries[i] & CHILD) {
+                entries[i] = _chunks[(entries[i] & PAYLOAD) * CHUNK + (burst[i] & 0xff)];
+            }
+            values[first + i] = entries[i] & VALID ? optional<uint32_t>(entries[i] & PAYLOAD) : nullopt;
+        }
+    }
+}
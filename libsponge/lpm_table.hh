@@ -0,0 +1,142 @@
+#ifndef SPONGE_LIBSPONGE_LPM_TABLE_HH
+#define SPONGE_LIBSPONGE_LPM_TABLE_HH
+
+#include "vector_snapshots.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//! \brief A longest-prefix-match table for IPv4 addresses, in the style of DIR-24-8
+
+//! Lookups go through at most three levels of a multibit trie with strides of 16, 8 and 8 bits:
+//! a 2^16-entry table indexed by the top 16 bits of the address, and 256-entry chunks for the
+//! next 8 and the last 8 bits, which exist only under the slots where a longer prefix was added.
+//! Each prefix is expanded into every slot that it covers (controlled prefix expansion), and each
+//! slot remembers the length of the prefix it came from, so that prefixes can be added and removed
+//! one at a time without rebuilding: adding overwrites only slots from shorter prefixes, and
+//! removing hands the removed prefix's slots back to the longest prefix that covers it.
+//!
+//! A lookup therefore costs one to three dependent memory reads, however many prefixes there are.
+//!
+//! A Snapshot of the slots can be taken for lookups on other threads. Successive snapshots share the
+//! 256 KiB segments of slots that haven't changed in between, so taking one after a few changes copies
+//! only the segments those changes wrote.
+class LPMTable {
+  private:
+    // 每个slot是一个32位的entry：
+    //   CHILD置位时，低24位是下一级chunk的编号；
+    //   否则VALID置位时，bits 24..29是前缀长度，低24位是value；都不置位表示没有路由
+    static constexpr uint32_t CHILD = 1u << 31;
+    static constexpr uint32_t VALID = 1u << 30;
+    static constexpr unsigned DEPTH_SHIFT = 24;
+    static constexpr uint32_t PAYLOAD = (1u << DEPTH_SHIFT) - 1;
+    static constexpr size_t CHUNK = 256;
+
+    std::vector<uint32_t> _top;                          //!< Slots for the top 16 bits of the address
+    std::vector<uint32_t> _chunks{};                     //!< 256-slot chunks for the next 8 and the last 8 bits
+    std::vector<uint32_t> _free_chunks{};                //!< Chunks that were collapsed, to be reused
+    std::unordered_map<uint64_t, uint32_t> _prefixes{};  //!< Each prefix (length << 32 | prefix) and its value
+
+    // 写slot都经过下面两个函数，记下快照需要重新复制的段
+    using Snapshots = VectorSnapshots<uint32_t, 16>;
+    Snapshots _top_snapshots{};
+    Snapshots _chunk_snapshots{};
+
+    uint32_t &_top_slot(const size_t i) {
+        _top_snapshots.changed(i);
+        return _top[i];
+    }
+    uint32_t &_chunk_slot(const size_t i) {
+        _chunk_snapshots.changed(i);
+        return _chunks[i];
+    }
+
+    static uint32_t _leaf(const uint32_t value, const uint8_t length) {
+        return VALID | uint32_t(length) << DEPTH_SHIFT | value;
+    }
+    static uint8_t _length(const uint32_t entry) { return (entry >> DEPTH_SHIFT) & 63; }
+    static uint64_t _key(const uint32_t prefix, const uint8_t length) { return uint64_t(length) << 32 | prefix; }
+
+    //! The value of the longest prefix in `top` and `chunks` (the table's slots, or a snapshot of them)
+    //! that matches `address`
+    template <typename Slots>
+    static std::optional<uint32_t> _lookup(const Slots &top, const Slots &chunks, const uint32_t address) {
+        uint32_t entry = top[address >> 16];
+        if (entry & CHILD) {
+            entry = chunks[(entry & PAYLOAD) * CHUNK + ((address >> 8) & 0xff)];
+            if (entry & CHILD) {
+                entry = chunks[(entry & PAYLOAD) * CHUNK + (address & 0xff)];
+            }
+        }
+        if (entry & VALID) {
+            return entry & PAYLOAD;
+        }
+        return std::nullopt;
+    }
+
+    //! A new chunk with every slot set to `entry`, as an entry that points to it
+    uint32_t _new_chunk(const uint32_t entry);
+
+    //! Call `update` on each slot that the prefix covers, creating chunks on the way if `create`
+    template <typename F>
+    void _update(const uint32_t prefix, const uint8_t length, const bool create, F &&update);
+
+    //! Set the slot (and the slots of its chunks) to `leaf` where it came from a prefix no longer than `leaf`'s
+    void _fill(uint32_t &entry, const uint32_t leaf);
+
+    //! Set the slot (and the slots of its chunks) to `leaf` where it came from a prefix of length `length`
+    void _replace(uint32_t &entry, const uint8_t length, const uint32_t leaf);
+
+    //! If the chunk that `entry` points to is all one leaf no longer than `max_length`, free it
+    void _collapse(uint32_t &entry, const uint8_t max_length);
+
+  public:
+    //! The largest value that can be stored
+    static constexpr uint32_t MAX_VALUE = PAYLOAD;
+
+    LPMTable();
+
+    //! Add the prefix `prefix`/`length` with `value`, replacing its value if it's already there
+    //! \note Bits of `prefix` past `length` are ignored
+    void insert(const uint32_t prefix, const uint8_t length, const uint32_t value);
+
+    //! Remove the prefix `prefix`/`length`
+    //! \returns whether the prefix was there
+    bool erase(const uint32_t prefix, const uint8_t length);
+
+    //! The value of exactly the prefix `prefix`/`length`, if it's there
+    std::optional<uint32_t> find(const uint32_t prefix, const uint8_t length) const;
+
+    //! The value of the longest prefix that matches `address`, if any does
+    std::optional<uint32_t> lookup(const uint32_t address) const { return _lookup(_top, _chunks, address); }
+
+    //! lookup() for each of `count` addresses, interleaved so that their cache misses overlap
+    void lookup(const uint32_t *addresses, std::optional<uint32_t> *values, const size_t count) const;
+
+    //! Number of prefixes in the table
+    size_t size() const { return _prefixes.size(); }
+
+    //! Bytes used by the lookup structure (not counting the per-prefix index or snapshots)
+    size_t memory_usage() const { return (_top.size() + _chunks.size()) * sizeof(uint32_t); }
+
+    //! \brief The slots as they were when snapshot() was called, for lookups unaffected by later changes
+    class Snapshot {
+      private:
+        Snapshots::Snapshot _top{};
+        Snapshots::Snapshot _chunks{};
+
+        friend class LPMTable;
+
+      public:
+        //! See LPMTable::lookup()
+        std::optional<uint32_t> lookup(const uint32_t address) const { return _lookup(_top, _chunks, address); }
+    };
+
+    //! \brief Take a Snapshot (copying only the segments of slots changed since the last one)
+    Snapshot snapshot();
+};
+
+#endif  // SPONGE_LIBSPONGE_LPM_TABLE_HH
@@ -2,7 +2,10 @@
 
 #include "arp_message.hh"
 #include "ethernet_frame.hh"
+#include "util.hh"
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 
 // Dummy implementation of a network interface
@@ -20,41 +23,110 @@ using namespace std;
 
 //! \param[in] ethernet_address Ethernet (what ARP calls "hardware") address of the interface
 //! \param[in] ip_address IP (what ARP calls "protocol") address of the interface
-NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address)
-    : _ethernet_address(ethernet_address), _ip_address(ip_address), todo_list(), ARP_cache() {
+//! \param[in] config sets how ARP requests are retried and how many frames may wait for them
+NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address,
+                                   const Address &ip_address,
+                                   const ARPConfig &config)
+    : _ethernet_address(ethernet_address), _ip_address(ip_address), _config(config), ARP_cache(config.cache_ttl_ms) {
     cerr << "DEBUG: Network interface has Ethernet address " << to_string(_ethernet_address) << " and IP address "
          << ip_address.ip() << "\n";
+
+    // 启动时宣告自己的地址，让邻居更新（可能已经过时的）缓存
+    _announcements_left = _config.announcements;
+    if (_announcements_left > 0) {
+        send_announcement();
+    }
 }
 
 //! \param[in] dgram the IPv4 datagram to be sent
 //! \param[in] next_hop the IP address of the interface to send it to (typically a router or default gateway, but may also be another host if directly connected to the same network as the destination)
 //! (Note: the Address type can be converted to a uint32_t (raw 32-bit IP address) with the Address::ipv4_numeric() method.)
 void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Address &next_hop) {
-    // 网络层datagram转字符串，作为链路层frame的payload
-    // 构造frame,
+    if (dgram.header_view().len() > _mtu) {
+        send_fragments(dgram, next_hop);
+        return;
+    }
+
     // 利用下一跳ip检索ARP缓存表：
-    //     存在表项 -> 填充frame的MAC地址，压入发送队列
-    //     不存在表项 -> 将frame和下一跳ip的键值对压入待处理队列，
+    //     存在表项 -> 把datagram序列化，作为链路层frame的payload，填充frame的MAC地址，压入发送队列
+    //     不存在表项 -> 将datagram和下一跳ip的键值对压入待处理队列（等到知道MAC地址时再序列化），
     //                  如果不存在对应ip的bucket（没有发送过对该ip的ARP请求），将ARP请求压入发送队列
 
-    // 构造frame
-    EthernetFrame frame = make_frame(dgram.serialize(), EthernetHeader::TYPE_IPv4);
-
     // 查找本地的ARP映射缓存，若存在对应的表项则直接发送frame
-    optional<EthernetAddress> target_mac = search_ARPcache(next_hop);
+    const EthernetAddress *target_mac = ARP_cache.lookup(next_hop.ipv4_numeric());
 
     if (target_mac) {
-        frame.header().dst = *target_mac;
-        _frames_out.push(frame);
+        const EthernetAddress mac = *target_mac;
+        _frames_out.push(make_frame(dgram.serialize(), EthernetHeader::TYPE_IPv4, mac));
+
+        // 映射快要过期而且还在使用：提前单播一个ARP请求刷新它，在收到回复之前继续使用旧的映射
+        if (_config.refresh_ms > 0 and ARP_cache.start_refresh(next_hop.ipv4_numeric(), _config.refresh_ms)) {
+            send_ARP_request(next_hop, mac);
+            _counters.refreshes_sent++;
+        }
         return;
     }
 
-    // 将frame插入todo_list
-    insert_todolist(next_hop, frame);
+    // 将datagram插入todo_list
+    insert_todolist(next_hop, dgram);
 
     return;
 }
 
+void NetworkInterface::send_datagrams(const InternetDatagram *const *dgrams,
+                                      const uint32_t *next_hops,
+                                      const size_t count) {
+    // 同一个burst里发往同一下一跳的datagram通常是连续的：记住上一次查到的MAC地址。
+    // 发送frame不会改变ARP缓存，所以在遇到未知的下一跳之前，这个MAC地址一直有效
+    bool resolved = false;
+    uint32_t resolved_hop = 0;
+    EthernetAddress mac{};
+
+    for (size_t i = 0; i < count; i++) {
+        // 超过MTU的datagram由send_datagram()分片（发送不改变ARP缓存，记住的MAC地址仍然有效）
+        if (dgrams[i]->header_view().len() > _mtu) {
+            send_datagram(*dgrams[i], Address::from_ipv4_numeric(next_hops[i]));
+            continue;
+        }
+
+        const bool new_hop = not resolved or next_hops[i] != resolved_hop;
+        if (new_hop) {
+            const EthernetAddress *target_mac = ARP_cache.lookup(next_hops[i]);
+            if (not target_mac) {
+                // 未知的下一跳：和send_datagram()一样排队等待ARP回复
+                resolved = false;
+                send_datagram(*dgrams[i], Address::from_ipv4_numeric(next_hops[i]));
+                continue;
+            }
+            resolved = true;
+            resolved_hop = next_hops[i];
+            mac = *target_mac;
+        }
+
+        _frames_out.push(make_frame(dgrams[i]->serialize(), EthernetHeader::TYPE_IPv4, mac));
+
+        // 和send_datagram()一样刷新快要过期的映射（每个映射只会刷新一次，所以只在换下一跳时检查）
+        if (new_hop and _config.refresh_ms > 0 and ARP_cache.start_refresh(resolved_hop, _config.refresh_ms)) {
+            send_ARP_request(Address::from_ipv4_numeric(resolved_hop), mac);
+            _counters.refreshes_sent++;
+        }
+    }
+}
+
+void NetworkInterface::send_fragments(const InternetDatagram &dgram, const Address &next_hop) {
+    const vector<InternetDatagram> fragments = dgram.fragment(_mtu);
+    if (fragments.empty()) {
+        _fragmentation_counters.dropped_too_big++;
+        return;
+    }
+
+    _fragmentation_counters.datagrams_fragmented++;
+    _fragmentation_counters.fragments_sent += fragments.size();
+    for (const auto &fragment : fragments) {
+        send_datagram(fragment, next_hop);
+    }
+}
+
 //! \param[in] frame the incoming Ethernet frame
 std::optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &frame) {
     // 检查frame的目的地址：
@@ -101,6 +173,7 @@ std::optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame
     EthernetAddress sender_mac(arp_message.sender_ethernet_address);
 
     insert_ARPcache(sender_ip, sender_mac);
+    _counters.mappings_learned++;
 
     send_from_todolist(sender_ip, sender_mac);
 
@@ -113,46 +186,99 @@ std::optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame
             return std::nullopt;
         }
         ARPMessage arp_reply = make_ARPmessage(sender_ip, sender_mac);
-        EthernetFrame arp_reply_as_frame = make_frame(arp_reply.serialize(), EthernetHeader::TYPE_ARP);
-        arp_reply_as_frame.header().dst = sender_mac;
-        _frames_out.push(arp_reply_as_frame);
+        _frames_out.push(make_frame(arp_reply.serialize(), EthernetHeader::TYPE_ARP, sender_mac));
+        _counters.replies_sent++;
         return std::nullopt;
     }
 
     return std::nullopt;
 }
 
-//! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
-void NetworkInterface::tick(const size_t ms_since_last_tick) {
-    // 循环遍历，逐一为ARP缓存表的表项的计时器加上ms_since_last_tick
-    //     当计时器超出30 * 1000时，删除该表项
+string_view NetworkInterface::ipv4_header_bytes(const EthernetFrame &frame) const {
+    if (frame.header().type != EthernetHeader::TYPE_IPv4 or
+        (frame.header().dst != ETHERNET_BROADCAST and frame.header().dst != _ethernet_address) or
+        frame.payload().buffers().size() != 1) {
+        return {};
+    }
+    const string_view data = frame.payload().buffers()[0].str();
+    if (data.size() < IPv4Header::LENGTH) {
+        return {};
+    }
+    return data.substr(0, 4 * (uint8_t(data[0]) & 0x0f));
+}
 
-    for (auto iter = ARP_cache.begin(); iter != ARP_cache.end();) {
-        (*iter).timer += ms_since_last_tick;
-        if ((*iter).timer > TIME_OUT) {
-            iter = ARP_cache.erase(iter);
-        } else {
-            iter++;
+void NetworkInterface::recv_frames(const EthernetFrame *frames,
+                                   const size_t count,
+                                   queue<InternetDatagram> &datagrams) {
+    for (size_t first = 0; first < count; first += MAX_CHECKSUM_BATCH) {
+        const size_t n = min(count - first, MAX_CHECKSUM_BATCH);
+
+        // 一次算出这一批datagram的header校验和，校验和正确的datagram解析时不再重复计算
+        array<string_view, MAX_CHECKSUM_BATCH> headers{};
+        for (size_t i = 0; i < n; i++) {
+            headers[i] = ipv4_header_bytes(frames[first + i]);
+        }
+        const uint64_t valid = verify_checksums(headers.data(), nullptr, n);
+
+        // 其他的frame（ARP、校验和错误的datagram、不连续的payload……）和recv_frame()的处理完全一样
+        for (size_t i = 0; i < n; i++) {
+            const EthernetFrame &frame = frames[first + i];
+            InternetDatagram dgram;
+            if (not headers[i].empty() and (valid >> i & 1) and
+                dgram.parse(frame.payload().buffers()[0], false) == ParseResult::NoError) {
+                datagrams.push(move(dgram));
+            } else if (optional<InternetDatagram> received = recv_frame(frame)) {
+                datagrams.push(move(*received));
+            }
         }
     }
+}
 
-    // 此外还要处理todo_list中的计时器
-    for (auto iter = todo_list.begin(); iter != todo_list.end(); iter++) {
-        (*iter).timer += ms_since_last_tick;
+//! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
+void NetworkInterface::tick(const size_t ms_since_last_tick) {
+    // ARP缓存的表项存在超过30 * 1000ms后删除（只检查到期的表项，不再遍历整个缓存）
+    ARP_cache.tick(ms_since_last_tick);
+    _now += ms_since_last_tick;
+
+    // 剩下的gratuitous ARP每隔announce_interval_ms发送一个
+    if (_announcements_left > 0 and _next_announcement <= _now) {
+        send_announcement();
     }
-}
 
-EthernetFrame NetworkInterface::make_frame(const BufferList &payload, const uint16_t &type) {
-    BufferList frame_as_bufferlist(string(14, '\0'));
-    frame_as_bufferlist.append(payload);
+    // 此外还要处理到期的bucket：重发ARP请求，或者在发送了max_requests次之后放弃
+    while (not _retries.empty() and _retries.top().first <= _now) {
+        const auto [deadline, ip] = _retries.top();
+        _retries.pop();
 
-    EthernetFrame frame;
-    frame.parse(frame_as_bufferlist.concatenate());
+        const auto iter = todo_list.find(ip);
+        if (iter == todo_list.end() or iter->second.next_request != deadline) {
+            continue;
+        }
+
+        Bucket &bucket = iter->second;
+        if (bucket.requests_sent >= _config.max_requests) {
+            _counters.dropped_unresolved += bucket.get_todo_list().size();
+            _counters.hops_unresolved++;
+            _pending_frames -= bucket.get_todo_list().size();
+            todo_list.erase(iter);
+            continue;
+        }
 
-    frame.header().src = _ethernet_address;
-    frame.header().type = type;
+        send_ARP_request(Address::from_ipv4_numeric(ip));
+        bucket.requests_sent++;
+        schedule_retry(ip, bucket);
+    }
+}
+
+void NetworkInterface::schedule_retry(const uint32_t ip, Bucket &bucket) {
+    // 第k次请求之后等待retry_ms * 2^(k-1)
+    bucket.next_request = _now + (_config.retry_ms << min(bucket.requests_sent - 1, 16u));
+    _retries.emplace(bucket.next_request, ip);
+}
 
-    return frame;
+EthernetFrame NetworkInterface::make_frame(BufferList payload, const uint16_t type, const EthernetAddress &dst) {
+    // 不再拼接成字符串：payload保持原样（和它的headroom），header在序列化时才写进去
+    return {EthernetHeader{dst, _ethernet_address, type}, move(payload)};
 }
 
 ARPMessage NetworkInterface::make_ARPmessage(const Address &target_ip, const optional<EthernetAddress> &target_mac) {
@@ -175,71 +301,74 @@ ARPMessage NetworkInterface::make_ARPmessage(const Address &target_ip, const opt
     return message;
 }
 
-std::optional<EthernetAddress> NetworkInterface::search_ARPcache(const Address &target_ip) {
-    for (auto iter = ARP_cache.begin(); iter != ARP_cache.end(); iter++) {
-        if ((*iter).ip_address == target_ip) {
-            return (*iter).ethernet_address;
-        }
-    }
-
-    return std::nullopt;
+void NetworkInterface::insert_ARPcache(const Address &ip, const EthernetAddress &mac) {
+    ARP_cache.insert(ip.ipv4_numeric(), mac);
 }
 
-void NetworkInterface::insert_ARPcache(const Address &ip, const EthernetAddress &mac) {
-    for (auto iter = ARP_cache.begin(); iter != ARP_cache.end(); iter++) {
-        if ((*iter).ip_address == ip) {
-            (*iter).ethernet_address = mac;
-            (*iter).timer = 0;
-            return;
-        }
+void NetworkInterface::insert_todolist(const Address &ip, const InternetDatagram &dgram) {
+    // 所有队列加起来已满：丢弃新的datagram（也不为它发送ARP请求）
+    if (_pending_frames >= _config.max_pending) {
+        _counters.dropped_pending_full++;
+        return;
     }
 
-    Mapping new_mapping(mac, ip, 0);
-    ARP_cache.push_front(new_mapping);
-    return;
-}
+    const uint32_t key = ip.ipv4_numeric();
+    auto iter = todo_list.find(key);
+    if (iter == todo_list.end()) {
+        // 第一个发往这个下一跳的datagram：立即发送ARP请求，之后的重发由tick()负责
+        iter = todo_list.emplace(key, Bucket{}).first;
+        send_ARP_request(ip);
+        iter->second.requests_sent = 1;
+        schedule_retry(key, iter->second);
+    }
 
-void NetworkInterface::insert_todolist(const Address &ip, const EthernetFrame &frame) {
-    for (auto iter = todo_list.begin(); iter != todo_list.end(); iter++) {
-        if ((*iter).get_ip() == ip) {
-            (*iter).get_todo_list().push(frame);
-            if ((*iter).timer >= 5000) {
-                (*iter).timer = (*iter).timer % 5000;
-                send_ARP_request(ip);
-            }
-            return;
-        }
+    // 这个下一跳的队列已满：丢弃最早的datagram；
+    // 上限为0时队列里没有可以丢的，丢弃的就是新的datagram（ARP请求照常发送）
+    queue<InternetDatagram> &dgrams = iter->second.get_todo_list();
+    if (_config.max_pending_per_hop == 0) {
+        _counters.dropped_hop_full++;
+        return;
+    }
+    if (dgrams.size() >= _config.max_pending_per_hop) {
+        dgrams.pop();
+        _pending_frames--;
+        _counters.dropped_hop_full++;
     }
 
-    Bucket new_bucket(ip);
-    todo_list.push_front(new_bucket);
-    todo_list.front().get_todo_list().push(frame);
-    send_ARP_request(ip);
-    return;
+    dgrams.push(dgram);
+    _pending_frames++;
+    _counters.frames_queued++;
 }
 
 void NetworkInterface::send_from_todolist(const Address &ip, const EthernetAddress &mac) {
-    for (auto iter = todo_list.begin(); iter != todo_list.end(); iter++) {
-        if ((*iter).get_ip() == ip) {
-            while (!(*iter).get_todo_list().empty()) {
-                (*iter).get_todo_list().front().header().dst = mac;
-                _frames_out.push((*iter).get_todo_list().front());
-                (*iter).get_todo_list().pop();
-            }
-            iter = todo_list.erase(iter);
-            return;
-        }
+    const auto iter = todo_list.find(ip.ipv4_numeric());
+    if (iter == todo_list.end()) {
+        return;
     }
-    return;
+
+    queue<InternetDatagram> &dgrams = iter->second.get_todo_list();
+    _pending_frames -= dgrams.size();
+    _counters.frames_resolved += dgrams.size();
+    while (not dgrams.empty()) {
+        _frames_out.push(make_frame(dgrams.front().serialize(), EthernetHeader::TYPE_IPv4, mac));
+        dgrams.pop();
+    }
+    todo_list.erase(iter);
 }
 
-void NetworkInterface::send_ARP_request(const Address &target_ip) {
+void NetworkInterface::send_ARP_request(const Address &target_ip, const EthernetAddress &dst) {
     ARPMessage arp_req = make_ARPmessage(target_ip, std::nullopt);
-    EthernetFrame arp_req_frame = make_frame(arp_req.serialize(), EthernetHeader::TYPE_ARP);
-
-    EthernetAddress all_one;
-    all_one.fill(0xFF);
-    arp_req_frame.header().dst = all_one;
-    _frames_out.push(arp_req_frame);
+    _frames_out.push(make_frame(arp_req.serialize(), EthernetHeader::TYPE_ARP, dst));
+    _counters.requests_sent++;
     return;
 }
+
+void NetworkInterface::send_announcement() {
+    // RFC 5227的ARP announcement：sender和target都是自己的IP地址的ARP请求
+    ARPMessage announcement = make_ARPmessage(_ip_address, std::nullopt);
+    _frames_out.push(make_frame(announcement.serialize(), EthernetHeader::TYPE_ARP, ETHERNET_BROADCAST));
+    _counters.announcements_sent++;
+
+    _announcements_left--;
+    _next_announcement = _now + _config.announce_interval_ms;
+}
@@ -1,40 +1,84 @@
 #ifndef SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
 #define SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
 
+#include "arp_cache.hh"
 #include "arp_message.hh"
 #include "ethernet_frame.hh"
 #include "tcp_over_ip.hh"
 #include "tun.hh"
 
+#include <cstdint>
+#include <functional>
 #include <optional>
 #include <queue>
-
-// queue不能遍历，
-// 我需要一个能遍历的容器来存储待处理的frame和本地ARP缓存
-#include <list>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #define TIME_OUT 30 * 1000
 
-class Mapping {
+//! Config for NetworkInterface's ARP resolution
+class ARPConfig {
   public:
-    EthernetAddress ethernet_address;
-    Address ip_address;
-    size_t timer;
+    static constexpr size_t RETRY_DFLT = 5000;              //!< Default wait before the first ARP retry, in ms
+    static constexpr unsigned MAX_REQUESTS_DFLT = 3;        //!< Default number of ARP requests before giving up
+    static constexpr size_t PENDING_PER_HOP_DFLT = 32;      //!< Default cap on frames waiting for one next hop
+    static constexpr size_t PENDING_DFLT = 1024;            //!< Default cap on frames waiting for all next hops
+    static constexpr size_t REFRESH_DFLT = 2000;            //!< Default time before expiry to refresh a mapping, in ms
+    static constexpr size_t ANNOUNCE_INTERVAL_DFLT = 2000;  //!< Default time between announcements (RFC 5227)
+
+    size_t cache_ttl_ms = TIME_OUT;                     //!< How long a learned mapping is remembered, in ms
+    size_t retry_ms = RETRY_DFLT;                       //!< Wait before the first retry (later ones wait twice as long)
+    unsigned max_requests = MAX_REQUESTS_DFLT;          //!< ARP requests sent for one next hop before giving up
+    size_t max_pending_per_hop = PENDING_PER_HOP_DFLT;  //!< Cap on frames queued for one next hop (0 queues none)
+    size_t max_pending = PENDING_DFLT;                  //!< Cap on frames queued for all next hops together
+
+    //! \brief Re-ARP a mapping that is used this long (in ms) before it expires (0 to never refresh)
+    //! \details The refresh is a unicast ARP request to the cached address, which stays in use meanwhile.
+    size_t refresh_ms = REFRESH_DFLT;
+
+    //! \brief Gratuitous ARP announcements of the interface's own address to broadcast (0 for none)
+    //! \details The first is sent when the interface is constructed, the rest every #announce_interval_ms.
+    unsigned announcements = 0;
+    size_t announce_interval_ms = ANNOUNCE_INTERVAL_DFLT;  //!< Time between announcements, in ms
+};
+
+//! Counts of what NetworkInterface's ARP resolution has done (they only ever go up)
+struct ARPCounters {
+    uint64_t requests_sent = 0;         //!< ARP requests sent (including retries and refreshes)
+    uint64_t replies_sent = 0;          //!< ARP replies sent
+    uint64_t refreshes_sent = 0;        //!< Unicast ARP requests sent to refresh mappings in use
+    uint64_t announcements_sent = 0;    //!< Gratuitous ARP announcements sent
+    uint64_t mappings_learned = 0;      //!< ARP messages whose sender mapping was learned
+    uint64_t frames_queued = 0;         //!< Frames queued to wait for their next hop to be resolved
+    uint64_t frames_resolved = 0;       //!< Queued frames sent once their next hop was resolved
+    uint64_t dropped_hop_full = 0;      //!< Queued frames dropped because their next hop's queue was full
+    uint64_t dropped_pending_full = 0;  //!< Frames dropped because all the queues together were full
+    uint64_t dropped_unresolved = 0;    //!< Queued frames dropped because their next hop never answered
+    uint64_t hops_unresolved = 0;       //!< Next hops given up on after ARPConfig::max_requests requests
+
+    //! Total number of frames dropped for any reason
+    uint64_t frames_dropped() const { return dropped_hop_full + dropped_pending_full + dropped_unresolved; }
+};
 
-    Mapping(const EthernetAddress &eth_addr, const Address &ip_addr, const size_t &ms)
-        : ethernet_address(eth_addr), ip_address(ip_addr), timer(ms) {}
+//! Counts of datagrams that NetworkInterface has had to fragment to fit its MTU (they only ever go up)
+struct FragmentationCounters {
+    uint64_t datagrams_fragmented = 0;  //!< Datagrams longer than the MTU that were sent as fragments
+    uint64_t fragments_sent = 0;        //!< Fragments they were sent as
+    uint64_t dropped_too_big = 0;       //!< Datagrams longer than the MTU that had DF set, and so were dropped
 };
 
+// 一个正在等待ARP回复的下一跳：待发送的datagram，以及ARP请求的重发计划
+// （datagram在知道目的MAC地址、真正发送时才序列化成frame）
 class Bucket {
   private:
-    Address ip_address;
-    std::queue<EthernetFrame> todo_list;
+    std::queue<InternetDatagram> todo_list{};
 
   public:
-    size_t timer;
-    Bucket(const Address &ip_addr) : ip_address(ip_addr), todo_list(), timer(0){};
-    std::queue<EthernetFrame> &get_todo_list() { return todo_list; }
-    Address &get_ip() { return ip_address; };
+    unsigned requests_sent{0};  // 已经发送的ARP请求数
+    uint64_t next_request{0};   // 下一次重发ARP请求（或者放弃）的时间
+    std::queue<InternetDatagram> &get_todo_list() { return todo_list; }
 };
 
 //! \brief A "network interface" that connects IP (the internet layer, or network layer)
@@ -59,6 +103,9 @@ class Bucket {
 //! request or reply, the network interface processes the frame
 //! and learns or replies as necessary.
 class NetworkInterface {
+  public:
+    static constexpr size_t MTU_DFLT = 1500;  //!< Default MTU (that of Ethernet)
+
   private:
     //! Ethernet (known as hardware, network-access-layer, or link-layer) address of the interface
     EthernetAddress _ethernet_address;
@@ -69,15 +116,51 @@ class NetworkInterface {
     //! outbound queue of Ethernet frames that the NetworkInterface wants sent
     std::queue<EthernetFrame> _frames_out{};
 
-    // 存储那些ARP缓存中没有对应地址的、待发送的frame
-    std::list<Bucket> todo_list;
+    ARPConfig _config;
+
+    ARPCounters _counters{};
+
+    // 链路能承载的最长datagram（字节），以及超过它的datagram的分片统计
+    size_t _mtu{MTU_DFLT};
+    FragmentationCounters _fragmentation_counters{};
+
+    // 把超过MTU的datagram分片发送（DF置位时丢弃）
+    void send_fragments(const InternetDatagram &dgram, const Address &next_hop);
+
+    // 构造以来经过的时间（ms）
+    uint64_t _now{0};
+
+    // 存储那些ARP缓存中没有对应地址的、待发送的datagram，以下一跳的IPv4地址为键
+    std::unordered_map<uint32_t, Bucket> todo_list{};
+
+    // 所有bucket中的datagram总数
+    size_t _pending_frames{0};
+
+    // ARP请求的重发时间表：(时间, 下一跳)，最早的在最前面。
+    // bucket的重发计划改变或者bucket被删除后，旧的表项在取出时跳过
+    std::priority_queue<std::pair<uint64_t, uint32_t>,
+                        std::vector<std::pair<uint64_t, uint32_t>>,
+                        std::greater<std::pair<uint64_t, uint32_t>>>
+        _retries{};
 
-    // 存储ARP映射对的本地缓存
-    std::list<Mapping> ARP_cache;
+    // 存储ARP映射对的本地缓存（以IPv4地址为键的哈希表）
+    ARPCache ARP_cache;
+
+    // 还要发送的gratuitous ARP数，以及下一次发送的时间
+    unsigned _announcements_left{0};
+    uint64_t _next_announcement{0};
+
+    // 给bucket安排下一次ARP请求：间隔从config的retry_ms开始，每次加倍
+    void schedule_retry(const uint32_t ip, Bucket &bucket);
+
+    // 广播一个gratuitous ARP，宣告本接口的IP地址和MAC地址
+    void send_announcement();
 
   public:
     //! \brief Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer) addresses
-    NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address);
+    NetworkInterface(const EthernetAddress &ethernet_address,
+                     const Address &ip_address,
+                     const ARPConfig &config = ARPConfig{});
 
     //! \brief Access queue of Ethernet frames awaiting transmission
     std::queue<EthernetFrame> &frames_out() { return _frames_out; }
@@ -86,8 +169,16 @@ class NetworkInterface {
 
     //! Will need to use [ARP](\ref rfc::rfc826) to look up the Ethernet destination address for the next hop
     //! ("Sending" is accomplished by pushing the frame onto the frames_out queue.)
+    //! A datagram longer than the MTU is sent as fragments, or dropped if it has DF set.
     void send_datagram(const InternetDatagram &dgram, const Address &next_hop);
 
+    //! \brief Sends a burst of IPv4 datagrams, as if by send_datagram() on each in turn
+    //! \details Consecutive datagrams to the same next hop share one ARP cache lookup.
+    //! \param[in] dgrams the datagrams to send
+    //! \param[in] next_hops the numeric IPv4 address of each datagram's next hop
+    //! \param[in] count the number of datagrams
+    void send_datagrams(const InternetDatagram *const *dgrams, const uint32_t *next_hops, const size_t count);
+
     //! \brief Receives an Ethernet frame and responds appropriately.
 
     //! If type is IPv4, returns the datagram.
@@ -95,29 +186,51 @@ class NetworkInterface {
     //! If type is ARP reply, learn a mapping from the "sender" fields.
     std::optional<InternetDatagram> recv_frame(const EthernetFrame &frame);
 
+    //! \brief Receives a burst of Ethernet frames, as if by recv_frame() on each in turn
+    //! \details The header checksums of the burst's IPv4 datagrams are verified together, with verify_checksums().
+    //! \param[in] frames the incoming Ethernet frames
+    //! \param[in] count the number of frames
+    //! \param[out] datagrams receives the IPv4 datagrams, in the order received
+    void recv_frames(const EthernetFrame *frames, const size_t count, std::queue<InternetDatagram> &datagrams);
+
     //! \brief Called periodically when time elapses
+
+    //! Expires old ARP mappings, and re-sends ARP requests for next hops that haven't answered
+    //! (giving up on them, and dropping their frames, after ARPConfig::max_requests requests).
     void tick(const size_t ms_since_last_tick);
 
-    // 构造frame
-    EthernetFrame make_frame(const BufferList &payload, const uint16_t &type);
+    //! \brief Counts of ARP activity and of frames dropped while waiting for ARP
+    const ARPCounters &counters() const { return _counters; }
+
+    //! \brief The longest datagram (in bytes, header included) that the link carries in one frame
+    size_t mtu() const { return _mtu; }
+
+    //! \brief Set the MTU (see mtu())
+    void set_mtu(const size_t mtu) { _mtu = mtu; }
+
+    //! \brief Counts of datagrams fragmented, or dropped, because they didn't fit the MTU
+    const FragmentationCounters &fragmentation_counters() const { return _fragmentation_counters; }
+
+    // 发给这个网卡的IPv4 frame中datagram的header（payload不是一个连续的Buffer时为空）
+    std::string_view ipv4_header_bytes(const EthernetFrame &frame) const;
+
+    // 构造发往dst的frame（payload原样放进frame，不复制）
+    EthernetFrame make_frame(BufferList payload, const uint16_t type, const EthernetAddress &dst);
 
     // 构造ARP报文
     ARPMessage make_ARPmessage(const Address &target_ip, const std::optional<EthernetAddress> &target_mac);
 
-    // 查询ARP缓存
-    std::optional<EthernetAddress> search_ARPcache(const Address &target_ip);
-
     // 刷新ARP表项
     void insert_ARPcache(const Address &ip, const EthernetAddress &mac);
 
     // 插入todo_list
-    void insert_todolist(const Address &ip, const EthernetFrame &frame);
+    void insert_todolist(const Address &ip, const InternetDatagram &dgram);
 
-    // 从todo_list中发送符合相应地址的frame
+    // 从todo_list中发送符合相应地址的datagram
     void send_from_todolist(const Address &ip, const EthernetAddress &mac);
 
-    // 构造并发送ARP请求
-    void send_ARP_request(const Address &target_ip);
+    // 构造并发送ARP请求（默认广播；刷新已知的映射时直接发给对方）
+    void send_ARP_request(const Address &target_ip, const EthernetAddress &dst = ETHERNET_BROADCAST);
 };
 
 #endif  // SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
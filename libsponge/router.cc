@@ -1,6 +1,14 @@
 #include "router.hh"
 
+#include "mpsc_ring.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 using namespace std;
 
@@ -18,6 +26,135 @@ using namespace std;
 template <typename... Targs>
 void DUMMY_CODE(Targs &&... /* unused */) {}
 
+// 没有路由的datagram的出口
+static constexpr uint32_t NO_ROUTE = ~uint32_t(0);
+
+//! The route among a prefix's equal-cost `routes` that `dgram` takes
+static const Rule &choose_route(const vector<Rule> &routes, const InternetDatagram &dgram) {
+    if (routes.size() == 1) {
+        return routes.front();
+    }
+    // 把哈希值的范围等分给各条路由（RFC 2992的hash-threshold）：增删一条路由时，只有一部分flow换路
+    return routes[(uint64_t(dgram.flow_hash()) * routes.size()) >> 32];
+}
+
+//! \details Between rounds the workers wait on #wake; route() publishes a snapshot of the routes, starts
+//! a round, and waits on #done until every worker has finished it. So outside route(), only the calling
+//! thread touches the interfaces, and the interfaces need no locking of their own.
+struct Router::Parallel {
+    //! A routed datagram on its way to its egress interface's owner
+    struct Transmit {
+        InternetDatagram dgram{};
+        uint32_t next_hop{};
+    };
+
+    //! Scratch space for one worker's worker_transmit()
+    struct Scratch {
+        std::vector<Transmit> batch{};
+        std::vector<const InternetDatagram *> dgrams{};
+        std::vector<uint32_t> next_hops{};
+    };
+
+    size_t n_threads;
+    size_t ring_size;
+
+    //! \name The routes: add_route() and remove_route() change the master copy (in Router) under
+    //! #table_mutex, and route() takes a new #snapshot of it if it has changed since the last one (which
+    //! copies only the parts that changed)
+    //!@{
+    std::mutex table_mutex{};
+    bool table_changed{true};
+    std::shared_ptr<const RouteTable> snapshot{};
+    //!@}
+
+    std::vector<std::unique_ptr<MPSCRing<Transmit>>> rings{};  //!< Transmit ring of each interface
+    std::vector<Scratch> scratch{};                            //!< One per worker
+
+    //! \name Coordination of rounds
+    //!@{
+    std::mutex mutex{};
+    std::condition_variable wake{};
+    std::condition_variable done{};
+    Router *router{nullptr};  //!< The router to work for this round (it may have been moved since the last)
+    uint64_t round{0};
+    size_t busy{0};  //!< Workers that haven't finished this round
+    bool stopping{false};
+    //!@}
+
+    std::atomic<size_t> producing{0};  //!< Workers still routing the datagrams they received this round
+
+    std::vector<std::thread> threads{};
+
+    Parallel(const size_t workers, const size_t ring_capacity)
+        : n_threads(workers), ring_size(ring_capacity), scratch(workers) {}
+
+    ~Parallel() {
+        {
+            lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    Parallel(const Parallel &) = delete;
+    Parallel &operator=(const Parallel &) = delete;
+
+    void worker_main(const size_t worker) {
+        uint64_t seen = 0;
+        while (true) {
+            Router *current;
+            {
+                unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping or round != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = round;
+                current = router;
+            }
+
+            current->worker_round(worker);
+
+            {
+                lock_guard<std::mutex> lock(mutex);
+                if (--busy == 0) {
+                    done.notify_all();
+                }
+            }
+        }
+    }
+};
+
+Router::Router(const RouterConfig &config)
+    : _rules_table()
+    , _burst_size(config.burst_size)
+    , _parallel(config.threads > 0 ? make_unique<Parallel>(config.threads, config.transmit_ring_size) : nullptr) {
+    if (config.route_cache_slots > 0 and not _parallel) {
+        // slot的数量取2的幂（至少2个），用乘法哈希的高位作为下标
+        unsigned bits = 1;
+        while ((size_t(1) << bits) < config.route_cache_slots) {
+            bits++;
+        }
+        _route_cache.resize(size_t(1) << bits);
+        _route_cache_shift = 64 - bits;
+    }
+}
+
+Router::~Router() = default;
+Router::Router(Router &&other) noexcept = default;
+Router &Router::operator=(Router &&other) noexcept = default;
+
+void Router::invalidate_route_cache() {
+    // generation回绕到0之前，真正清空一次缓存，避免很久以前的表项重新变得有效
+    if (++_generation == 0) {
+        fill(_route_cache.begin(), _route_cache.end(), CachedRoute{});
+        _generation = 1;
+    }
+}
+
 //! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
 //! \param[in] prefix_length For this route to be applicable, how many high-order (most-significant) bits of the route_prefix will need to match the corresponding bits of the datagram's destination address?
 //! \param[in] next_hop The IP address of the next hop. Will be empty if the network is directly attached to the router (in which case, the next hop address should be the datagram's final destination).
@@ -30,37 +167,112 @@ void Router::add_route(const uint32_t route_prefix,
          << " => " << (next_hop.has_value() ? next_hop->ip() : "(direct)") << " on interface " << interface_num << "\n";
 
     // Your code here.
-    Rule route_rule(route_prefix, prefix_length, next_hop, interface_num);
-    _rules_table.push_back(route_rule);
-    return;
+    insert_rule(Rule(route_prefix, prefix_length, next_hop, interface_num), true);
+}
+
+void Router::add_equal_cost_route(const uint32_t route_prefix,
+                                  const uint8_t prefix_length,
+                                  const optional<Address> next_hop,
+                                  const size_t interface_num) {
+    cerr << "DEBUG: adding equal-cost route " << Address::from_ipv4_numeric(route_prefix).ip() << "/"
+         << int(prefix_length) << " => " << (next_hop.has_value() ? next_hop->ip() : "(direct)") << " on interface "
+         << interface_num << "\n";
+
+    insert_rule(Rule(route_prefix, prefix_length, next_hop, interface_num), false);
+}
+
+void Router::insert_rule(const Rule &route_rule, const bool replace) {
+    // 多线程时，worker用的是路由表的快照，这里改的是主表
+    unique_lock<mutex> lock;
+    if (_parallel) {
+        lock = unique_lock<mutex>(_parallel->table_mutex);
+        _parallel->table_changed = true;
+    }
+
+    invalidate_route_cache();
+
+    // 同一个前缀再次加入时，替换原来的规则，或者加入到等价的规则中（已经有同样的规则时不变）
+    const optional<uint32_t> existing = _lpm.find(route_rule.route_prefix(), route_rule.prefix_length());
+    if (existing) {
+        _rules_snapshots.changed(*existing);
+        vector<Rule> &routes = _rules_table[*existing];
+        if (replace) {
+            routes.assign(1, route_rule);
+        } else if (none_of(routes.begin(), routes.end(), [&](const Rule &rule) {
+                       return rule.next_hop() == route_rule.next_hop() and
+                              rule.interface_num() == route_rule.interface_num();
+                   })) {
+            routes.push_back(route_rule);
+        }
+        return;
+    }
+
+    size_t index = _rules_table.size();
+    if (not _free_rules.empty()) {
+        index = _free_rules.back();
+        _free_rules.pop_back();
+        _rules_snapshots.changed(index);
+        _rules_table[index].assign(1, route_rule);
+    } else {
+        _rules_table.push_back({route_rule});
+    }
+    _lpm.insert(route_rule.route_prefix(), route_rule.prefix_length(), index);
+}
+
+bool Router::remove_route(const uint32_t route_prefix, const uint8_t prefix_length) {
+    unique_lock<mutex> lock;
+    if (_parallel) {
+        lock = unique_lock<mutex>(_parallel->table_mutex);
+    }
+
+    const optional<uint32_t> existing = _lpm.find(route_prefix, prefix_length);
+    if (not existing) {
+        return false;
+    }
+
+    if (_parallel) {
+        _parallel->table_changed = true;
+    }
+    invalidate_route_cache();
+    _lpm.erase(route_prefix, prefix_length);
+    _rules_snapshots.changed(*existing);
+    _rules_table[*existing].clear();
+    _free_rules.push_back(*existing);
+    return true;
 }
 
 //! \param[in] dgram The datagram to be routed
 void Router::route_one_datagram(InternetDatagram &dgram) {
     // Your code here.
 
+    // 转发只需要ttl和dst：直接从收到的header字节中读取，不用解码整个header
+    const IPv4HeaderView &header = dgram.header_view();
+
     // 当datagram的ttl已经为0、或者这一次转发之后将降到0时，
     // 需要丢弃掉这个datagram
-    if ((dgram.header().ttl == 0) || (dgram.header().ttl == 1)) {
+    if ((header.ttl() == 0) || (header.ttl() == 1)) {
         return;
     }
 
-    dgram.header().ttl -= 1;
-
-    uint32_t dst_ip = dgram.header().dst;
+    // 增量地更新校验和（RFC 1624），而不是在发送时重新计算
+    dgram.decrement_ttl();
 
-    std::optional<uint64_t> matched_rule_num(std::nullopt);
+    uint32_t dst_ip = header.dst();
 
-    for (uint64_t i = 0; i < _rules_table.size(); i++) {
-        if (match(_rules_table[i].route_prefix(), _rules_table[i].prefix_length(), dst_ip)) {
-            if (!matched_rule_num) {
-                matched_rule_num = i;
-            } else if (_rules_table[i].prefix_length() > _rules_table[*matched_rule_num].prefix_length()) {
-                matched_rule_num = i;
-            }
+    // 先查路由缓存：命中时直接得到出口网卡和下一跳
+    CachedRoute *cached = route_cache_slot(dst_ip);
+    if (cached) {
+        if (cached->generation == _generation and cached->destination == dst_ip) {
+            _counters.route_cache_hits++;
+            _interfaces[cached->interface_num].send_datagram(dgram, Address::from_ipv4_numeric(cached->next_hop));
+            return;
         }
+        _counters.route_cache_misses++;
     }
 
+    // 最长前缀匹配：查LPMTable，最多三次访存，与规则的数量无关
+    const optional<uint32_t> matched_rule_num = _lpm.lookup(dst_ip);
+
     // 没有匹配的路由规则，
     // 选择丢弃该datagram
     if (!matched_rule_num) {
@@ -70,18 +282,235 @@ void Router::route_one_datagram(InternetDatagram &dgram) {
     // 确定下一跳ip地址：
     //   当路由规则中有指定的下一跳地址时，使用该地址；
     //   否则认为下一跳地址位于路由规则对应网卡所在的目标子网中，以datagram中的目的地址作为下一跳地址
-    Address next_hop("0.0.0.0");
-    if (_rules_table[*matched_rule_num].next_hop()) {
-        next_hop = *(_rules_table[*matched_rule_num].next_hop());
-    } else {
-        next_hop = next_hop.from_ipv4_numeric(dgram.header().dst);
+    // 有多条等价的规则时，按datagram所属的flow选择其中一条；这样的路由不能按目的地址缓存
+    const vector<Rule> &routes = _rules_table[*matched_rule_num];
+    const Rule &rule = choose_route(routes, dgram);
+    const uint32_t next_hop = rule.next_hop() ? rule.next_hop()->ipv4_numeric() : dst_ip;
+
+    if (cached and routes.size() == 1) {
+        *cached = {dst_ip, _generation, uint32_t(rule.interface_num()), next_hop};
     }
 
-    _interfaces[_rules_table[*matched_rule_num].interface_num()].send_datagram(dgram, next_hop);
+    _interfaces[rule.interface_num()].send_datagram(dgram, Address::from_ipv4_numeric(next_hop));
     return;
 }
 
+//! \details Each burst goes through the same steps as route_one_datagram(), but one step at a time for
+//! the whole burst: TTL check, route cache, one LPMTable lookup for all the cache misses, then a stable
+//! grouping by egress interface so that each interface gets a single send_datagrams() call.
+void Router::route_burst(queue<InternetDatagram> &queue) {
+    Burst &b = _burst;
+    while (not queue.empty()) {
+        // 取出一个burst，同时丢弃ttl耗尽的datagram
+        b.datagrams.clear();
+        for (size_t i = 0; i < _burst_size and not queue.empty(); i++) {
+            InternetDatagram &dgram = queue.front();
+            const uint8_t ttl = dgram.header_view().ttl();
+            if (ttl > 1) {
+                dgram.decrement_ttl();
+                b.datagrams.push_back(move(dgram));
+            }
+            queue.pop();
+        }
+        const size_t n = b.datagrams.size();
+
+        // 查路由缓存，不命中的留给LPMTable一起查
+        b.egress.resize(n);
+        b.next_hops.resize(n);
+        b.misses.clear();
+        b.miss_dsts.clear();
+        for (uint32_t i = 0; i < n; i++) {
+            const uint32_t dst = b.datagrams[i].header_view().dst();
+            const CachedRoute *cached = route_cache_slot(dst);
+            if (cached) {
+                if (cached->generation == _generation and cached->destination == dst) {
+                    _counters.route_cache_hits++;
+                    b.egress[i] = cached->interface_num;
+                    b.next_hops[i] = cached->next_hop;
+                    continue;
+                }
+                _counters.route_cache_misses++;
+            }
+            b.misses.push_back(i);
+            b.miss_dsts.push_back(dst);
+        }
+
+        b.miss_rules.resize(b.misses.size());
+        _lpm.lookup(b.miss_dsts.data(), b.miss_rules.data(), b.misses.size());
+        for (size_t j = 0; j < b.misses.size(); j++) {
+            const uint32_t i = b.misses[j];
+            const uint32_t dst = b.miss_dsts[j];
+            if (not b.miss_rules[j]) {
+                b.egress[i] = NO_ROUTE;
+                continue;
+            }
+
+            const vector<Rule> &routes = _rules_table[*b.miss_rules[j]];
+            const Rule &rule = choose_route(routes, b.datagrams[i]);
+            b.egress[i] = rule.interface_num();
+            b.next_hops[i] = rule.next_hop() ? rule.next_hop()->ipv4_numeric() : dst;
+            CachedRoute *cached = route_cache_slot(dst);
+            if (cached and routes.size() == 1) {
+                *cached = {dst, _generation, b.egress[i], b.next_hops[i]};
+            }
+        }
+
+        // 按出口网卡分组（计数排序，组内保持原来的顺序），每个网卡只调用一次
+        b.group_end.assign(_interfaces.size() + 1, 0);
+        for (size_t i = 0; i < n; i++) {
+            if (b.egress[i] != NO_ROUTE) {
+                b.group_end[b.egress[i] + 1]++;
+            }
+        }
+        for (size_t e = 1; e <= _interfaces.size(); e++) {
+            b.group_end[e] += b.group_end[e - 1];
+        }
+        b.grouped.resize(b.group_end.back());
+        b.grouped_hops.resize(b.group_end.back());
+        for (size_t i = 0; i < n; i++) {
+            if (b.egress[i] != NO_ROUTE) {
+                const size_t position = b.group_end[b.egress[i]]++;
+                b.grouped[position] = &b.datagrams[i];
+                b.grouped_hops[position] = b.next_hops[i];
+            }
+        }
+
+        // 现在group_end[e]是第e组的结尾，也就是第e+1组的开头
+        size_t start = 0;
+        for (size_t e = 0; e < _interfaces.size(); e++) {
+            if (b.group_end[e] > start) {
+                _interfaces[e].send_datagrams(&b.grouped[start], &b.grouped_hops[start], b.group_end[e] - start);
+            }
+            start = b.group_end[e];
+        }
+    }
+}
+
+void Router::route_parallel() {
+    Parallel &p = *_parallel;
+
+    // 路由表变过的话，发布一个新的快照。旧的快照在最后一个使用者放开它时释放
+    {
+        lock_guard<mutex> lock(p.table_mutex);
+        if (p.table_changed) {
+            p.snapshot =
+                make_shared<const RouteTable>(RouteTable{_rules_snapshots.take(_rules_table), _lpm.snapshot()});
+            p.table_changed = false;
+        }
+    }
+
+    // 每个网卡一个发送环；worker线程在第一次route()时才启动
+    while (p.rings.size() < _interfaces.size()) {
+        p.rings.push_back(make_unique<MPSCRing<Parallel::Transmit>>(p.ring_size));
+    }
+    while (p.threads.size() < p.n_threads) {
+        p.threads.emplace_back(&Parallel::worker_main, &p, p.threads.size());
+    }
+
+    p.producing.store(p.n_threads, memory_order_relaxed);
+    {
+        lock_guard<mutex> lock(p.mutex);
+        p.router = this;
+        p.busy = p.n_threads;
+        p.round++;
+    }
+    p.wake.notify_all();
+
+    unique_lock<mutex> lock(p.mutex);
+    p.done.wait(lock, [&] { return p.busy == 0; });
+}
+
+//! \details A worker first routes everything its interfaces received, pushing each datagram onto the
+//! ring of its egress interface, and then keeps sending what arrives on its own interfaces' rings until
+//! every worker has finished routing. When a ring is full, the producer sends from its own rings while it
+//! waits, so two workers that fill each other's rings can't wait on each other forever.
+void Router::worker_round(const size_t worker) {
+    Parallel &p = *_parallel;
+    const RouteTable &table = *p.snapshot;
+
+    for (size_t i = worker; i < _interfaces.size(); i += p.n_threads) {
+        auto &queue = _interfaces[i].datagrams_out();
+        for (size_t routed = 1; not queue.empty(); routed++) {
+            Parallel::Transmit transmit{move(queue.front()), 0};
+            queue.pop();
+
+            const IPv4HeaderView &header = transmit.dgram.header_view();
+            if (header.ttl() <= 1) {
+                continue;
+            }
+            transmit.dgram.decrement_ttl();
+
+            const uint32_t dst = header.dst();
+            const optional<uint32_t> matched_rule_num = table.lpm.lookup(dst);
+            if (not matched_rule_num) {
+                continue;
+            }
+            const Rule &rule = choose_route(table.rules[*matched_rule_num], transmit.dgram);
+            transmit.next_hop = rule.next_hop() ? rule.next_hop()->ipv4_numeric() : dst;
+
+            while (not p.rings[rule.interface_num()]->push(move(transmit))) {
+                worker_transmit(worker);
+                this_thread::yield();
+            }
+
+            // 不时地发送一下自己的环，免得别的worker因为环满而等待
+            if (routed % 64 == 0) {
+                worker_transmit(worker);
+            }
+        }
+    }
+
+    // 所有worker都不再生产之后，再把自己的环清空一次
+    p.producing.fetch_sub(1, memory_order_release);
+    while (true) {
+        const bool last = p.producing.load(memory_order_acquire) == 0;
+        worker_transmit(worker);
+        if (last) {
+            break;
+        }
+        this_thread::yield();
+    }
+}
+
+void Router::worker_transmit(const size_t worker) {
+    Parallel &p = *_parallel;
+    Parallel::Scratch &s = p.scratch[worker];
+
+    for (size_t e = worker; e < _interfaces.size(); e += p.n_threads) {
+        s.batch.clear();
+        Parallel::Transmit transmit;
+        while (p.rings[e]->pop(transmit)) {
+            s.batch.push_back(move(transmit));
+        }
+        if (s.batch.empty()) {
+            continue;
+        }
+
+        s.dgrams.clear();
+        s.next_hops.clear();
+        for (const auto &t : s.batch) {
+            s.dgrams.push_back(&t.dgram);
+            s.next_hops.push_back(t.next_hop);
+        }
+        _interfaces[e].send_datagrams(s.dgrams.data(), s.next_hops.data(), s.batch.size());
+    }
+}
+
 void Router::route() {
+    // 多线程模式：每个网卡由一个worker线程负责
+    if (_parallel) {
+        route_parallel();
+        return;
+    }
+
+    // 批量模式：每个网卡的datagram按burst处理
+    if (_burst_size > 0) {
+        for (auto &interface : _interfaces) {
+            route_burst(interface.datagrams_out());
+        }
+        return;
+    }
+
     // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface.
     for (auto &interface : _interfaces) {
         auto &queue = interface.datagrams_out();
@@ -91,13 +520,3 @@ void Router::route() {
         }
     }
 }
-
-bool Router::match(const uint32_t &route_prefix, const uint8_t &prefix_length, const uint32_t &ip) {
-    if (prefix_length == 0) {
-        return true;
-    } else if ((route_prefix >> (32 - prefix_length)) == (ip >> (32 - prefix_length))) {
-        return true;
-    } else {
-        return false;
-    }
-}
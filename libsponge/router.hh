@@ -1,8 +1,11 @@
 #ifndef SPONGE_LIBSPONGE_ROUTER_HH
 #define SPONGE_LIBSPONGE_ROUTER_HH
 
+#include "lpm_table.hh"
 #include "network_interface.hh"
+#include "vector_snapshots.hh"
 
+#include <memory>
 #include <optional>
 #include <queue>
 
@@ -17,10 +20,10 @@ class Rule {
     Rule(const uint32_t &prefix, const uint8_t prefix_len, const std::optional<Address> &hop_ip, const size_t &if_num)
         : _route_prefix(prefix), _prefix_length(prefix_len), _next_hop(hop_ip), _interface_num(if_num){};
 
-    const uint32_t &route_prefix() { return _route_prefix; };
-    const uint8_t &prefix_length() { return _prefix_length; };
-    const std::optional<Address> &next_hop() { return _next_hop; };
-    const size_t &interface_num() { return _interface_num; };
+    const uint32_t &route_prefix() const { return _route_prefix; };
+    const uint8_t &prefix_length() const { return _prefix_length; };
+    const std::optional<Address> &next_hop() const { return _next_hop; };
+    const size_t &interface_num() const { return _interface_num; };
 };
 
 //! \brief A wrapper for NetworkInterface that makes the host-side
@@ -51,12 +54,52 @@ class AsyncNetworkInterface : public NetworkInterface {
         }
     };
 
+    //! \brief Receives a burst of Ethernet frames, as if by recv_frame() on each in turn
+    //! \details See NetworkInterface::recv_frames().
+    void recv_frames(const EthernetFrame *frames, const size_t count) {
+        NetworkInterface::recv_frames(frames, count, _datagrams_out);
+    }
+
     //! Access queue of Internet datagrams that have been received
     std::queue<InternetDatagram> &datagrams_out() { return _datagrams_out; }
 };
 
+//! Config for Router
+class RouterConfig {
+  public:
+    static constexpr size_t ROUTE_CACHE_DFLT = 0;  //!< Default size of the route cache (none)
+
+    //! \brief Slots in the per-destination route cache, rounded up to a power of two (0 for no cache)
+    //! \details The cache is direct-mapped by destination address, and is emptied by every change to the routes.
+    size_t route_cache_slots = ROUTE_CACHE_DFLT;
+
+    static constexpr size_t BURST_DFLT = 0;  //!< Default burst size (route one datagram at a time)
+
+    //! \brief Datagrams that route() takes from an interface at once (0 to route them one at a time)
+    //! \details A burst is looked up in the routing table together, and each interface is handed
+    //! the datagrams it should send in one call. Each interface still sends in the order received.
+    size_t burst_size = BURST_DFLT;
+
+    static constexpr size_t RING_DFLT = 1024;  //!< Default capacity of each interface's transmit ring
+
+    //! \brief Worker threads that route() uses (0 to route on the calling thread)
+    //! \details Interface `i` is owned by worker `i % threads`, which routes the datagrams it received and
+    //! sends the datagrams routed to it. Workers hand datagrams to each other through a lock-free ring per
+    //! interface. The route cache and #burst_size aren't used in this mode.
+    size_t threads = 0;
+    size_t transmit_ring_size = RING_DFLT;  //!< Capacity of each interface's transmit ring, with #threads
+};
+
+//! Counts of what Router has done (they only ever go up)
+struct RouterCounters {
+    uint64_t route_cache_hits = 0;    //!< Datagrams whose route was found in the route cache
+    uint64_t route_cache_misses = 0;  //!< Datagrams whose route was looked up in the table instead
+};
+
 //! \brief A router that has multiple network interfaces and
 //! performs longest-prefix-match routing between them.
+//! \details Each interface has its own MTU (see NetworkInterface::set_mtu()), and fragments the datagrams
+//! routed to it that are longer than that.
 class Router {
     //! The router's collection of network interfaces
     std::vector<AsyncNetworkInterface> _interfaces{};
@@ -66,11 +109,99 @@ class Router {
     //! datagram's destination address.
     void route_one_datagram(InternetDatagram &dgram);
 
-    // 路由规则表
-    std::vector<Rule> _rules_table;
+    // 路由规则表：每个前缀对应一组等价的规则（通常只有一条），按flow的哈希从中选择
+    std::vector<std::vector<Rule>> _rules_table;
+
+    //! Index into #_rules_table of the rules for each prefix, for longest-prefix matching
+    LPMTable _lpm{};
+
+    //! Slots of #_rules_table freed by remove_route(), to be reused
+    std::vector<size_t> _free_rules{};
+
+    //! Snapshots of #_rules_table (only with RouterConfig::threads); rules changed in place are noted here
+    VectorSnapshots<std::vector<Rule>, 10> _rules_snapshots{};
+
+    //! Add `rule` to the routes for its prefix, or (if `replace`) make it the prefix's only route
+    void insert_rule(const Rule &rule, const bool replace);
+
+    //! Where datagrams to one destination were last sent (only for prefixes with a single route)
+    struct CachedRoute {
+        uint32_t destination{};
+        uint32_t generation{};  //!< The entry is only valid while this equals #_generation
+        uint32_t interface_num{};
+        uint32_t next_hop{};
+    };
+
+    // 路由缓存：按目的地址直接映射，每个目的地址只能放在一个slot里
+    std::vector<CachedRoute> _route_cache{};
+    unsigned _route_cache_shift{0};
+
+    //! Bumped by every change to the routes, so that every entry in #_route_cache becomes stale at once
+    uint32_t _generation{1};
+
+    RouterCounters _counters{};
+
+    //! Make every entry in #_route_cache stale
+    void invalidate_route_cache();
+
+    //! The #_route_cache slot for `dst`, or nullptr if there's no cache
+    CachedRoute *route_cache_slot(const uint32_t dst) {
+        if (_route_cache.empty()) {
+            return nullptr;
+        }
+        return &_route_cache[(uint64_t(dst) * 0x9e3779b97f4a7c15ull) >> _route_cache_shift];
+    }
+
+    size_t _burst_size;
+
+    //! Scratch space for route_burst(), kept to avoid allocating for every burst
+    struct Burst {
+        std::vector<InternetDatagram> datagrams{};
+        std::vector<uint32_t> egress{};     //!< Interface each datagram goes out of (or NO_ROUTE)
+        std::vector<uint32_t> next_hops{};  //!< Next hop of each datagram
+        std::vector<uint32_t> misses{};     //!< Datagrams not in the route cache
+        std::vector<uint32_t> miss_dsts{};  //!< Their destinations
+        std::vector<std::optional<uint32_t>> miss_rules{};
+        std::vector<size_t> group_end{};  //!< Where each interface's datagrams end in `grouped`
+        std::vector<const InternetDatagram *> grouped{};
+        std::vector<uint32_t> grouped_hops{};
+    } _burst{};
+
+    //! Route up to RouterConfig::burst_size datagrams at a time from `queue` until it's empty
+    void route_burst(std::queue<InternetDatagram> &queue);
+
+    //! The rules and the LPM lookup structure as of some moment, shared read-only by the worker threads
+    //! \details Each shares the parts that haven't changed with the previous RouteTable.
+    struct RouteTable {
+        VectorSnapshots<std::vector<Rule>, 10>::Snapshot rules;
+        LPMTable::Snapshot lpm;
+    };
+
+    //! Worker threads and what they share (only with RouterConfig::threads)
+    struct Parallel;
+    std::unique_ptr<Parallel> _parallel;
+
+    //! route() on the worker threads
+    void route_parallel();
+
+    //! Worker `worker`'s part of route_parallel()
+    void worker_round(const size_t worker);
+
+    //! Send what has been routed to worker `worker`'s interfaces
+    void worker_transmit(const size_t worker);
 
   public:
-    Router() : _rules_table() {}
+    explicit Router(const RouterConfig &config = RouterConfig{});
+
+    //! Stops the worker threads, if any
+    ~Router();
+
+    //! \name
+    //! A Router can be moved, but not while route() is running
+    //!@{
+    Router(Router &&other) noexcept;
+    Router &operator=(Router &&other) noexcept;
+    //!@}
 
     //! Add an interface to the router
     //! \param[in] interface an already-constructed network interface
@@ -83,16 +214,32 @@ class Router {
     //! Access an interface by index
     AsyncNetworkInterface &interface(const size_t N) { return _interfaces.at(N); }
 
-    //! Add a route (a forwarding rule)
+    //! \brief Add a route (a forwarding rule)
+    //! \note With RouterConfig::threads, routes can be added and removed from another thread while route()
+    //! runs. Each route() routes with a snapshot of the routes taken as it starts.
     void add_route(const uint32_t route_prefix,
                    const uint8_t prefix_length,
                    const std::optional<Address> next_hop,
                    const size_t interface_num);
 
+    //! \brief Add another route for a prefix, of equal cost to the ones it already has (or its first)
+    //! \details Datagrams matching the prefix are spread over its routes by IPv4Datagram::flow_hash(), so
+    //! that each TCP connection stays on one route. add_route() replaces all of a prefix's routes with one.
+    //! Adding a route the prefix already has changes nothing.
+    void add_equal_cost_route(const uint32_t route_prefix,
+                              const uint8_t prefix_length,
+                              const std::optional<Address> next_hop,
+                              const size_t interface_num);
+
+    //! Remove the routes for exactly `route_prefix`/`prefix_length`
+    //! \returns whether there were such routes
+    bool remove_route(const uint32_t route_prefix, const uint8_t prefix_length);
+
     //! Route packets between the interfaces
     void route();
 
-    bool match(const uint32_t &route_prefix, const uint8_t &prefix_length, const uint32_t &dst_ip);
+    //! \brief Counts of route cache hits and misses
+    const RouterCounters &counters() const { return _counters; }
 };
 
 #endif  // SPONGE_LIBSPONGE_ROUTER_HH
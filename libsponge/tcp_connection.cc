@@ -21,68 +21,141 @@ size_t TCPConnection::unassembled_bytes() const { return _receiver.unassembled_b
 size_t TCPConnection::time_since_last_segment_received() const { return _time_since_last_segment_received; }
 
 void TCPConnection::segment_received(const TCPSegment &seg) {
-    // 当前连接已关闭
-    if (!_active_flag) {
-        return;
-    }
-
-    // 接收到RST -> 关闭连接
-    if (seg.header().rst) {
-        _sender.stream_in().set_error();
-        _receiver.stream_out().set_error();
-        _linger_after_streams_finish = false;
-        _active_flag = false;
-        return;
+    const TCPHeader &header = seg.header();
+
+    // 先根据当前状态决定这个segment是否应该被处理
+    switch (_state) {
+        case TCPState::State::LISTEN:
+            // 只有SYN能打开连接，RST和其他segment一律忽略
+            if (not header.syn or header.rst) {
+                return;
+            }
+            break;
+        case TCPState::State::SYN_SENT:
+            // 还没有收到对方的SYN：
+            //   确认了我方SYN的RST -> 关闭连接（不回复RST）
+            //   其余不带SYN的segment -> 忽略
+            if (header.rst) {
+                if (header.ack and header.ackno == _sender.next_seqno()) {
+                    _state = TCPState::State::RESET;
+                    _sender.stream_in().set_error();
+                    _receiver.stream_out().set_error();
+                }
+                return;
+            }
+            if (not header.syn) {
+                return;
+            }
+            break;
+        case TCPState::State::CLOSED:
+        case TCPState::State::RESET:
+            // 当前连接已关闭
+            return;
+        default:
+            // 接收到RST -> 关闭连接
+            if (header.rst) {
+                _state = TCPState::State::RESET;
+                _sender.stream_in().set_error();
+                _receiver.stream_out().set_error();
+                return;
+            }
+            break;
     }
 
     _time_since_last_segment_received = 0;
     _receiver.segment_received(seg);
 
-    if (seg.header().fin) {
-        _inbound_fin_received = true;
+    if (header.ack) {
+        _sender.ack_received(header.ackno, header.win);
     }
 
-    if (_inbound_fin_received) {
-        if (_receiver.unassembled_bytes() == 0) {
-            // 接收到了fin，并且接收到的所有segment都已经assemble
-            _inbound_assembled = true;
+    // 被动打开：回复SYN/ACK
+    if (_state == TCPState::State::LISTEN) {
+        _sender.fill_window();
+    }
 
-            if (!_outbound_fin_sent) {
-                _linger_after_streams_finish = false;
-            }
-            if (_outbound_fin_sent && _outbound_fin_acked && !_linger_after_streams_finish) {
-                _active_flag = false;
-            }
-        }
+    _transition_on_segment();
+
+    // 占用了sequence space的segment需要回复ack
+    if (active() and _sender.segments_out().empty() and seg.length_in_sequence_space() != 0) {
+        _sender.send_empty_segment();
     }
+    send_segments();
+}
 
-    if (seg.header().ack) {
-        _sender.ack_received(seg.header().ackno, seg.header().win);
-        // 当sender发出一个fin之后，
-        // next_seqno不会再被更新，
-        // 可以以next_seqno - 1作为fin的seqno
-        if (_outbound_fin_sent && _sender.bytes_in_flight() == 0) {
-            // 发出的fin已经被ack了
-            _outbound_fin_acked = true;
-            if (_inbound_fin_received && _inbound_assembled) {
-                if (!_lingered_time && _linger_after_streams_finish) {
-                    _lingered_time = 0;
-                } else if (!_linger_after_streams_finish) {
-                    _active_flag = false;
-                }
+void TCPConnection::_transition_on_segment() {
+    const bool syn_acked = _sender.next_seqno_absolute() > _sender.bytes_in_flight();
+    const bool all_acked = _sender.bytes_in_flight() == 0;
+    const bool inbound_ended = _receiver.stream_out().input_ended();
+
+    // 每个case只检查当前状态下可能发生的转移，
+    // 如果一次转移之后还能继续转移（比如SYN/ACK与FIN一起到达），则fallthrough到下一个状态
+    switch (_state) {
+        case TCPState::State::LISTEN:
+            _state = TCPState::State::SYN_RCVD;
+            break;
+        case TCPState::State::SYN_SENT:
+            if (not syn_acked) {
+                // 同时打开
+                _state = TCPState::State::SYN_RCVD;
+                break;
             }
-        }
+            _state = TCPState::State::ESTABLISHED;
+            [[fallthrough]];
+        case TCPState::State::ESTABLISHED:
+            if (inbound_ended) {
+                _state = TCPState::State::CLOSE_WAIT;
+            }
+            break;
+        case TCPState::State::SYN_RCVD:
+            if (syn_acked) {
+                _state = inbound_ended ? TCPState::State::CLOSE_WAIT : TCPState::State::ESTABLISHED;
+            }
+            break;
+        case TCPState::State::FIN_WAIT_1:
+            if (all_acked) {
+                _state = inbound_ended ? TCPState::State::TIME_WAIT : TCPState::State::FIN_WAIT_2;
+            } else if (inbound_ended) {
+                _state = TCPState::State::CLOSING;
+            }
+            break;
+        case TCPState::State::FIN_WAIT_2:
+            if (inbound_ended) {
+                _state = TCPState::State::TIME_WAIT;
+            }
+            break;
+        case TCPState::State::CLOSING:
+            if (all_acked) {
+                _state = TCPState::State::TIME_WAIT;
+            }
+            break;
+        case TCPState::State::LAST_ACK:
+            if (all_acked) {
+                _state = TCPState::State::CLOSED;
+            }
+            break;
+        default:
+            break;
     }
-    if (seg.header().syn && _sender.next_seqno_absolute() == 0) {
-        _sender.fill_window();
+}
+
+void TCPConnection::_transition_on_send(const TCPHeader &header) {
+    if (header.syn and _state == TCPState::State::LISTEN) {
+        // 主动打开
+        _state = TCPState::State::SYN_SENT;
     }
-    if (_active_flag && _sender.segments_out().empty() && seg.length_in_sequence_space() != 0) {
-        _sender.send_empty_segment();
+    if (header.fin) {
+        if (_state == TCPState::State::ESTABLISHED or _state == TCPState::State::SYN_RCVD) {
+            _state = TCPState::State::FIN_WAIT_1;
+        } else if (_state == TCPState::State::CLOSE_WAIT) {
+            _state = TCPState::State::LAST_ACK;
+        }
     }
-    send_segments();
 }
 
-bool TCPConnection::active() const { return _active_flag; }
+bool TCPConnection::active() const {
+    return _state != TCPState::State::CLOSED and _state != TCPState::State::RESET;
+}
 
 size_t TCPConnection::write(const string &data) {
     if (data.length() == 0) {
@@ -104,11 +177,11 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
         reset_connection();
     }
     send_segments();
-    if (_lingered_time) {
-        _lingered_time = *_lingered_time + ms_since_last_tick;
-        if (*_lingered_time >= 10 * _cfg.rt_timeout) {
-            _active_flag = false;
-        }
+
+    // TIME_WAIT：对方可能没有收到我方对其FIN的ack，
+    // 需要在10 * rt_timeout内没有再收到segment之后才能关闭连接
+    if (_state == TCPState::State::TIME_WAIT and _time_since_last_segment_received >= 10 * _cfg.rt_timeout) {
+        _state = TCPState::State::CLOSED;
     }
 }
 
@@ -144,10 +217,8 @@ void TCPConnection::send_segments() {
             seg.header().ack = true;
             seg.header().ackno = *(_receiver.ackno());
         }
-        if (seg.header().fin) {
-            _outbound_fin_sent = true;
-        }
         seg.header().win = _receiver.window_size();
+        _transition_on_send(seg.header());
         _segments_out.push(seg);
         _sender.segments_out().pop();
     }
@@ -161,7 +232,7 @@ void TCPConnection::reset_connection() {
     _sender.segments_out().back().header().rst = true;
     send_segments();
 
-    _active_flag = false;
+    _state = TCPState::State::RESET;
     _sender.stream_in().set_error();
     _receiver.stream_out().set_error();
 }
@@ -16,30 +16,19 @@ class TCPConnection {
     //! outbound queue of segments that the TCPConnection wants sent
     std::queue<TCPSegment> _segments_out{};
 
-    //! Should the TCPConnection stay active (and keep ACKing)
-    //! for 10 * _cfg.rt_timeout milliseconds after both streams have ended,
-    //! in case the remote TCPConnection doesn't know we've received its whole stream?
-    bool _linger_after_streams_finish{true};
-
     // 返回自从上一次接收到segment以来经过的时间
     uint64_t _time_since_last_segment_received;
 
-    // 当前tcp连接是否仍处于active状态
-    bool _active_flag;
-
-    // 输入流接收到了fin
-    bool _inbound_fin_received;
-
-    // 输入流接收到了fin，并且接收到的所有segment都已经assemble
-    bool _inbound_assembled;
-
-    // 输出流的fin标志已经发送
-    bool _outbound_fin_sent;
+    // 连接当前所处的状态（RFC 793中的状态名）
+    // 是否需要在两个流都结束后linger（即走TIME_WAIT还是CLOSE_WAIT/LAST_ACK）也由状态本身表示，
+    // segment_received()和send_segments()根据这个状态进行转移
+    TCPState::State _state;
 
-    // 输出流的fin已经被确认了
-    bool _outbound_fin_acked;
+    //! \brief Advance `_state` after an inbound segment has been processed by the sender and receiver
+    void _transition_on_segment();
 
-    std::optional<uint64_t> _lingered_time;
+    //! \brief Advance `_state` after an outbound segment carrying SYN and/or FIN has been sent
+    void _transition_on_send(const TCPHeader &header);
 
   public:
     //! \name "Input" interface for the writer
@@ -76,7 +65,7 @@ class TCPConnection {
     //! \brief Number of milliseconds since the last segment was received
     size_t time_since_last_segment_received() const;
     //!< \brief summarize the state of the sender, receiver, and the connection
-    TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
+    TCPState state() const { return _state; };
     //!@}
 
     //! \name Methods for the owner or operating system to call
@@ -102,14 +91,10 @@ class TCPConnection {
 
     //! Construct a new connection from a configuration
     explicit TCPConnection(const TCPConfig &cfg)
-        : _cfg{cfg}
-        , _time_since_last_segment_received(0)
-        , _active_flag(true)
-        , _inbound_fin_received(false)
-        , _inbound_assembled(false)
-        , _outbound_fin_sent(false)
-        , _outbound_fin_acked(false)
-        , _lingered_time(std::nullopt) {}
+        : _cfg{cfg}, _time_since_last_segment_received(0), _state(TCPState::State::LISTEN) {
+        _sender.stream_in().set_release_when_empty(_cfg.release_idle_buffers);
+        _receiver.stream_out().set_release_when_empty(_cfg.release_idle_buffers);
+    }
 
     //! \name construction and destruction
     //! moving is allowed; copying is disallowed; default construction not possible
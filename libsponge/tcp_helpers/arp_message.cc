@@ -9,7 +9,7 @@ using namespace std;
 ParseResult ARPMessage::parse(const Buffer buffer) {
     NetParser p{buffer};
 
-    if (p.buffer().size() < ARPMessage::LENGTH) {
+    if (p.size() < ARPMessage::LENGTH) {
         return ParseResult::PacketTooShort;
     }
 
@@ -50,24 +50,25 @@ string ARPMessage::serialize() const {
             "ARPMessage::serialize(): unsupported field combination (must be Ethernet/IP, and request or reply)");
     }
 
-    string ret;
-    NetUnparser::u16(ret, hardware_type);
-    NetUnparser::u16(ret, protocol_type);
-    NetUnparser::u8(ret, hardware_address_size);
-    NetUnparser::u8(ret, protocol_address_size);
-    NetUnparser::u16(ret, opcode);
+    string ret(LENGTH, 0);
+    char *out = ret.data();
+    NetUnparser::u16(out, hardware_type);
+    NetUnparser::u16(out, protocol_type);
+    NetUnparser::u8(out, hardware_address_size);
+    NetUnparser::u8(out, protocol_address_size);
+    NetUnparser::u16(out, opcode);
 
     /* write sender addresses */
     for (auto &byte : sender_ethernet_address) {
-        NetUnparser::u8(ret, byte);
+        NetUnparser::u8(out, byte);
     }
-    NetUnparser::u32(ret, sender_ip_address);
+    NetUnparser::u32(out, sender_ip_address);
 
     /* write target addresses */
     for (auto &byte : target_ethernet_address) {
-        NetUnparser::u8(ret, byte);
+        NetUnparser::u8(out, byte);
     }
-    NetUnparser::u32(ret, target_ip_address);
+    NetUnparser::u32(out, target_ip_address);
 
     return ret;
 }
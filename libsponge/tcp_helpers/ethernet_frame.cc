@@ -17,8 +17,10 @@ ParseResult EthernetFrame::parse(const Buffer buffer) {
 }
 
 BufferList EthernetFrame::serialize() const {
-    BufferList ret;
-    ret.append(_header.serialize());
-    ret.append(_payload);
+    Buffer::HeaderBytes header_bytes;
+    const size_t header_length = _header.serialize(header_bytes);
+
+    BufferList ret{_payload};
+    ret.prepend({header_bytes.data(), header_length});
     return ret;
 }
@@ -4,6 +4,8 @@
 #include "buffer.hh"
 #include "ethernet_header.hh"
 
+#include <utility>
+
 //! \brief Ethernet frame
 class EthernetFrame {
   private:
@@ -11,6 +13,11 @@ class EthernetFrame {
     BufferList _payload{};
 
   public:
+    EthernetFrame() = default;
+
+    //! \brief Construct a frame directly from its header and payload (nothing is copied or parsed)
+    EthernetFrame(const EthernetHeader &header, BufferList payload) : _header(header), _payload(std::move(payload)) {}
+
     //! \brief Parse the frame from a string
     ParseResult parse(const Buffer buffer);
 
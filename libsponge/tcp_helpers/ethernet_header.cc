@@ -8,7 +8,7 @@
 using namespace std;
 
 ParseResult EthernetHeader::parse(NetParser &p) {
-    if (p.buffer().size() < EthernetHeader::LENGTH) {
+    if (p.size() < EthernetHeader::LENGTH) {
         return ParseResult::PacketTooShort;
     }
 
@@ -28,24 +28,30 @@ ParseResult EthernetHeader::parse(NetParser &p) {
     return p.get_error();
 }
 
-string EthernetHeader::serialize() const {
-    string ret;
-    ret.reserve(LENGTH);
+//! \param[out] ret receives the serialized header
+size_t EthernetHeader::serialize(Buffer::HeaderBytes &ret) const {
+    char *out = ret.data();
 
     /* write destination address */
     for (auto &byte : dst) {
-        NetUnparser::u8(ret, byte);
+        NetUnparser::u8(out, byte);
     }
 
     /* write source address */
     for (auto &byte : src) {
-        NetUnparser::u8(ret, byte);
+        NetUnparser::u8(out, byte);
     }
 
     /* write the frame's type (e.g. IPv4, ARP or something else) */
-    NetUnparser::u16(ret, type);
+    NetUnparser::u16(out, type);
 
-    return ret;
+    return LENGTH;
+}
+
+Buffer EthernetHeader::serialize() const {
+    Buffer::HeaderBytes out;
+    const size_t length = serialize(out);
+    return {out, length};
 }
 
 //! \returns A string with a textual representation of an Ethernet address
@@ -30,8 +30,12 @@ struct EthernetHeader {
     //! Parse the Ethernet fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
-    //! Serialize the Ethernet fields to a string
-    std::string serialize() const;
+    //! Serialize the Ethernet fields into `out`
+    //! \returns the length of the header (#LENGTH bytes)
+    size_t serialize(Buffer::HeaderBytes &out) const;
+
+    //! Serialize the Ethernet fields
+    Buffer serialize() const;
 
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
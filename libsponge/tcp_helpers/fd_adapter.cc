@@ -27,14 +27,15 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
     }
 
     // is the payload a valid TCP segment?
-    TCPSegment seg;
-    if (ParseResult::NoError != seg.parse(move(datagram.payload), 0)) {
+    // （先只检查校验和与长度，决定要不要这个segment时只读需要的字段）
+    TCPHeaderView header;
+    if (ParseResult::NoError != header.parse(datagram.payload, 0)) {
         return {};
     }
 
     // should we target this source in all future replies?
     if (listening()) {
-        if (seg.header().syn and not seg.header().rst) {
+        if (header.syn() and not header.rst()) {
             config_mutable().destination = datagram.source_address;
             set_listening(false);
         } else {
@@ -42,7 +43,7 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
         }
     }
 
-    return seg;
+    return TCPSegment{header};
 }
 
 //! Serialize a TCP segment and send it as the payload of a UDP datagram.
@@ -3,14 +3,36 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
-ParseResult IPv4Datagram::parse(const Buffer buffer) {
+ParseResult IPv4Datagram::parse(const Buffer buffer, const bool verify_checksum) {
+    // 通常的情况：只检查长度、版本和校验和，header的各个字段等到用的时候再解码
+    if (_view.parse(buffer, verify_checksum) == ParseResult::NoError) {
+        _view_current = true;
+        _header_decoded = false;
+
+        Buffer payload = buffer;
+        payload.remove_prefix(4 * _view.hlen());
+        _payload = move(payload);
+        return ParseResult::NoError;
+    }
+
+    // 有问题的datagram：完整地解析。和原来一样，只有校验和错误的datagram仍然被接受
+    // （其他错误的header无法原样地重新序列化，直接拒绝）
+    _view_current = false;
+    _header_decoded = true;
+
     NetParser p{buffer};
-    _header.parse(p);
+    if (const ParseResult result = _header.parse(p);
+        result != ParseResult::NoError and result != ParseResult::BadChecksum) {
+        return result;
+    }
     _payload = p.buffer();
 
     if (_payload.size() != _header.payload_length()) {
@@ -20,22 +42,110 @@ ParseResult IPv4Datagram::parse(const Buffer buffer) {
     return p.get_error();
 }
 
+const IPv4Header &IPv4Datagram::header() const {
+    if (not _header_decoded) {
+        _header = _view.decode();
+        _header_decoded = true;
+    }
+    return _header;
+}
+
+IPv4Header &IPv4Datagram::header() {
+    as_const(*this).header();
+    _view_current = false;
+    return _header;
+}
+
+const IPv4HeaderView &IPv4Datagram::header_view() const {
+    if (not _view_current) {
+        _view = IPv4HeaderView(_header);
+        _view_current = true;
+    }
+    return _view;
+}
+
 BufferList IPv4Datagram::serialize() const {
-    if (_payload.size() != _header.payload_length()) {
+    const IPv4HeaderView &header_out = header_view();
+    if (_payload.size() != header_out.payload_length()) {
         throw runtime_error("IPv4Datagram::serialize: payload is wrong size");
     }
 
-    IPv4Header header_out = _header;
-    header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
+    // payload还有headroom时，header写在它前面
+    BufferList ret{_payload};
+    ret.prepend(header_out.bytes());
+    return ret;
+}
 
-    // calculate checksum -- taken over header only
-    InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
+void IPv4Datagram::decrement_ttl() {
+    // 只改header的字节（增量地更新校验和，RFC 1624）；已经解码的header也同步更新
+    if (_view_current) {
+        _view.decrement_ttl();
+    }
+    if (_header_decoded) {
+        _header.ttl--;
+        if (_view_current) {
+            _header.cksum = _view.cksum();
+        }
+    }
+}
 
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
-    return ret;
+// MurmurHash3的64位finalizer：输入的每一位都会影响输出的每一位
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+uint32_t IPv4Datagram::flow_hash() const {
+    const IPv4HeaderView &header = header_view();
+
+    // TCP和UDP的源端口、目的端口是payload的前4个字节（可能跨越几个Buffer）
+    uint32_t ports = 0;
+    const bool fragment = header.mf() or header.offset() != 0;
+    if ((header.proto() == IPv4Header::PROTO_TCP or header.proto() == IPv4Header::PROTO_UDP) and not fragment and
+        _payload.size() >= 4) {
+        size_t copied = 0;
+        for (const Buffer &buffer : _payload.buffers()) {
+            const string_view bytes = buffer.str();
+            for (size_t i = 0; i < bytes.size() and copied < 4; i++, copied++) {
+                ports = ports << 8 | uint8_t(bytes[i]);
+            }
+        }
+    }
+
+    const uint64_t addresses = uint64_t(header.src()) << 32 | header.dst();
+    return uint32_t(mix64(mix64(addresses) ^ (uint64_t(header.proto()) << 32 | ports)) >> 32);
+}
+
+vector<IPv4Datagram> IPv4Datagram::fragment(const size_t mtu) const {
+    const IPv4Header &original = header();
+    if (original.len <= mtu) {
+        return {*this};
+    }
+
+    // 除了最后一个分片，每个分片的数据长度都必须是8字节的整数倍
+    const size_t header_length = 4 * original.hlen;
+    const size_t max_data = mtu > header_length ? (mtu - header_length) / 8 * 8 : 0;
+    if (original.df or max_data == 0) {
+        return {};
+    }
+
+    const string payload = _payload.concatenate();
+    vector<IPv4Datagram> fragments;
+    for (size_t start = 0; start < payload.size(); start += max_data) {
+        const size_t length = min(max_data, payload.size() - start);
+
+        // 分片本身也可能是分片：偏移量在原来的基础上累加，原来的MF标志留给最后一个分片
+        IPv4Datagram piece;
+        piece.header() = original;
+        piece.header().offset = original.offset + start / 8;
+        piece.header().mf = original.mf or start + length < payload.size();
+        piece.header().len = header_length + length;
+        piece.payload() = Buffer(payload.substr(start, length));
+        fragments.push_back(move(piece));
+    }
+    return fragments;
 }
@@ -4,23 +4,54 @@
 #include "buffer.hh"
 #include "ipv4_header.hh"
 
+#include <vector>
+
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram
+//! A parsed datagram only decodes its header when header() is called. Until then (or until the header
+//! is modified), header_view(), decrement_ttl() and serialize() work on the header's bytes as received.
 class IPv4Datagram {
   private:
-    IPv4Header _header{};
+    //! \name The header, in either or both of two forms
+    //! At least one of them is always up to date; the other is made from it when needed.
+    //!@{
+    mutable IPv4Header _header{};
+    mutable IPv4HeaderView _view{};
+    mutable bool _header_decoded{true};  //!< Is `_header` up to date? (Cleared by parse())
+    mutable bool _view_current{false};   //!< Is `_view` up to date? (Cleared by any mutable access to the header)
+    //!@}
+
     BufferList _payload{};
 
   public:
     //! \brief Parse the segment from a string
-    ParseResult parse(const Buffer buffer);
+    //! \note Only the header's version, lengths and checksum are read (see IPv4HeaderView)
+    //! \param[in] verify_checksum `false` only if the caller has already verified the header checksum
+    ParseResult parse(const Buffer buffer, const bool verify_checksum = true);
 
     //! \brief Serialize the segment to a string
+    //! \note The header checksum is recomputed only if the header has been modified
     BufferList serialize() const;
 
+    //! \brief Decrement the TTL, updating the header checksum incrementally
+    void decrement_ttl();
+
+    //! \brief Split into fragments of at most `mtu` bytes each, header included ([RFC 791](\ref rfc::rfc791))
+    //! \returns the fragments in order, or none if the datagram has DF set or `mtu` leaves no room for data
+    //! \note A datagram that already fits is returned as its only fragment
+    std::vector<IPv4Datagram> fragment(const size_t mtu) const;
+
+    //! \brief Hash of the datagram's flow: its addresses and protocol, and for TCP and UDP its ports
+    //! \details Every datagram of a TCP connection (in one direction) hashes the same. Fragments hash
+    //! without ports, since only the first one carries them.
+    uint32_t flow_hash() const;
+
     //! \name Accessors
     //!@{
-    const IPv4Header &header() const { return _header; }
-    IPv4Header &header() { return _header; }
+    const IPv4Header &header() const;
+    IPv4Header &header();
+
+    //! The header in wire format, with a valid checksum; reading fields from it doesn't decode the header
+    const IPv4HeaderView &header_view() const;
 
     const BufferList &payload() const { return _payload; }
     BufferList &payload() { return _payload; }
@@ -2,6 +2,7 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <iomanip>
 #include <sstream>
@@ -23,7 +24,7 @@ using namespace std;
 ParseResult IPv4Header::parse(NetParser &p) {
     Buffer original_serialized_version = p.buffer();
 
-    const size_t data_size = p.buffer().size();
+    const size_t data_size = p.size();
     if (data_size < IPv4Header::LENGTH) {
         return ParseResult::PacketTooShort;
     }
@@ -74,8 +75,8 @@ ParseResult IPv4Header::parse(NetParser &p) {
     return ParseResult::NoError;
 }
 
-//! Serialize the IPv4Header to a string (does not recompute the checksum)
-string IPv4Header::serialize() const {
+//! \param[out] out receives the serialized header
+size_t IPv4Header::serialize(Buffer::HeaderBytes &out) const {
     // sanity checks
     if (ver != 4) {
         throw runtime_error("wrong IP version");
@@ -84,29 +85,34 @@ string IPv4Header::serialize() const {
         throw runtime_error("IP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * hlen);
+    const size_t length = 4 * hlen;
+    fill_n(out.begin(), length, 0);  // options are zero
+    char *p = out.data();
 
     const uint8_t first_byte = (ver << 4) | (hlen & 0xf);
-    NetUnparser::u8(ret, first_byte);  // version and header length
-    NetUnparser::u8(ret, tos);         // type of service
-    NetUnparser::u16(ret, len);        // length
-    NetUnparser::u16(ret, id);         // id
+    NetUnparser::u8(p, first_byte);  // version and header length
+    NetUnparser::u8(p, tos);         // type of service
+    NetUnparser::u16(p, len);        // length
+    NetUnparser::u16(p, id);         // id
 
     const uint16_t fo_val = (df ? 0x4000 : 0) | (mf ? 0x2000 : 0) | (offset & 0x1fff);
-    NetUnparser::u16(ret, fo_val);  // flags and offset
+    NetUnparser::u16(p, fo_val);  // flags and offset
 
-    NetUnparser::u8(ret, ttl);    // time to live
-    NetUnparser::u8(ret, proto);  // protocol number
+    NetUnparser::u8(p, ttl);    // time to live
+    NetUnparser::u8(p, proto);  // protocol number
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    NetUnparser::u16(p, cksum);  // checksum
 
-    NetUnparser::u32(ret, src);  // src address
-    NetUnparser::u32(ret, dst);  // dst address
+    NetUnparser::u32(p, src);  // src address
+    NetUnparser::u32(p, dst);  // dst address
 
-    ret.resize(4 * hlen);  // expand header to advertised size
+    return length;
+}
 
-    return ret;
+Buffer IPv4Header::serialize() const {
+    Buffer::HeaderBytes out;
+    const size_t length = serialize(out);
+    return {out, length};
 }
 
 uint16_t IPv4Header::payload_length() const { return len - 4 * hlen; }
@@ -157,3 +163,88 @@ std::string IPv4Header::summary() const {
        << "dst=" << inet_ntoa({htobe32(dst)});
     return ss.str();
 }
+
+IPv4HeaderView::IPv4HeaderView(const IPv4Header &header) {
+    IPv4Header header_out = header;
+    header_out.cksum = 0;
+    const size_t header_length = header_out.serialize(_bytes);
+
+    // calculate checksum -- taken over header only
+    InternetChecksum check;
+    check.add({_bytes.data(), header_length});
+    char *cksum_field = _bytes.data() + IPv4Header::CKSUM_OFFSET;
+    NetUnparser::u16(cksum_field, check.value());
+}
+
+//! \details The checks (and the ParseResult for each) are the same as IPv4Header::parse(), but only the
+//! version, lengths and checksum are read.
+ParseResult IPv4HeaderView::parse(const Buffer &buffer, const bool verify_checksum) {
+    const string_view data = buffer.str();
+    if (data.size() < IPv4Header::LENGTH) {
+        return ParseResult::PacketTooShort;
+    }
+
+    const uint8_t first_byte = NetPeeker::u8(data.data());
+    const size_t header_length = 4 * (first_byte & 0x0f);
+    if (data.size() < header_length) {
+        return ParseResult::PacketTooShort;
+    }
+    if (first_byte >> 4 != 4) {
+        return ParseResult::WrongIPVersion;
+    }
+    if (header_length < IPv4Header::LENGTH) {
+        return ParseResult::HeaderTooShort;
+    }
+    if (data.size() != NetPeeker::u16(data.data() + 2)) {
+        return ParseResult::TruncatedPacket;
+    }
+
+    if (verify_checksum) {
+        InternetChecksum check;
+        check.add(data.substr(0, header_length));
+        if (check.value()) {
+            return ParseResult::BadChecksum;
+        }
+    }
+
+    copy_n(data.begin(), header_length, _bytes.begin());
+    return ParseResult::NoError;
+}
+
+uint32_t IPv4HeaderView::pseudo_cksum() const {
+    const uint32_t source = src();
+    const uint32_t destination = dst();
+    uint32_t pcksum = (source >> 16) + (source & 0xffff);  // source addr
+    pcksum += (destination >> 16) + (destination & 0xffff);  // dest addr
+    pcksum += proto();                                       // protocol
+    pcksum += payload_length();                              // payload length
+    return pcksum;
+}
+
+void IPv4HeaderView::decrement_ttl() {
+    // ttl和proto在header中共用一个16位字
+    const uint16_t old_word = _u16(8);
+    _bytes[8] = char(ttl() - 1);
+    const uint16_t new_word = _u16(8);
+
+    char *cksum_field = _bytes.data() + IPv4Header::CKSUM_OFFSET;
+    NetUnparser::u16(cksum_field, InternetChecksum::adjust(cksum(), old_word, new_word));
+}
+
+IPv4Header IPv4HeaderView::decode() const {
+    IPv4Header header;
+    header.ver = ver();
+    header.hlen = hlen();
+    header.tos = tos();
+    header.len = len();
+    header.id = id();
+    header.df = df();
+    header.mf = mf();
+    header.offset = offset();
+    header.ttl = ttl();
+    header.proto = proto();
+    header.cksum = cksum();
+    header.src = src();
+    header.dst = dst();
+    return header;
+}
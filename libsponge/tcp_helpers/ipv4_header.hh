@@ -7,8 +7,10 @@
 //! \note IP options are not supported
 struct IPv4Header {
     static constexpr size_t LENGTH = 20;         //!< [IPv4](\ref rfc::rfc791) header length, not including options
+    static constexpr size_t CKSUM_OFFSET = 10;   //!< Offset of the checksum field in the serialized header
     static constexpr uint8_t DEFAULT_TTL = 128;  //!< A reasonable default TTL value
     static constexpr uint8_t PROTO_TCP = 6;      //!< Protocol number for [tcp](\ref rfc::rfc793)
+    static constexpr uint8_t PROTO_UDP = 17;     //!< Protocol number for UDP
 
     //! \struct IPv4Header
     //! ~~~{.txt}
@@ -49,8 +51,12 @@ struct IPv4Header {
     //! Parse the IP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
-    //! Serialize the IP fields
-    std::string serialize() const;
+    //! Serialize the IP fields into `out` (does not recompute the checksum)
+    //! \returns the length of the header (4 * #hlen bytes)
+    size_t serialize(Buffer::HeaderBytes &out) const;
+
+    //! Serialize the IP fields (does not recompute the checksum)
+    Buffer serialize() const;
 
     //! Length of the payload
     uint16_t payload_length() const;
@@ -68,4 +74,61 @@ struct IPv4Header {
 //! \struct IPv4Header
 //! This struct can be used to parse an existing IP header or to create a new one.
 
+//! \brief An [IPv4](\ref rfc::rfc791) header kept in wire format, whose fields are decoded as they are read
+
+//! parse() makes the same checks as IPv4Header::parse() (lengths, version and checksum) and keeps a
+//! copy of the header's bytes. Code that only needs a few fields, like a router that looks at the
+//! destination and TTL, doesn't decode the rest, and a datagram can be forwarded by patching the
+//! bytes (see decrement_ttl()) rather than by serializing a header again.
+class IPv4HeaderView {
+  private:
+    Buffer::HeaderBytes _bytes{};
+
+    uint8_t _u8(const size_t offset) const { return NetPeeker::u8(_bytes.data() + offset); }
+    uint16_t _u16(const size_t offset) const { return NetPeeker::u16(_bytes.data() + offset); }
+    uint32_t _u32(const size_t offset) const { return NetPeeker::u32(_bytes.data() + offset); }
+
+  public:
+    IPv4HeaderView() = default;
+
+    //! Encode `header`, with a freshly computed checksum
+    explicit IPv4HeaderView(const IPv4Header &header);
+
+    //! Check the header at the start of `buffer` (a whole datagram), and keep its bytes if it is valid
+    //! \param[in] verify_checksum `false` only if the caller has already verified the checksum (see verify_checksums())
+    ParseResult parse(const Buffer &buffer, const bool verify_checksum = true);
+
+    //! \name IPv4 Header fields (see IPv4Header)
+    //!@{
+    uint8_t ver() const { return _u8(0) >> 4; }
+    uint8_t hlen() const { return _u8(0) & 0x0f; }
+    uint8_t tos() const { return _u8(1); }
+    uint16_t len() const { return _u16(2); }
+    uint16_t id() const { return _u16(4); }
+    bool df() const { return _u16(6) & 0x4000; }
+    bool mf() const { return _u16(6) & 0x2000; }
+    uint16_t offset() const { return _u16(6) & 0x1fff; }
+    uint8_t ttl() const { return _u8(8); }
+    uint8_t proto() const { return _u8(9); }
+    uint16_t cksum() const { return _u16(IPv4Header::CKSUM_OFFSET); }
+    uint32_t src() const { return _u32(12); }
+    uint32_t dst() const { return _u32(16); }
+    //!@}
+
+    //! Length of the payload
+    uint16_t payload_length() const { return len() - 4 * hlen(); }
+
+    //! [pseudo-header's](\ref rfc::rfc793) contribution to the TCP checksum
+    uint32_t pseudo_cksum() const;
+
+    //! Decrement the TTL, updating the checksum incrementally
+    void decrement_ttl();
+
+    //! The header in wire format
+    std::string_view bytes() const { return {_bytes.data(), size_t(4 * hlen())}; }
+
+    //! Decode all of the fields
+    IPv4Header decode() const;
+};
+
 #endif  // SPONGE_LIBSPONGE_IPV4_HEADER_HH
@@ -20,6 +20,7 @@ class TCPConfig {
     size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
     size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
     std::optional<WrappingInt32> fixed_isn{};
+    bool release_idle_buffers = false;  //!< Free stream storage whenever a stream is emptied
 };
 
 //! Config for classes derived from FdAdapter
@@ -0,0 +1,326 @@
+#include "tcp_demux.hh"
+
+#include "address.hh"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+using namespace std;
+
+string TCPFourTuple::to_string() const {
+    return Address::from_ipv4_numeric(local_address).ip() + ":" + ::to_string(local_port) + " <-> " +
+           Address::from_ipv4_numeric(remote_address).ip() + ":" + ::to_string(remote_port);
+}
+
+size_t TCPFourTupleHash::operator()(const TCPFourTuple &tuple) const noexcept {
+    const uint64_t addresses = (uint64_t(tuple.local_address) << 32) | tuple.remote_address;
+    const uint64_t ports = (uint64_t(tuple.local_port) << 16) | tuple.remote_port;
+    return hash<uint64_t>{}(addresses ^ (ports * 0x9e3779b97f4a7c15ULL));
+}
+
+static inline uint64_t rotl(const uint64_t x, const int b) { return (x << b) | (x >> (64 - b)); }
+
+//! SipHash-2-4 of a message made of whole 64-bit words
+template <size_t N>
+static uint64_t siphash(const array<uint64_t, 2> &key, const array<uint64_t, N> &words) {
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+
+    const auto round = [&] {
+        v0 += v1;
+        v1 = rotl(v1, 13);
+        v1 ^= v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16);
+        v3 ^= v2;
+        v0 += v3;
+        v3 = rotl(v3, 21);
+        v3 ^= v0;
+        v2 += v1;
+        v1 = rotl(v1, 17);
+        v1 ^= v2;
+        v2 = rotl(v2, 32);
+    };
+    const auto compress = [&](const uint64_t m) {
+        v3 ^= m;
+        round();
+        round();
+        v0 ^= m;
+    };
+
+    for (const uint64_t m : words) {
+        compress(m);
+    }
+    // 最后一个block只有消息长度（消息总是8字节的整数倍）
+    compress(uint64_t(N * 8) << 56);
+
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) {
+        round();
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+static array<uint64_t, 2> random_key() {
+    random_device rd;
+    return {(uint64_t(rd()) << 32) | rd(), (uint64_t(rd()) << 32) | rd()};
+}
+
+SYNCookies::SYNCookies() : _key(random_key()) {}
+
+uint32_t SYNCookies::_hash(const TCPFourTuple &id, const WrappingInt32 peer_isn, const uint64_t slot) const {
+    const array<uint64_t, 3> words{(uint64_t(id.local_address) << 32) | id.remote_address,
+                                   (uint64_t(id.local_port) << 48) | (uint64_t(id.remote_port) << 32) |
+                                       peer_isn.raw_value(),
+                                   slot};
+    return siphash(_key, words) & 0xffffff;
+}
+
+//! \param[in] id identifies the connection (from the listener's point of view)
+//! \param[in] peer_isn is the seqno of the peer's SYN
+//! \param[in] now_ms is the current time, in milliseconds
+WrappingInt32 SYNCookies::make(const TCPFourTuple &id, const WrappingInt32 peer_isn, const uint64_t now_ms) const {
+    const uint64_t slot = now_ms / SLOT_MS;
+    return WrappingInt32{(uint32_t(slot & 0xff) << 24) | _hash(id, peer_isn, slot)};
+}
+
+//! \param[in] id identifies the connection (from the listener's point of view)
+//! \param[in] peer_isn is the seqno of the ACK minus one
+//! \param[in] cookie is the ackno of the ACK minus one
+//! \param[in] now_ms is the current time, in milliseconds
+bool SYNCookies::check(const TCPFourTuple &id,
+                       const WrappingInt32 peer_isn,
+                       const WrappingInt32 cookie,
+                       const uint64_t now_ms) const {
+    const uint64_t current_slot = now_ms / SLOT_MS;
+    const uint64_t age = (current_slot - (cookie.raw_value() >> 24)) & 0xff;
+    if (age > 1 or age > current_slot) {
+        return false;
+    }
+    return (cookie.raw_value() & 0xffffff) == _hash(id, peer_isn, current_slot - age);
+}
+
+//! \param[in] cfg is the configuration for every connection created by the demultiplexer
+//! \param[in] backlog is the maximum number of connections that may be waiting to be accepted
+//! \param[in] syn_cookies selects SYN-cookie mode, in which half-open connections hold no state
+TCPDemultiplexer::TCPDemultiplexer(const TCPConfig &cfg, const size_t backlog, const bool syn_cookies)
+    : _cfg(cfg), _backlog(backlog), _cookies(syn_cookies ? optional<SYNCookies>(in_place) : nullopt) {}
+
+//! \param[in] id identifies the connection (from this end's point of view)
+//! \param[in] seg is the segment that arrived
+void TCPDemultiplexer::segment_received(const TCPFourTuple &id, const TCPSegment &seg) {
+    auto it = _connections.find(id);
+
+    if (it == _connections.end() and _cookies.has_value()) {
+        const TCPHeader &header = seg.header();
+        if (header.rst) {
+            return;
+        }
+        if (header.syn and not header.ack) {
+            _send_cookie(id, seg);
+            return;
+        }
+        if (header.syn or not header.ack) {
+            return;
+        }
+        // 握手的最后一个ACK：cookie有效才建立连接
+        it = _open_from_cookie(id, seg);
+        if (it == _connections.end()) {
+            return;
+        }
+    } else if (it == _connections.end()) {
+        // 只有不带ACK和RST的SYN才能打开一个新连接
+        if (not seg.header().syn or seg.header().ack or seg.header().rst) {
+            return;
+        }
+
+        // accept队列（包括半开连接）已满
+        if (_pending >= _backlog) {
+            _syns_dropped++;
+            return;
+        }
+
+        it = _connections.emplace(piecewise_construct, forward_as_tuple(id), forward_as_tuple(_cfg)).first;
+        _pending++;
+    }
+
+    it->second.connection.segment_received(seg);
+    _update(it);
+}
+
+void TCPDemultiplexer::_send_cookie(const TCPFourTuple &id, const TCPSegment &syn) {
+    // 和TCPConnection在LISTEN状态下收到SYN时的回复相同，只是ISN换成了cookie；SYN携带的数据被丢弃
+    TCPSegment syn_ack;
+    syn_ack.header().syn = true;
+    syn_ack.header().ack = true;
+    syn_ack.header().seqno = _cookies->make(id, syn.header().seqno, _time_ms);
+    syn_ack.header().ackno = syn.header().seqno + 1;
+    syn_ack.header().win = min(_cfg.recv_capacity, size_t(numeric_limits<uint16_t>::max()));
+
+    _segments_out.emplace(id, move(syn_ack));
+    _cookies_sent++;
+}
+
+TCPDemultiplexer::ConnectionMap::iterator TCPDemultiplexer::_open_from_cookie(const TCPFourTuple &id,
+                                                                              const TCPSegment &ack) {
+    const WrappingInt32 peer_isn = ack.header().seqno - 1;
+    const WrappingInt32 cookie = ack.header().ackno - 1;
+    if (not _cookies->check(id, peer_isn, cookie, _time_ms)) {
+        return _connections.end();
+    }
+
+    if (_pending >= _backlog) {
+        _syns_dropped++;
+        return _connections.end();
+    }
+    _cookies_validated++;
+
+    // 用cookie作为ISN新建连接，并重放对方的SYN，使连接进入SYN_RCVD状态
+    TCPConfig cfg = _cfg;
+    cfg.fixed_isn = cookie;
+    auto it = _connections.emplace(piecewise_construct, forward_as_tuple(id), forward_as_tuple(cfg)).first;
+    _pending++;
+
+    TCPSegment syn;
+    syn.header().syn = true;
+    syn.header().seqno = peer_isn;
+    syn.header().win = ack.header().win;
+    it->second.connection.segment_received(syn);
+
+    // 连接对重放的SYN的回复就是已经发出过的SYN/ACK
+    auto &out = it->second.connection.segments_out();
+    while (not out.empty()) {
+        out.pop();
+    }
+
+    return it;
+}
+
+//! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
+void TCPDemultiplexer::tick(const size_t ms_since_last_tick) {
+    _time_ms += ms_since_last_tick;
+    for (auto it = _connections.begin(); it != _connections.end();) {
+        it->second.connection.tick(ms_since_last_tick);
+        if (_update(it)) {
+            ++it;
+        }
+    }
+}
+
+void TCPDemultiplexer::_collect_segments(const ConnectionMap::iterator it) {
+    auto &out = it->second.connection.segments_out();
+    while (not out.empty()) {
+        _segments_out.emplace(it->first, move(out.front()));
+        out.pop();
+    }
+}
+
+bool TCPDemultiplexer::_update(ConnectionMap::iterator &it) {
+    _collect_segments(it);
+
+    Entry &entry = it->second;
+    if (entry.accepted) {
+        return true;
+    }
+
+    // 没有被accept的连接已经结束（例如握手中途被RST），直接丢弃
+    if (not entry.connection.active()) {
+        _pending--;
+        it = _connections.erase(it);
+        return false;
+    }
+
+    // 握手完成的连接进入accept队列
+    if (not entry.queued) {
+        const TCPState state = entry.connection.state();
+        if (state != TCPState::State::SYN_RCVD and state != TCPState::State::SYN_SENT and
+            state != TCPState::State::LISTEN) {
+            entry.queued = true;
+            _accept_queue.push(it->first);
+        }
+    }
+
+    return true;
+}
+
+//! \param[in] id identifies the new connection (from this end's point of view)
+//! \returns the new connection, which has already sent its SYN
+TCPConnection &TCPDemultiplexer::connect(const TCPFourTuple &id) {
+    if (contains(id)) {
+        throw runtime_error("TCPDemultiplexer::connect: connection " + id.to_string() + " already exists");
+    }
+
+    auto it = _connections.emplace(piecewise_construct, forward_as_tuple(id), forward_as_tuple(_cfg)).first;
+    it->second.accepted = true;
+    it->second.connection.connect();
+    _update(it);
+
+    return it->second.connection;
+}
+
+optional<TCPFourTuple> TCPDemultiplexer::accept() {
+    while (not _accept_queue.empty()) {
+        const TCPFourTuple id = _accept_queue.front();
+        _accept_queue.pop();
+
+        // 入队之后连接可能已经被丢弃
+        auto it = _connections.find(id);
+        if (it == _connections.end() or it->second.accepted or not it->second.queued) {
+            continue;
+        }
+
+        it->second.accepted = true;
+        _pending--;
+        return id;
+    }
+
+    return {};
+}
+
+//! \param[in] id identifies the connection
+//! \param[in] data is the data to write
+//! \returns the number of bytes from `data` that were actually written
+size_t TCPDemultiplexer::write(const TCPFourTuple &id, const string &data) {
+    auto it = _connections.find(id);
+    if (it == _connections.end()) {
+        return 0;
+    }
+    const size_t written = it->second.connection.write(data);
+    _update(it);
+    return written;
+}
+
+//! \param[in] id identifies the connection
+void TCPDemultiplexer::end_input_stream(const TCPFourTuple &id) {
+    auto it = _connections.find(id);
+    if (it == _connections.end()) {
+        return;
+    }
+    it->second.connection.end_input_stream();
+    _update(it);
+}
+
+//! \param[in] id identifies the connection
+void TCPDemultiplexer::erase(const TCPFourTuple &id) {
+    auto it = _connections.find(id);
+    if (it == _connections.end()) {
+        return;
+    }
+
+    // 仍然活跃的连接需要先向对方发送RST
+    if (it->second.connection.active()) {
+        it->second.connection.reset_connection();
+        _collect_segments(it);
+    }
+
+    if (not it->second.accepted) {
+        _pending--;
+    }
+    _connections.erase(it);
+}
@@ -0,0 +1,201 @@
+#ifndef SPONGE_LIBSPONGE_TCP_DEMUX_HH
+#define SPONGE_LIBSPONGE_TCP_DEMUX_HH
+
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+//! \brief The addresses and ports (host byte order) that identify one TCP connection
+struct TCPFourTuple {
+    uint32_t local_address = 0;   //!< IPv4 address of this end
+    uint16_t local_port = 0;      //!< TCP port of this end
+    uint32_t remote_address = 0;  //!< IPv4 address of the peer
+    uint16_t remote_port = 0;     //!< TCP port of the peer
+
+    //! The same connection as seen from the peer
+    TCPFourTuple reversed() const { return {remote_address, remote_port, local_address, local_port}; }
+
+    //! Return a string containing the tuple in human-readable format
+    std::string to_string() const;
+
+    bool operator==(const TCPFourTuple &other) const {
+        return local_address == other.local_address and local_port == other.local_port and
+               remote_address == other.remote_address and remote_port == other.remote_port;
+    }
+};
+
+//! \brief Hash functor so that a TCPFourTuple can key a std::unordered_map
+struct TCPFourTupleHash {
+    size_t operator()(const TCPFourTuple &tuple) const noexcept;
+};
+
+//! \brief Stateless initial sequence numbers for the passive side of a handshake
+
+//! A SYN cookie is the ISN that a listener puts in its SYN/ACK. It encodes everything the listener
+//! needs to recognise the final ACK of the handshake, so nothing has to be stored for a half-open
+//! connection:
+//!
+//! - bits 31..24: the time slot in which the cookie was made (slots are #SLOT_MS long)
+//! - bits 23..0: SipHash-2-4, under a random key, of the 4-tuple, the peer's ISN and the time slot
+//!
+//! A cookie is accepted during the slot it was made in and the slot after that.
+//!
+//! \note Linux also encodes an MSS index in the cookie. Sponge doesn't send or parse TCP options, so
+//! every connection uses TCPConfig::MAX_PAYLOAD_SIZE and there is nothing to encode.
+class SYNCookies {
+  private:
+    std::array<uint64_t, 2> _key;
+
+    uint32_t _hash(const TCPFourTuple &id, const WrappingInt32 peer_isn, const uint64_t slot) const;
+
+  public:
+    static constexpr uint64_t SLOT_MS = 64 * 1000;  //!< Length of a time slot, in milliseconds
+
+    //! Construct with a random key
+    SYNCookies();
+
+    //! Construct with a given key (for testing)
+    explicit SYNCookies(const std::array<uint64_t, 2> &key) : _key(key) {}
+
+    //! The ISN to send in reply to a SYN with seqno `peer_isn` on connection `id`, at time `now_ms`
+    WrappingInt32 make(const TCPFourTuple &id, const WrappingInt32 peer_isn, const uint64_t now_ms) const;
+
+    //! Did make() produce `cookie` for this handshake in the current or the previous time slot?
+    bool check(const TCPFourTuple &id,
+               const WrappingInt32 peer_isn,
+               const WrappingInt32 cookie,
+               const uint64_t now_ms) const;
+};
+
+//! \brief Demultiplexes TCP segments among many TCPConnection objects that share one datagram interface
+
+//! Inbound segments are dispatched by TCPFourTuple. A SYN for an unknown tuple creates a new connection,
+//! as long as fewer than `backlog` connections are waiting to be accepted (half-open, or established but
+//! not yet returned by accept()). Connections that reach ESTABLISHED are placed on the accept queue.
+//!
+//! In SYN-cookie mode, a SYN for an unknown tuple is answered with a SYN/ACK whose ISN is a
+//! SYNCookies cookie, and no connection is created. The connection is created when an ACK
+//! arrives that carries a valid cookie (and only if the backlog has room for it).
+//!
+//! Like TCPConnection, this class does no I/O: the owner feeds it segments and drains segments_out().
+class TCPDemultiplexer {
+  private:
+    //! A connection plus its bookkeeping in the accept queue
+    struct Entry {
+        TCPConnection connection;
+        bool queued{false};    //!< on the accept queue
+        bool accepted{false};  //!< returned by accept() (or opened locally by connect())
+
+        explicit Entry(const TCPConfig &cfg) : connection(cfg) {}
+    };
+
+    using ConnectionMap = std::unordered_map<TCPFourTuple, Entry, TCPFourTupleHash>;
+
+    TCPConfig _cfg;
+
+    //! Maximum number of connections waiting to be accepted
+    size_t _backlog;
+
+    ConnectionMap _connections{};
+
+    //! Established connections that have not been accepted yet
+    std::queue<TCPFourTuple> _accept_queue{};
+
+    //! Number of connections that have not been accepted (half-open plus queued)
+    size_t _pending{0};
+
+    //! Number of SYNs dropped because the backlog was full
+    size_t _syns_dropped{0};
+
+    //! Set in SYN-cookie mode
+    std::optional<SYNCookies> _cookies;
+
+    //! Time elapsed since construction, in milliseconds (for the cookies' time slots)
+    uint64_t _time_ms{0};
+
+    //! Number of SYNs answered with a cookie, and of ACKs that carried a valid one
+    size_t _cookies_sent{0};
+    size_t _cookies_validated{0};
+
+    //! Segments to send, tagged with the connection they belong to
+    std::queue<std::pair<TCPFourTuple, TCPSegment>> _segments_out{};
+
+    //! Answer a SYN for an unknown tuple with a SYN/ACK carrying a cookie
+    void _send_cookie(const TCPFourTuple &id, const TCPSegment &syn);
+
+    //! Create a connection for an ACK that carries a valid cookie
+    //! \returns the connection, or `_connections.end()` if the cookie is invalid or the backlog is full
+    ConnectionMap::iterator _open_from_cookie(const TCPFourTuple &id, const TCPSegment &ack);
+
+    //! Move a connection's outbound segments to `_segments_out`
+    void _collect_segments(const ConnectionMap::iterator it);
+
+    //! Collect outbound segments, queue newly established connections, and drop dead unaccepted ones
+    //! \returns `false` if the entry was erased (and `it` advanced past it)
+    bool _update(ConnectionMap::iterator &it);
+
+  public:
+    //! Construct a demultiplexer whose connections use `cfg`, accepting at most `backlog` pending connections
+    TCPDemultiplexer(const TCPConfig &cfg, const size_t backlog, const bool syn_cookies = false);
+
+    //! \name Methods for the owner or operating system to call
+    //!@{
+
+    //! Dispatch a segment that arrived for connection `id`
+    void segment_received(const TCPFourTuple &id, const TCPSegment &seg);
+
+    //! Called periodically when time elapses; ticks every connection
+    void tick(const size_t ms_since_last_tick);
+
+    //! Segments that the connections have enqueued for transmission
+    std::queue<std::pair<TCPFourTuple, TCPSegment>> &segments_out() { return _segments_out; }
+    //!@}
+
+    //! \name Methods for the application
+    //!@{
+
+    //! \brief Open a connection actively (sends a SYN)
+    //! \note The connection is owned by the caller immediately; it never goes on the accept queue.
+    TCPConnection &connect(const TCPFourTuple &id);
+
+    //! \brief Take the oldest established connection off the accept queue
+    //! \returns empty if no connection is waiting
+    std::optional<TCPFourTuple> accept();
+
+    //! Write to a connection's outbound stream
+    size_t write(const TCPFourTuple &id, const std::string &data);
+
+    //! Shut down a connection's outbound stream
+    void end_input_stream(const TCPFourTuple &id);
+
+    //! Access an accepted connection (throws std::out_of_range if `id` is unknown)
+    TCPConnection &connection(const TCPFourTuple &id) { return _connections.at(id).connection; }
+
+    //! Is there a connection with this tuple?
+    bool contains(const TCPFourTuple &id) const { return _connections.count(id) != 0; }
+
+    //! Forget an accepted connection (sends a RST if it is still active)
+    void erase(const TCPFourTuple &id);
+    //!@}
+
+    //! \name Statistics
+    //!@{
+    size_t size() const { return _connections.size(); }
+    size_t pending() const { return _pending; }
+    size_t syns_dropped() const { return _syns_dropped; }
+    size_t cookies_sent() const { return _cookies_sent; }
+    size_t cookies_validated() const { return _cookies_validated; }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_DEMUX_HH
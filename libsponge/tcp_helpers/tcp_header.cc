@@ -1,5 +1,8 @@
 #include "tcp_header.hh"
 
+#include "util.hh"
+
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
@@ -47,34 +50,39 @@ ParseResult TCPHeader::parse(NetParser &p) {
     return ParseResult::NoError;
 }
 
-//! Serialize the TCPHeader to a string (does not recompute the checksum)
-string TCPHeader::serialize() const {
+//! \param[out] out receives the serialized header
+size_t TCPHeader::serialize(Buffer::HeaderBytes &out) const {
     // sanity check
     if (doff < 5) {
         throw runtime_error("TCP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * doff);
+    const size_t length = 4 * doff;
+    fill_n(out.begin(), length, 0);  // options are zero
+    char *p = out.data();
 
-    NetUnparser::u16(ret, sport);              // source port
-    NetUnparser::u16(ret, dport);              // destination port
-    NetUnparser::u32(ret, seqno.raw_value());  // sequence number
-    NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
+    NetUnparser::u16(p, sport);              // source port
+    NetUnparser::u16(p, dport);              // destination port
+    NetUnparser::u32(p, seqno.raw_value());  // sequence number
+    NetUnparser::u32(p, ackno.raw_value());  // ack number
+    NetUnparser::u8(p, doff << 4);           // data offset
 
     const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) |
                          (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
-    NetUnparser::u8(ret, fl_b);  // flags
-    NetUnparser::u16(ret, win);  // window size
+    NetUnparser::u8(p, fl_b);  // flags
+    NetUnparser::u16(p, win);  // window size
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    NetUnparser::u16(p, cksum);  // checksum
 
-    NetUnparser::u16(ret, uptr);  // urgent pointer
+    NetUnparser::u16(p, uptr);  // urgent pointer
 
-    ret.resize(4 * doff);  // expand header to advertised size
+    return length;
+}
 
-    return ret;
+Buffer TCPHeader::serialize() const {
+    Buffer::HeaderBytes out;
+    const size_t length = serialize(out);
+    return {out, length};
 }
 
 //! \returns A string with the header's contents
@@ -106,3 +114,53 @@ bool TCPHeader::operator==(const TCPHeader &other) const {
            psh == other.psh && rst == other.rst && syn == other.syn && fin == other.fin && win == other.win &&
            uptr == other.uptr;
 }
+
+//! \details Unlike TCPSegment::parse(), a header whose `doff` is less than 5 is rejected.
+ParseResult TCPHeaderView::parse(const Buffer &segment, const uint32_t datagram_layer_checksum) {
+    InternetChecksum check(datagram_layer_checksum);
+    check.add(segment);
+    if (check.value()) {
+        return ParseResult::BadChecksum;
+    }
+
+    const string_view data = segment.str();
+    if (data.size() < TCPHeader::LENGTH) {
+        return ParseResult::PacketTooShort;
+    }
+
+    const size_t header_length = 4 * (NetPeeker::u8(data.data() + 12) >> 4);
+    if (header_length < TCPHeader::LENGTH) {
+        return ParseResult::HeaderTooShort;
+    }
+    if (data.size() < header_length) {
+        return ParseResult::PacketTooShort;
+    }
+
+    _segment = segment;
+    return ParseResult::NoError;
+}
+
+TCPHeader TCPHeaderView::decode() const {
+    TCPHeader header;
+    header.sport = sport();
+    header.dport = dport();
+    header.seqno = seqno();
+    header.ackno = ackno();
+    header.doff = doff();
+    header.urg = urg();
+    header.ack = ack();
+    header.psh = psh();
+    header.rst = rst();
+    header.syn = syn();
+    header.fin = fin();
+    header.win = win();
+    header.cksum = cksum();
+    header.uptr = uptr();
+    return header;
+}
+
+Buffer TCPHeaderView::payload() const {
+    Buffer ret = _segment;
+    ret.remove_prefix(4 * doff());
+    return ret;
+}
@@ -8,6 +8,7 @@
 //! \note TCP options are not supported
 struct TCPHeader {
     static constexpr size_t LENGTH = 20;  //!< [TCP](\ref rfc::rfc793) header length, not including options
+    static constexpr size_t CKSUM_OFFSET = 16;  //!< Offset of the checksum field in the serialized header
 
     //! \struct TCPHeader
     //! ~~~{.txt}
@@ -53,8 +54,12 @@ struct TCPHeader {
     //! Parse the TCP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
-    //! Serialize the TCP fields
-    std::string serialize() const;
+    //! Serialize the TCP fields into `out` (does not recompute the checksum)
+    //! \returns the length of the header (4 * #doff bytes)
+    size_t serialize(Buffer::HeaderBytes &out) const;
+
+    //! Serialize the TCP fields (does not recompute the checksum)
+    Buffer serialize() const;
 
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
@@ -65,4 +70,48 @@ struct TCPHeader {
     bool operator==(const TCPHeader &other) const;
 };
 
+//! \brief A validated [TCP](\ref rfc::rfc793) segment whose header fields are read from its Buffer on demand
+
+//! parse() checks the checksum and the header length once. Filtering code (such as an adapter that
+//! looks at the ports and flags to decide whether a segment belongs to its connection) can then read
+//! just the fields it needs, and only decode a TCPSegment for segments that it keeps.
+class TCPHeaderView {
+  private:
+    Buffer _segment{};
+
+    uint8_t _u8(const size_t offset) const { return NetPeeker::u8(_segment.str().data() + offset); }
+    uint16_t _u16(const size_t offset) const { return NetPeeker::u16(_segment.str().data() + offset); }
+    uint32_t _u32(const size_t offset) const { return NetPeeker::u32(_segment.str().data() + offset); }
+
+  public:
+    //! Check the checksum and header length of `segment`, and keep it if they are valid
+    //! \param[in] segment is the whole segment (header and payload)
+    //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+    ParseResult parse(const Buffer &segment, const uint32_t datagram_layer_checksum = 0);
+
+    //! \name TCP Header fields (see TCPHeader)
+    //!@{
+    uint16_t sport() const { return _u16(0); }
+    uint16_t dport() const { return _u16(2); }
+    WrappingInt32 seqno() const { return WrappingInt32{_u32(4)}; }
+    WrappingInt32 ackno() const { return WrappingInt32{_u32(8)}; }
+    uint8_t doff() const { return _u8(12) >> 4; }
+    bool urg() const { return _u8(13) & 0b0010'0000; }
+    bool ack() const { return _u8(13) & 0b0001'0000; }
+    bool psh() const { return _u8(13) & 0b0000'1000; }
+    bool rst() const { return _u8(13) & 0b0000'0100; }
+    bool syn() const { return _u8(13) & 0b0000'0010; }
+    bool fin() const { return _u8(13) & 0b0000'0001; }
+    uint16_t win() const { return _u16(14); }
+    uint16_t cksum() const { return _u16(TCPHeader::CKSUM_OFFSET); }
+    uint16_t uptr() const { return _u16(18); }
+    //!@}
+
+    //! Decode all of the header fields
+    TCPHeader decode() const;
+
+    //! The segment's payload
+    Buffer payload() const;
+};
+
 #endif  // SPONGE_LIBSPONGE_TCP_HEADER_HH
@@ -0,0 +1,268 @@
+#include "tcp_listener.hh"
+
+#include "ipv4_datagram.hh"
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+
+using namespace std;
+
+static constexpr size_t TCP_TICK_MS = 10;
+
+//! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
+//! \param[in] type is the type of AF_UNIX sockets to create (e.g., SOCK_SEQPACKET)
+//! \returns a std::pair of connected sockets
+static inline pair<FileDescriptor, FileDescriptor> socket_pair_helper(const int type) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, type, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+//! \param[in] tun is the TUN device that carries the IPv4 datagrams
+//! \param[in] cfg is the TCPConfig for every accepted connection
+//! \param[in] local is the address and port to accept connections on
+//! \param[in] backlog is the maximum number of connections waiting to be accepted
+//! \param[in] syn_cookies selects SYN-cookie mode for the demultiplexer
+TCPListener::TCPListener(
+    TunFD &&tun, const TCPConfig &cfg, const Address &local, const size_t backlog, const bool syn_cookies)
+    : _tun(move(tun)), _local(local), _demux(cfg, backlog, syn_cookies) {
+    // rule 1: read datagrams from the TUN device and dispatch them to the connections
+    _eventloop.add_rule(_tun, Direction::In, [&] { _read_datagram(); });
+
+    // rule 2: write the connections' outbound segments to the TUN device
+    _eventloop.add_rule(
+        _tun, Direction::Out, [&] { _write_datagrams(); }, [&] { return not _demux.segments_out().empty(); });
+
+    _tcp_thread = thread(&TCPListener::_tcp_main, this);
+}
+
+TCPListener::~TCPListener() {
+    try {
+        _abort.store(true);
+        if (_tcp_thread.joinable()) {
+            _tcp_thread.join();
+        }
+    } catch (const exception &e) {
+        cerr << "Exception destructing TCPListener: " << e.what() << endl;
+    }
+}
+
+LocalStreamSocket TCPListener::accept() {
+    unique_lock<mutex> lock(_mutex);
+    _accepted_cv.wait(lock, [&] { return _abort or not _accepted.empty(); });
+
+    if (_accepted.empty()) {
+        throw runtime_error("TCPListener::accept(): listener has shut down");
+    }
+
+    LocalStreamSocket sock = move(_accepted.front());
+    _accepted.pop();
+    return sock;
+}
+
+void TCPListener::_read_datagram() {
+    InternetDatagram ip_dgram;
+    if (ip_dgram.parse(_tun.read_packet()) != ParseResult::NoError) {
+        return;
+    }
+
+    // 只处理发往监听地址的TCP报文（地址0表示接受任何地址）
+    // 过滤时直接从header的字节中读取字段，不解码整个header
+    const IPv4HeaderView &ip_header = ip_dgram.header_view();
+    if (ip_header.proto() != IPv4Header::PROTO_TCP) {
+        return;
+    }
+    if (_local.ipv4_numeric() != 0 and ip_header.dst() != _local.ipv4_numeric()) {
+        return;
+    }
+
+    TCPHeaderView tcp_header;
+    if (tcp_header.parse(ip_dgram.payload(), ip_header.pseudo_cksum()) != ParseResult::NoError) {
+        return;
+    }
+    if (tcp_header.dport() != _local.port()) {
+        return;
+    }
+
+    const TCPFourTuple id{ip_header.dst(), tcp_header.dport(), ip_header.src(), tcp_header.sport()};
+    _demux.segment_received(id, TCPSegment{tcp_header});
+}
+
+void TCPListener::_write_datagrams() {
+    auto &out = _demux.segments_out();
+    while (not out.empty()) {
+        const TCPFourTuple &id = out.front().first;
+        TCPSegment &seg = out.front().second;
+
+        seg.header().sport = id.local_port;
+        seg.header().dport = id.remote_port;
+
+        InternetDatagram ip_dgram;
+        ip_dgram.header().src = id.local_address;
+        ip_dgram.header().dst = id.remote_address;
+        ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + as_const(seg).payload().size();
+        ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
+
+        _tun.write(ip_dgram.serialize());
+        out.pop();
+    }
+}
+
+void TCPListener::_accept_connections() {
+    for (auto id = _demux.accept(); id.has_value(); id = _demux.accept()) {
+        auto [owner_end, thread_end] = socket_pair_helper(SOCK_STREAM);
+
+        auto &session = _sessions.emplace(id.value(), Session(LocalStreamSocket(move(thread_end)))).first->second;
+        session.thread_data.set_blocking(false);
+        _install_rules(id.value());
+
+        {
+            lock_guard<mutex> lock(_mutex);
+            _accepted.emplace(move(owner_end));
+        }
+        _accepted_cv.notify_one();
+    }
+}
+
+//! \details The rules are the same as rules 2 and 3 of TCPSpongeSocket. They look the session up
+//! on every call, because the session may be reaped before the EventLoop notices that its
+//! socket has been closed.
+void TCPListener::_install_rules(const TCPFourTuple &id) {
+    LocalStreamSocket &thread_data = _sessions.at(id).thread_data;
+
+    // rule 3: read from the owner's socket into the connection's outbound stream
+    _eventloop.add_rule(
+        thread_data,
+        Direction::In,
+        [this, id] {
+            Session &session = _sessions.at(id);
+            TCPConnection &tcp = _demux.connection(id);
+
+            const auto data = session.thread_data.read(tcp.remaining_outbound_capacity());
+            const auto len = data.size();
+            if (_demux.write(id, data) != len) {
+                throw runtime_error("TCPConnection::write() accepted less than advertised length");
+            }
+
+            if (session.thread_data.eof()) {
+                _demux.end_input_stream(id);
+                session.outbound_shutdown = true;
+            }
+        },
+        [this, id] {
+            const auto it = _sessions.find(id);
+            if (it == _sessions.end()) {
+                return false;
+            }
+            const TCPConnection &tcp = _demux.connection(id);
+            return tcp.active() and not it->second.outbound_shutdown and tcp.remaining_outbound_capacity() > 0;
+        },
+        [this, id] {
+            const auto it = _sessions.find(id);
+            if (it != _sessions.end()) {
+                _demux.end_input_stream(id);
+                it->second.outbound_shutdown = true;
+            }
+        });
+
+    // rule 4: read from the connection's inbound stream into the owner's socket
+    _eventloop.add_rule(
+        thread_data,
+        Direction::Out,
+        [this, id] {
+            Session &session = _sessions.at(id);
+            ByteStream &inbound = _demux.connection(id).inbound_stream();
+
+            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
+            const auto bytes_written = session.thread_data.write(inbound.peek_output(amount_to_write), false);
+            inbound.pop_output(bytes_written);
+
+            if (inbound.eof() or inbound.error()) {
+                session.thread_data.shutdown(SHUT_WR);
+                session.inbound_shutdown = true;
+            }
+        },
+        [this, id] {
+            const auto it = _sessions.find(id);
+            if (it == _sessions.end()) {
+                return false;
+            }
+            ByteStream &inbound = _demux.connection(id).inbound_stream();
+            return (not inbound.buffer_empty()) or
+                   ((inbound.eof() or inbound.error()) and not it->second.inbound_shutdown);
+        },
+        [this, id] {
+            // 应用已经关闭了socket，剩下的入站数据无处可送
+            const auto it = _sessions.find(id);
+            if (it != _sessions.end()) {
+                it->second.inbound_shutdown = true;
+            }
+        });
+}
+
+void TCPListener::_reap_sessions() {
+    for (auto it = _sessions.begin(); it != _sessions.end();) {
+        const TCPFourTuple &id = it->first;
+        if (_demux.connection(id).active() or not it->second.inbound_shutdown) {
+            ++it;
+            continue;
+        }
+
+        // 关闭socket会让EventLoop在下一轮取消这个会话的规则
+        it->second.thread_data.close();
+        _demux.erase(id);
+        it = _sessions.erase(it);
+    }
+}
+
+void TCPListener::_reset_sessions() {
+    for (auto &[id, session] : _sessions) {
+        session.thread_data.close();
+        _demux.erase(id);
+    }
+    _sessions.clear();
+    _write_datagrams();
+}
+
+void TCPListener::_tcp_main() {
+    try {
+        auto base_time = timestamp_ms();
+        while (not _abort) {
+            if (_eventloop.wait_next_event(TCP_TICK_MS) == EventLoop::Result::Exit) {
+                break;
+            }
+
+            const auto next_time = timestamp_ms();
+            _demux.tick(next_time - base_time);
+            base_time = next_time;
+
+            // 新规则只能在EventLoop的回调之外添加
+            _accept_connections();
+            _reap_sessions();
+        }
+    } catch (const exception &e) {
+        cerr << "Exception in TCPListener thread: " << e.what() << "\n";
+    }
+
+    // 还开着的连接向对方发送RST，否则对方要等到超时才知道连接已经不在了
+    try {
+        _reset_sessions();
+    } catch (const exception &e) {
+        cerr << "Exception resetting TCPListener connections: " << e.what() << "\n";
+    }
+
+    // 唤醒可能还在accept()中等待的owner
+    {
+        lock_guard<mutex> lock(_mutex);
+        _abort.store(true);
+    }
+    _accepted_cv.notify_all();
+}
@@ -0,0 +1,105 @@
+#ifndef SPONGE_LIBSPONGE_TCP_LISTENER_HH
+#define SPONGE_LIBSPONGE_TCP_LISTENER_HH
+
+#include "address.hh"
+#include "eventloop.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_demux.hh"
+#include "tun.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+
+//! \brief Multithreaded server that accepts many TCP connections on one TUN device
+
+//! One background thread owns the TUN device, a TCPDemultiplexer and an EventLoop. Inbound
+//! datagrams addressed to the listening address and port are dispatched by 4-tuple; each
+//! connection that completes the handshake is handed to the owner by accept() as one end of a
+//! stream socket pair, exactly as with TCPSpongeSocket.
+class TCPListener {
+  private:
+    //! The TCP thread's side of one accepted connection
+    struct Session {
+        LocalStreamSocket thread_data;   //!< Stream socket for reads and writes between owner and TCP thread
+        bool inbound_shutdown{false};    //!< Has the listener shut down the incoming data to the owner?
+        bool outbound_shutdown{false};   //!< Has the owner shut down the outbound data to the TCP connection?
+
+        explicit Session(LocalStreamSocket &&sock) : thread_data(std::move(sock)) {}
+    };
+
+    TunFD _tun;
+
+    //! Address and port to accept connections on (address 0 accepts on any address)
+    Address _local;
+
+    TCPDemultiplexer _demux;
+
+    EventLoop _eventloop{};
+
+    //! Accepted connections, keyed like the demultiplexer
+    std::unordered_map<TCPFourTuple, Session, TCPFourTupleHash> _sessions{};
+
+    //! \name State shared with the owner thread
+    //!@{
+    std::mutex _mutex{};
+    std::condition_variable _accepted_cv{};
+    std::queue<LocalStreamSocket> _accepted{};  //!< Owner ends of accepted connections
+    std::atomic_bool _abort{false};             //!< Set by the owner to stop the TCP thread, or by the thread on exit
+    //!@}
+
+    std::thread _tcp_thread{};
+
+    //! Parse a datagram from the TUN device and give it to the demultiplexer
+    void _read_datagram();
+
+    //! Wrap the demultiplexer's outbound segments in IPv4 datagrams and write them to the TUN device
+    void _write_datagrams();
+
+    //! Take established connections from the demultiplexer and hand them to the owner
+    void _accept_connections();
+
+    //! Install the event-loop rules that copy data between a session and its connection
+    void _install_rules(const TCPFourTuple &id);
+
+    //! Forget sessions whose connection has finished and whose inbound data has been delivered
+    void _reap_sessions();
+
+    //! Reset the connections of every session that is left, and send the RSTs
+    void _reset_sessions();
+
+    //! Main loop of the TCP thread
+    void _tcp_main();
+
+  public:
+    //! Accept connections to `local` on `tun`, keeping at most `backlog` connections waiting for accept()
+    //! \note With `syn_cookies`, half-open connections hold no state (see SYNCookies)
+    TCPListener(TunFD &&tun,
+                const TCPConfig &cfg,
+                const Address &local,
+                const size_t backlog = 128,
+                const bool syn_cookies = false);
+
+    //! Block until a connection has been established, and return the application's end of it
+    LocalStreamSocket accept();
+
+    //! Stop the TCP thread; connections that are still open are reset
+    ~TCPListener();
+
+    //! \name
+    //! This object cannot be safely moved or copied, since it is in use by two threads simultaneously
+
+    //!@{
+    TCPListener(const TCPListener &) = delete;
+    TCPListener(TCPListener &&) = delete;
+    TCPListener &operator=(const TCPListener &) = delete;
+    TCPListener &operator=(TCPListener &&) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_LISTENER_HH
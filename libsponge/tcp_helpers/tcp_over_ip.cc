@@ -22,40 +22,55 @@ using namespace std;
 //! and the TCP segment read from the wire includes a SYN, this function clears the
 //! `_listen` flag and records the source and destination addresses and port numbers
 //! from the TCP header; it uses this information to filter future reads.
+//!
+//! Fragments that pass the address and protocol checks are held until the rest of their datagram
+//! arrives (see IPv4Reassembler), and the whole datagram is then unwrapped as above.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram &ip_dgram) {
+    // 过滤只用到几个字段：直接从header的字节中读取，不解码整个header
+    const IPv4HeaderView &ip_header = ip_dgram.header_view();
+
     // is the IPv4 datagram for us?
     // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
-    if (not listening() and (ip_dgram.header().dst != config().source.ipv4_numeric())) {
+    if (not listening() and (ip_header.dst() != config().source.ipv4_numeric())) {
         return {};
     }
 
     // is the IPv4 datagram from our peer?
-    if (not listening() and (ip_dgram.header().src != config().destination.ipv4_numeric())) {
+    if (not listening() and (ip_header.src() != config().destination.ipv4_numeric())) {
         return {};
     }
 
     // does the IPv4 datagram claim that its payload is a TCP segment?
-    if (ip_dgram.header().proto != IPv4Header::PROTO_TCP) {
+    if (ip_header.proto() != IPv4Header::PROTO_TCP) {
         return {};
     }
 
+    // 分片先交给reassembler（只收下上面的检查通过了的分片），拼成完整的datagram之后再继续
+    if (ip_header.mf() or ip_header.offset() != 0) {
+        const optional<InternetDatagram> whole = _reassembler.push(ip_dgram);
+        if (not whole) {
+            return {};
+        }
+        return unwrap_tcp_in_ip(*whole);
+    }
+
     // is the payload a valid TCP segment?
-    TCPSegment tcp_seg;
-    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+    TCPHeaderView tcp_header;
+    if (ParseResult::NoError != tcp_header.parse(ip_dgram.payload(), ip_header.pseudo_cksum())) {
         return {};
     }
 
     // is the TCP segment for us?
-    if (tcp_seg.header().dport != config().source.port()) {
+    if (tcp_header.dport() != config().source.port()) {
         return {};
     }
 
     // should we target this source addr/port (and use its destination addr as our source) in reply?
     if (listening()) {
-        if (tcp_seg.header().syn and not tcp_seg.header().rst) {
-            config_mutable().source = {inet_ntoa({htobe32(ip_dgram.header().dst)}), config().source.port()};
-            config_mutable().destination = {inet_ntoa({htobe32(ip_dgram.header().src)}), tcp_seg.header().sport};
+        if (tcp_header.syn() and not tcp_header.rst()) {
+            config_mutable().source = {inet_ntoa({htobe32(ip_header.dst())}), config().source.port()};
+            config_mutable().destination = {inet_ntoa({htobe32(ip_header.src())}), tcp_header.sport()};
             set_listening(false);
         } else {
             return {};
@@ -63,11 +78,12 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
     }
 
     // is the TCP segment from our peer?
-    if (tcp_seg.header().sport != config().destination.port()) {
+    if (tcp_header.sport() != config().destination.port()) {
         return {};
     }
 
-    return tcp_seg;
+    // 只有确定要交给连接的segment才完整解码
+    return TCPSegment{tcp_header};
 }
 
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
@@ -81,7 +97,7 @@ InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
     InternetDatagram ip_dgram;
     ip_dgram.header().src = config().source.ipv4_numeric();
     ip_dgram.header().dst = config().destination.ipv4_numeric();
-    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + as_const(seg).payload().size();
 
     // set payload, calculating TCP checksum using information from IP header
     ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
@@ -3,6 +3,7 @@
 
 #include "buffer.hh"
 #include "fd_adapter.hh"
+#include "ip_reassembler.hh"
 #include "ipv4_datagram.hh"
 #include "tcp_segment.hh"
 
@@ -10,10 +11,19 @@
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
+  private:
+    IPv4Reassembler _reassembler{};  //!< Fragments of datagrams for this connection, waiting for the rest
+
   public:
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! Called periodically when time elapses (gives up on fragmented datagrams that never completed)
+    void tick(const size_t ms_since_last_tick) { _reassembler.tick(ms_since_last_tick); }
+
+    //! The reassembler that fragments of incoming datagrams are put back together in
+    const IPv4Reassembler &reassembler() const { return _reassembler; }
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
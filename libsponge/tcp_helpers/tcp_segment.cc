@@ -19,9 +19,17 @@ ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer
     NetParser p{buffer};
     _header.parse(p);
     _payload = p.buffer();
+    _payload_sum.reset();
     return p.get_error();
 }
 
+//! \param[in] payload is the new payload
+//! \param[in] payload_sum is the ones' complement sum of `payload`, as returned by InternetChecksum::sum()
+void TCPSegment::set_payload(Buffer payload, const uint16_t payload_sum) {
+    _payload = move(payload);
+    _payload_sum = payload_sum;
+}
+
 size_t TCPSegment::length_in_sequence_space() const {
     return payload().str().size() + (header().syn ? 1 : 0) + (header().fin ? 1 : 0);
 }
@@ -31,15 +39,23 @@ BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
     header_out.cksum = 0;
 
+    // header只序列化一次（不需要分配内存），算出校验和之后直接填进去
+    Buffer::HeaderBytes header_bytes;
+    const size_t header_length = header_out.serialize(header_bytes);
+
     // calculate checksum -- taken over entire segment
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
-    check.add(_payload);
-    header_out.cksum = check.value();
+    // 如果payload的和已经知道了，只需要再加上header（header的长度是偶数，不影响payload的对齐）
+    InternetChecksum check(datagram_layer_checksum + _payload_sum.value_or(0));
+    check.add({header_bytes.data(), header_length});
+    if (not _payload_sum.has_value()) {
+        check.add(_payload);
+    }
+    char *cksum_field = header_bytes.data() + TCPHeader::CKSUM_OFFSET;
+    NetUnparser::u16(cksum_field, check.value());
 
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
+    // payload在slab里（TCPSender留了headroom）时，header直接写在它前面，结果是一个连续的Buffer
+    BufferList ret{_payload};
+    ret.prepend({header_bytes.data(), header_length});
 
     return ret;
 }
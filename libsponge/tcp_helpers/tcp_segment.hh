@@ -5,6 +5,7 @@
 #include "tcp_header.hh"
 
 #include <cstdint>
+#include <optional>
 
 //! \brief [TCP](\ref rfc::rfc793) segment
 class TCPSegment {
@@ -12,20 +13,35 @@ class TCPSegment {
     TCPHeader _header{};
     Buffer _payload{};
 
+    //! The ones' complement sum of `_payload` passed to set_payload() (cleared by any mutable access to the payload)
+    std::optional<uint16_t> _payload_sum{};
+
   public:
+    TCPSegment() = default;
+
+    //! \brief Decode a segment that has already been checked
+    explicit TCPSegment(const TCPHeaderView &view) : _header(view.decode()), _payload(view.payload()) {}
+
     //! \brief Parse the segment from a string
     ParseResult parse(const Buffer buffer, const uint32_t datagram_layer_checksum = 0);
 
     //! \brief Serialize the segment to a string
+    //! \note The payload is not read if its sum was supplied to set_payload()
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
 
+    //! \brief Replace the payload, along with its InternetChecksum::sum()
+    void set_payload(Buffer payload, const uint16_t payload_sum);
+
     //! \name Accessors
     //!@{
     const TCPHeader &header() const { return _header; }
     TCPHeader &header() { return _header; }
 
     const Buffer &payload() const { return _payload; }
-    Buffer &payload() { return _payload; }
+    Buffer &payload() {
+        _payload_sum.reset();
+        return _payload;
+    }
     //!@}
 
     //! \brief Segment's length in sequence space
@@ -1,110 +1,83 @@
 #include "tcp_state.hh"
 
-using namespace std;
-
-bool TCPState::operator==(const TCPState &other) const {
-    return _active == other._active and _linger_after_streams_finish == other._linger_after_streams_finish and
-           _sender == other._sender and _receiver == other._receiver;
-}
+#include <stdexcept>
 
-bool TCPState::operator!=(const TCPState &other) const { return not operator==(other); }
+using namespace std;
 
 string TCPState::name() const {
-    return "sender=`" + _sender + "`, receiver=`" + _receiver + "`, active=" + to_string(_active) +
-           ", linger_after_streams_finish=" + to_string(_linger_after_streams_finish);
-}
-
-TCPState::TCPState(const TCPState::State state) {
-    switch (state) {
-        case TCPState::State::LISTEN:
-            _receiver = TCPReceiverStateSummary::LISTEN;
-            _sender = TCPSenderStateSummary::CLOSED;
-            break;
-        case TCPState::State::SYN_RCVD:
-            _receiver = TCPReceiverStateSummary::SYN_RECV;
-            _sender = TCPSenderStateSummary::SYN_SENT;
-            break;
-        case TCPState::State::SYN_SENT:
-            _receiver = TCPReceiverStateSummary::LISTEN;
-            _sender = TCPSenderStateSummary::SYN_SENT;
-            break;
-        case TCPState::State::ESTABLISHED:
-            _receiver = TCPReceiverStateSummary::SYN_RECV;
-            _sender = TCPSenderStateSummary::SYN_ACKED;
-            break;
-        case TCPState::State::CLOSE_WAIT:
-            _receiver = TCPReceiverStateSummary::FIN_RECV;
-            _sender = TCPSenderStateSummary::SYN_ACKED;
-            _linger_after_streams_finish = false;
-            break;
-        case TCPState::State::LAST_ACK:
-            _receiver = TCPReceiverStateSummary::FIN_RECV;
-            _sender = TCPSenderStateSummary::FIN_SENT;
-            _linger_after_streams_finish = false;
-            break;
-        case TCPState::State::CLOSING:
-            _receiver = TCPReceiverStateSummary::FIN_RECV;
-            _sender = TCPSenderStateSummary::FIN_SENT;
-            break;
-        case TCPState::State::FIN_WAIT_1:
-            _receiver = TCPReceiverStateSummary::SYN_RECV;
-            _sender = TCPSenderStateSummary::FIN_SENT;
-            break;
-        case TCPState::State::FIN_WAIT_2:
-            _receiver = TCPReceiverStateSummary::SYN_RECV;
-            _sender = TCPSenderStateSummary::FIN_ACKED;
-            break;
-        case TCPState::State::TIME_WAIT:
-            _receiver = TCPReceiverStateSummary::FIN_RECV;
-            _sender = TCPSenderStateSummary::FIN_ACKED;
-            break;
-        case TCPState::State::RESET:
-            _receiver = TCPReceiverStateSummary::ERROR;
-            _sender = TCPSenderStateSummary::ERROR;
-            _linger_after_streams_finish = false;
-            _active = false;
-            break;
-        case TCPState::State::CLOSED:
-            _receiver = TCPReceiverStateSummary::FIN_RECV;
-            _sender = TCPSenderStateSummary::FIN_ACKED;
-            _linger_after_streams_finish = false;
-            _active = false;
-            break;
-    }
+    return "sender=`" + to_string(_sender) + "`, receiver=`" + to_string(_receiver) +
+           "`, active=" + ::to_string(_active) +
+           ", linger_after_streams_finish=" + ::to_string(_linger_after_streams_finish);
 }
 
 TCPState::TCPState(const TCPSender &sender, const TCPReceiver &receiver, const bool active, const bool linger)
-    : _sender(state_summary(sender))
-    , _receiver(state_summary(receiver))
+    : _sender(summarize(sender))
+    , _receiver(summarize(receiver))
     , _active(active)
     , _linger_after_streams_finish(active ? linger : false) {}
 
-string TCPState::state_summary(const TCPReceiver &receiver) {
+TCPState::ReceiverSummary TCPState::summarize(const TCPReceiver &receiver) {
     if (receiver.stream_out().error()) {
-        return TCPReceiverStateSummary::ERROR;
+        return ReceiverSummary::ERROR;
     } else if (not receiver.ackno().has_value()) {
-        return TCPReceiverStateSummary::LISTEN;
+        return ReceiverSummary::LISTEN;
     } else if (receiver.stream_out().input_ended()) {
-        return TCPReceiverStateSummary::FIN_RECV;
+        return ReceiverSummary::FIN_RECV;
     } else {
-        return TCPReceiverStateSummary::SYN_RECV;
+        return ReceiverSummary::SYN_RECV;
     }
 }
 
-string TCPState::state_summary(const TCPSender &sender) {
+TCPState::SenderSummary TCPState::summarize(const TCPSender &sender) {
     if (sender.stream_in().error()) {
-        return TCPSenderStateSummary::ERROR;
+        return SenderSummary::ERROR;
     } else if (sender.next_seqno_absolute() == 0) {
-        return TCPSenderStateSummary::CLOSED;
+        return SenderSummary::CLOSED;
     } else if (sender.next_seqno_absolute() == sender.bytes_in_flight()) {
-        return TCPSenderStateSummary::SYN_SENT;
+        return SenderSummary::SYN_SENT;
     } else if (not sender.stream_in().eof()) {
-        return TCPSenderStateSummary::SYN_ACKED;
+        return SenderSummary::SYN_ACKED;
     } else if (sender.next_seqno_absolute() < sender.stream_in().bytes_written() + 2) {
-        return TCPSenderStateSummary::SYN_ACKED;
+        return SenderSummary::SYN_ACKED;
     } else if (sender.bytes_in_flight()) {
-        return TCPSenderStateSummary::FIN_SENT;
+        return SenderSummary::FIN_SENT;
     } else {
-        return TCPSenderStateSummary::FIN_ACKED;
+        return SenderSummary::FIN_ACKED;
+    }
+}
+
+string TCPState::state_summary(const TCPReceiver &receiver) { return to_string(summarize(receiver)); }
+
+string TCPState::state_summary(const TCPSender &sender) { return to_string(summarize(sender)); }
+
+const string &TCPState::to_string(const ReceiverSummary summary) {
+    switch (summary) {
+        case ReceiverSummary::ERROR:
+            return TCPReceiverStateSummary::ERROR;
+        case ReceiverSummary::LISTEN:
+            return TCPReceiverStateSummary::LISTEN;
+        case ReceiverSummary::SYN_RECV:
+            return TCPReceiverStateSummary::SYN_RECV;
+        case ReceiverSummary::FIN_RECV:
+            return TCPReceiverStateSummary::FIN_RECV;
+    }
+    throw runtime_error("TCPState: unknown receiver summary");
+}
+
+const string &TCPState::to_string(const SenderSummary summary) {
+    switch (summary) {
+        case SenderSummary::ERROR:
+            return TCPSenderStateSummary::ERROR;
+        case SenderSummary::CLOSED:
+            return TCPSenderStateSummary::CLOSED;
+        case SenderSummary::SYN_SENT:
+            return TCPSenderStateSummary::SYN_SENT;
+        case SenderSummary::SYN_ACKED:
+            return TCPSenderStateSummary::SYN_ACKED;
+        case SenderSummary::FIN_SENT:
+            return TCPSenderStateSummary::FIN_SENT;
+        case SenderSummary::FIN_ACKED:
+            return TCPSenderStateSummary::FIN_ACKED;
     }
+    throw runtime_error("TCPState: unknown sender summary");
 }
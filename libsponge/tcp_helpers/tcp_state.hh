@@ -4,6 +4,7 @@
 #include "tcp_receiver.hh"
 #include "tcp_sender.hh"
 
+#include <cstdint>
 #include <string>
 
 //! \brief Summary of a TCPConnection's internal state
@@ -21,16 +22,7 @@
 //! sender/receiver states and two variables that belong to the
 //! overarching TCPConnection object.
 class TCPState {
-  private:
-    std::string _sender{};
-    std::string _receiver{};
-    bool _active{true};
-    bool _linger_after_streams_finish{true};
-
   public:
-    bool operator==(const TCPState &other) const;
-    bool operator!=(const TCPState &other) const;
-
     //! \brief Official state names from the [TCP](\ref rfc::rfc793) specification
     enum class State {
         LISTEN = 0,   //!< Listening for a peer to connect
@@ -47,22 +39,128 @@ class TCPState {
         RESET,        //!< A connection that terminated abnormally
     };
 
-    //! \brief Summarize the TCPState in a string
+    //! \brief State of a TCPReceiver (see TCPReceiverStateSummary for the printable form)
+    enum class ReceiverSummary : uint8_t {
+        ERROR = 0,  //!< error (connection was reset)
+        LISTEN,     //!< waiting for SYN: ackno is empty
+        SYN_RECV,   //!< SYN received (ackno exists), and input to stream hasn't ended
+        FIN_RECV,   //!< input to stream has ended
+    };
+
+    //! \brief State of a TCPSender (see TCPSenderStateSummary for the printable form)
+    enum class SenderSummary : uint8_t {
+        ERROR = 0,  //!< error (connection was reset)
+        CLOSED,     //!< waiting for stream to begin (no SYN sent)
+        SYN_SENT,   //!< stream started but nothing acknowledged
+        SYN_ACKED,  //!< stream ongoing
+        FIN_SENT,   //!< stream finished (FIN sent) but not fully acknowledged
+        FIN_ACKED,  //!< stream finished and fully acknowledged
+    };
+
+  private:
+    SenderSummary _sender{SenderSummary::CLOSED};
+    ReceiverSummary _receiver{ReceiverSummary::LISTEN};
+    bool _active{true};
+    bool _linger_after_streams_finish{true};
+
+  public:
+    //! \note Compares small integers only; no strings are built.
+    bool operator==(const TCPState &other) const {
+        return _active == other._active and _linger_after_streams_finish == other._linger_after_streams_finish and
+               _sender == other._sender and _receiver == other._receiver;
+    }
+
+    bool operator!=(const TCPState &other) const { return not operator==(other); }
+
+    //! \brief Summarize the TCPState in a string (for printing only)
     std::string name() const;
 
     //! \brief Construct a TCPState given a sender, a receiver, and the TCPConnection's active and linger bits
     TCPState(const TCPSender &sender, const TCPReceiver &receiver, const bool active, const bool linger);
 
     //! \brief Construct a TCPState that corresponds to one of the "official" TCP state names
-    TCPState(const TCPState::State state);
+    constexpr TCPState(const TCPState::State state);
+
+    //! \brief Summarize the state of a TCPReceiver without allocating
+    static ReceiverSummary summarize(const TCPReceiver &receiver);
+
+    //! \brief Summarize the state of a TCPSender without allocating
+    static SenderSummary summarize(const TCPSender &sender);
 
     //! \brief Summarize the state of a TCPReceiver in a string
     static std::string state_summary(const TCPReceiver &receiver);
 
     //! \brief Summarize the state of a TCPSender in a string
     static std::string state_summary(const TCPSender &receiver);
+
+    //! \brief Printable form of a ReceiverSummary
+    static const std::string &to_string(const ReceiverSummary summary);
+
+    //! \brief Printable form of a SenderSummary
+    static const std::string &to_string(const SenderSummary summary);
 };
 
+//! \details Defined in the header so that comparisons like `state() == TCPState::State::ESTABLISHED`
+//! reduce to a few integer compares.
+constexpr TCPState::TCPState(const TCPState::State state) {
+    switch (state) {
+        case TCPState::State::LISTEN:
+            _receiver = ReceiverSummary::LISTEN;
+            _sender = SenderSummary::CLOSED;
+            break;
+        case TCPState::State::SYN_RCVD:
+            _receiver = ReceiverSummary::SYN_RECV;
+            _sender = SenderSummary::SYN_SENT;
+            break;
+        case TCPState::State::SYN_SENT:
+            _receiver = ReceiverSummary::LISTEN;
+            _sender = SenderSummary::SYN_SENT;
+            break;
+        case TCPState::State::ESTABLISHED:
+            _receiver = ReceiverSummary::SYN_RECV;
+            _sender = SenderSummary::SYN_ACKED;
+            break;
+        case TCPState::State::CLOSE_WAIT:
+            _receiver = ReceiverSummary::FIN_RECV;
+            _sender = SenderSummary::SYN_ACKED;
+            _linger_after_streams_finish = false;
+            break;
+        case TCPState::State::LAST_ACK:
+            _receiver = ReceiverSummary::FIN_RECV;
+            _sender = SenderSummary::FIN_SENT;
+            _linger_after_streams_finish = false;
+            break;
+        case TCPState::State::CLOSING:
+            _receiver = ReceiverSummary::FIN_RECV;
+            _sender = SenderSummary::FIN_SENT;
+            break;
+        case TCPState::State::FIN_WAIT_1:
+            _receiver = ReceiverSummary::SYN_RECV;
+            _sender = SenderSummary::FIN_SENT;
+            break;
+        case TCPState::State::FIN_WAIT_2:
+            _receiver = ReceiverSummary::SYN_RECV;
+            _sender = SenderSummary::FIN_ACKED;
+            break;
+        case TCPState::State::TIME_WAIT:
+            _receiver = ReceiverSummary::FIN_RECV;
+            _sender = SenderSummary::FIN_ACKED;
+            break;
+        case TCPState::State::RESET:
+            _receiver = ReceiverSummary::ERROR;
+            _sender = SenderSummary::ERROR;
+            _linger_after_streams_finish = false;
+            _active = false;
+            break;
+        case TCPState::State::CLOSED:
+            _receiver = ReceiverSummary::FIN_RECV;
+            _sender = SenderSummary::FIN_ACKED;
+            _linger_after_streams_finish = false;
+            _active = false;
+            break;
+    }
+}
+
 namespace TCPReceiverStateSummary {
 const std::string ERROR = "error (connection was reset)";
 const std::string LISTEN = "waiting for SYN: ackno is empty";
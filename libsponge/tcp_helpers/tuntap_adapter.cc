@@ -19,7 +19,7 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
 optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
     // Read Ethernet frame from the raw device
     EthernetFrame frame;
-    if (frame.parse(_tap.read()) != ParseResult::NoError) {
+    if (frame.parse(_tap.read_packet()) != ParseResult::NoError) {
         return {};
     }
 
@@ -38,6 +38,7 @@ optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void TCPOverIPv4OverEthernetAdapter::tick(const size_t ms_since_last_tick) {
+    TCPOverIPv4Adapter::tick(ms_since_last_tick);
     _interface.tick(ms_since_last_tick);
     send_pending();
 }
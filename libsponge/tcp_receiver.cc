@@ -41,12 +41,9 @@ bool TCPReceiver::segment_received(const TCPSegment &seg) {
     size_t data_offset = (seg.header().doff - 5) * 4;
 
     // 把option从payload中去掉，得到真正的data
-    std::string data;
-    if (data_offset < seg.payload().copy().length()) {
-        data = seg.payload().copy().substr(data_offset);
-    } else {
-        data = seg.payload().copy();
-    }
+    // （payload已经在parse时校验过，这里只复制一次）
+    const string_view payload = seg.payload().str();
+    const std::string data(payload.substr(data_offset < payload.size() ? data_offset : 0));
 
     if (window == 0) {
         window = 1;
@@ -4,9 +4,6 @@
 
 #include <random>
 
-//为了使用NetUnparser
-#include <parser.hh>
-
 //为了用internet checksum
 #include <util.hh>
 
@@ -20,6 +17,9 @@ void DUMMY_CODE(Targs &&... /* unused */) {}
 
 using namespace std;
 
+static_assert(PacketPool::HEADROOM + TCPConfig::MAX_PAYLOAD_SIZE <= PacketPool::SLAB_SIZE,
+              "a segment's payload (and room for its headers) must fit in one slab");
+
 //! \param[in] capacity the capacity of the outgoing byte stream
 //! \param[in] retx_timeout the initial amount of time to wait before retransmitting the oldest outstanding segment
 //! \param[in] fixed_isn the Initial Sequence Number to use, if set (otherwise uses a random ISN)
@@ -91,15 +91,26 @@ void TCPSender::fill_window() {
 
         uint64_t expected_payload_len = min(*_receiver_window_sz, TCPConfig::MAX_PAYLOAD_SIZE);
 
-        string payload = _stream.read(expected_payload_len);
+        // 把payload从_stream复制到packet pool的slab里，同时计算它的和；
+        // 前面留出headroom，各层的header序列化时直接写在payload前面
+        // （payload和headroom不超过一个slab，见文件开头的static_assert）；
+        // stream里没有数据时（只发SYN/FIN，或者什么都不发）不需要slab
+        InternetChecksum payload_sum;
+        size_t payload_len = 0;
+        Buffer payload{};
+        if (_stream.buffer_size() > 0) {
+            PacketPool::Slab slab = PacketPool::allocate();
+            payload_len = _stream.read(slab.data() + PacketPool::HEADROOM, expected_payload_len, payload_sum);
+            payload = Buffer(move(slab), payload_len, PacketPool::HEADROOM);
+        }
 
         // 当窗口中还有剩余空间，并且对输出流的写入已经结束时，才会设置fin标志
-        if (_stream.eof() && payload.length() + syn < *_receiver_window_sz) {
+        if (_stream.eof() && payload_len + syn < *_receiver_window_sz) {
             fin = 1;
             output_ended = true;
         }
 
-        TCPSegment segment = make_segment(seqno, syn, fin, payload);
+        TCPSegment segment = make_segment(seqno, syn, fin, move(payload), payload_sum.sum());
 
         // 当出现空的segment时，
         // 说明对输出流的写入还没到来，没能从stream中读取到有效的字符串，
@@ -256,64 +267,24 @@ void TCPSender::send_empty_segment() {
     // 构造一个sequence space的长度为0的segment
     //      即：不包含syn、fin且payload长度为0的segment
     //
-    std::string empty_string;
-    TCPSegment empty_segment = make_segment(next_seqno(), 0, 0, empty_string);
+    TCPSegment empty_segment = make_segment(next_seqno(), 0, 0, {}, 0);
     _segments_out.push(empty_segment);
 }
 
 TCPSegment TCPSender::make_segment(const WrappingInt32 &seqno,
                                    const bool &syn,
                                    const bool &fin,
-                                   const std::string &payload) {
-    //      0                   1                   2                   3
-    //  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    // |          Source Port          |       Destination Port        |
-    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    // |                        Sequence Number                        |
-    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    // |                    Acknowledgment Number                      |
-    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    // |  Data |           |U|A|P|R|S|F|                               |
-    // | Offset| Reserved  |R|C|S|S|Y|I|            Window             |
-    // |       |           |G|K|H|T|N|N|                               |
-    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    // |           Checksum            |         Urgent Pointer        |
-    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    // |                    Options                    |    Padding    |
-    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    // |                             data                              |
-    // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-
-    // 首先需要以string的形式手搓一个header出来
-    // 还要注意小端序和大端序的转换
-    // 也许可以使用NetUnparser
-
-    std::string segment_as_string;
-    NetUnparser unparser;
-    unparser.u16(segment_as_string, 0);                  // source port留空
-    unparser.u16(segment_as_string, 0);                  // dest port留空
-    unparser.u32(segment_as_string, seqno.raw_value());  //用传入的seqno设置seqno
-    unparser.u32(segment_as_string, 0);                  // ackno留空
-    unparser.u8(segment_as_string, 5 << 4);              // data offset是20个字节，即5个四字
-    unparser.u8(segment_as_string,
-                static_cast<uint8_t>(fin) | (static_cast<uint8_t>(syn) << 1));  // flag中只设置syn和fin，其他留空
-    unparser.u16(segment_as_string, 0);                                         // window留空
-    unparser.u16(segment_as_string, 0);  // checksum留空，因为在这里还没有得到能够计算校验和的完整信息
-    unparser.u16(segment_as_string, 0);  // urgent pointer留空
-    //不设置options字段
-    //由于padding的作用是保证header的长度是四字节的整数倍，
-    //因此也不需要padding
-
-    segment_as_string.append(payload);  //拼接上payload
-
-    Buffer segment_as_buffer(std::move(segment_as_string));
-
-    InternetChecksum check(0);
-    check.add(segment_as_buffer);
-
+                                   Buffer &&payload,
+                                   const uint16_t payload_sum) {
+    // 直接填写header中由sender决定的字段；
+    // 端口、ackno、window和校验和留空，由TCPConnection和fd adapter在发送前填写
     TCPSegment segment;
-    segment.parse(segment_as_buffer, check.value());
+    segment.header().seqno = seqno;
+    segment.header().syn = syn;
+    segment.header().fin = fin;
+
+    // payload的和在复制时已经算好，之后填写header和重传时都不需要再读取payload
+    segment.set_payload(move(payload), payload_sum);
 
     return segment;
 }
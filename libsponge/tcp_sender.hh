@@ -142,24 +142,18 @@ class TCPSender {
     WrappingInt32 next_seqno() const { return wrap(_next_seqno, _isn); }
     //!@}
 
-    // 根据给定的seqno、syn、fin、payload
-    // 构造一个tcp segment
-    // 用到TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer_checksum)
-    //  这个方法会通过“NetParser p{buffer}”来用buffer的值初始化一个netparser
-    //  然后调用_header.parse(p)给TCPSegment中的header赋值，
-    //    同时还剔除了整个TCP报文中除了data以外的部分
-    //  接着用_payload = p.buffer()把剩下的data赋值给TCPSegment中的payload部分
-    //
-    // 所以首先要构造一个包含了header信息的string
-    // 然后把payload拼接到后面
-    // 再用这个string初始化一个buffer
-    // 再把这个buffer传给TCPSegment::parse
+    // 根据给定的seqno、syn、fin、payload构造一个tcp segment
     //
     // 其中seqno将来自于_next_seqno和_isn
     // syn将来自对_next_seqno == 0条件的检查
     // fin将来自_stream的eof标志
-    // payload将会从_stream.read()方法读取相应的字节形成string
-    TCPSegment make_segment(const WrappingInt32 &seqno, const bool &syn, const bool &fin, const std::string &payload);
+    // payload和它的和（InternetChecksum::sum()）将来自_stream.read()，
+    //   payload放在packet pool的slab里，segment序列化时不用再读一遍payload
+    TCPSegment make_segment(const WrappingInt32 &seqno,
+                            const bool &syn,
+                            const bool &fin,
+                            Buffer &&payload,
+                            const uint16_t payload_sum);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_SENDER_HH
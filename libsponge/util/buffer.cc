@@ -1,7 +1,89 @@
 #include "buffer.hh"
 
+#include <cstring>
+
 using namespace std;
 
+static atomic<bool> pool_enabled{true};
+static atomic<size_t> pool_heap_allocations{0};
+
+//! 每个线程的空闲slab链表；线程退出时归还给堆
+struct PacketPool::FreeList {
+    vector<Block *> blocks{};
+
+    FreeList() = default;
+    ~FreeList();
+    FreeList(const FreeList &) = delete;
+    FreeList &operator=(const FreeList &) = delete;
+};
+
+// 线程退出时，其他thread_local对象的析构函数可能在链表析构之后释放slab，
+// 这个（平凡析构的）标志告诉它们链表已经不在了
+static thread_local bool free_list_destroyed = false;
+
+PacketPool::FreeList::~FreeList() {
+    free_list_destroyed = true;
+    for (Block *block : blocks) {
+        delete block;
+    }
+}
+
+thread_local PacketPool::FreeList PacketPool::_free_list{};
+
+PacketPool::Slab PacketPool::allocate() {
+    Block *block = nullptr;
+    if (pool_enabled.load(memory_order_relaxed) and not free_list_destroyed and not _free_list.blocks.empty()) {
+        block = _free_list.blocks.back();
+        _free_list.blocks.pop_back();
+    } else {
+        block = new Block;
+        pool_heap_allocations.fetch_add(1, memory_order_relaxed);
+    }
+    block->refs.store(1, memory_order_relaxed);
+    block->headroom.store(0, memory_order_relaxed);
+    return Slab{block};
+}
+
+void PacketPool::_recycle(Block *block) {
+    if (pool_enabled.load(memory_order_relaxed) and not free_list_destroyed and _free_list.blocks.size() < MAX_FREE) {
+        _free_list.blocks.push_back(block);
+    } else {
+        delete block;
+    }
+}
+
+void PacketPool::set_enabled(const bool enabled) { pool_enabled.store(enabled); }
+
+bool PacketPool::enabled() { return pool_enabled.load(); }
+
+size_t PacketPool::heap_allocations() { return pool_heap_allocations.load(); }
+
+Buffer::Buffer(const HeaderBytes &bytes, const size_t size) : Buffer(with_headroom()) {
+    if (size > bytes.size()) {
+        throw out_of_range("Buffer: header too long");
+    }
+    prepend({bytes.data(), size});
+}
+
+Buffer::Buffer(PacketPool::Slab &&slab, const size_t size, const size_t headroom)
+    : _slab(move(slab)), _starting_offset(headroom), _size(headroom + size) {
+    if (headroom + size > PacketPool::SLAB_SIZE) {
+        throw out_of_range("Buffer: contents longer than a slab");
+    }
+    _slab.set_headroom(headroom);
+}
+
+Buffer Buffer::with_headroom() { return {PacketPool::allocate(), 0, PacketPool::SLAB_SIZE}; }
+
+bool Buffer::prepend(const string_view bytes) {
+    if (not _slab or not _slab.claim_headroom(_starting_offset, bytes.size())) {
+        return false;
+    }
+    _starting_offset -= bytes.size();
+    memcpy(_slab.data() + _starting_offset, bytes.data(), bytes.size());
+    return true;
+}
+
 void Buffer::remove_prefix(const size_t n) {
     if (n > str().size()) {
         throw out_of_range("Buffer::remove_prefix");
@@ -9,6 +91,11 @@ void Buffer::remove_prefix(const size_t n) {
     _starting_offset += n;
     if (_storage and _starting_offset == _storage->size()) {
         _storage.reset();
+        _starting_offset = 0;
+    } else if (_slab and _starting_offset == _size) {
+        _slab = {};
+        _starting_offset = 0;
+        _size = 0;
     }
 }
 
@@ -16,6 +103,29 @@ void BufferList::append(const BufferList &other) {
     for (const auto &buf : other._buffers) {
         _buffers.push_back(buf);
     }
+    _size += other._size;
+}
+
+void BufferList::prepend(const string_view header) {
+    // 空的BufferList换成一个带headroom的slab，这样后面几层的header也能连续地写进去
+    if (_size == 0) {
+        *this = Buffer::with_headroom();
+    }
+    if (_buffers.front().prepend(header)) {
+        _size += header.size();
+        return;
+    }
+
+    // 没有可用的headroom：header单独占一个Buffer，写在一个新slab的末尾，外面几层的header还能接着写在它前面
+    BufferList ret;
+    Buffer front = Buffer::with_headroom();
+    if (front.prepend(header)) {
+        ret.append(move(front));
+    } else {
+        ret.append(Buffer(string(header)));
+    }
+    ret.append(*this);
+    *this = move(ret);
 }
 
 BufferList::operator Buffer() const {
@@ -40,15 +150,11 @@ string BufferList::concatenate() const {
     return ret;
 }
 
-size_t BufferList::size() const {
-    size_t ret = 0;
-    for (const auto &buf : _buffers) {
-        ret += buf.size();
-    }
-    return ret;
-}
-
 void BufferList::remove_prefix(size_t n) {
+    if (n > _size) {
+        throw std::out_of_range("BufferList::remove_prefix");
+    }
+    _size -= n;
     while (n > 0) {
         if (_buffers.empty()) {
             throw std::out_of_range("BufferList::remove_prefix");
@@ -64,13 +170,17 @@ void BufferList::remove_prefix(size_t n) {
     }
 }
 
-BufferViewList::BufferViewList(const BufferList &buffers) {
+BufferViewList::BufferViewList(const BufferList &buffers) : _size(buffers.size()) {
     for (const auto &x : buffers.buffers()) {
         _views.push_back(x);
     }
 }
 
 void BufferViewList::remove_prefix(size_t n) {
+    if (n > _size) {
+        throw std::out_of_range("BufferListView::remove_prefix");
+    }
+    _size -= n;
     while (n > 0) {
         if (_views.empty()) {
             throw std::out_of_range("BufferListView::remove_prefix");
@@ -86,19 +196,35 @@ void BufferViewList::remove_prefix(size_t n) {
     }
 }
 
-size_t BufferViewList::size() const {
-    size_t ret = 0;
-    for (const auto &buf : _views) {
-        ret += buf.size();
+SmallVector<iovec, BufferList::INLINE_BUFFERS> BufferViewList::as_iovecs() const {
+    SmallVector<iovec, BufferList::INLINE_BUFFERS> ret;
+    for (const auto &x : _views) {
+        ret.push_back({const_cast<char *>(x.data()), x.size()});
     }
     return ret;
 }
 
-vector<iovec> BufferViewList::as_iovecs() const {
-    vector<iovec> ret;
-    ret.reserve(_views.size());
-    for (const auto &x : _views) {
-        ret.push_back({const_cast<char *>(x.data()), x.size()});
+PacketReceiveBuffer::PacketReceiveBuffer(const size_t limit) : _slab(PacketPool::allocate()) {
+    _iovecs[0] = {_slab.data(), min(limit, PacketPool::SLAB_SIZE)};
+    if (limit > PacketPool::SLAB_SIZE) {
+        // 比slab长的报文（很少见）先落到线程自己的溢出区，再复制出来
+        static thread_local string overflow;
+        overflow.resize(max(overflow.size(), limit - PacketPool::SLAB_SIZE));
+        _iovecs[1] = {overflow.data(), limit - PacketPool::SLAB_SIZE};
+        _iovec_count = 2;
+    }
+}
+
+Buffer PacketReceiveBuffer::finish(const size_t size) {
+    if (size <= _iovecs[0].iov_len) {
+        return {move(_slab), size};
+    }
+    if (size > _iovecs[0].iov_len + _iovecs[1].iov_len) {
+        throw out_of_range("PacketReceiveBuffer::finish");
     }
+    string ret;
+    ret.reserve(size);
+    ret.append(_slab.data(), _iovecs[0].iov_len);
+    ret.append(static_cast<const char *>(_iovecs[1].iov_base), size - _iovecs[0].iov_len);
     return ret;
 }
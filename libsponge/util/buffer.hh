@@ -1,21 +1,142 @@
 #ifndef SPONGE_LIBSPONGE_BUFFER_HH
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
+#include "small_vector.hh"
+
 #include <algorithm>
-#include <deque>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <numeric>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <sys/uio.h>
+#include <utility>
 #include <vector>
 
+//! \brief Per-thread pools of fixed-size, reference-counted storage for packets
+
+//! A Slab holds one packet of up to #SLAB_SIZE bytes. When the last reference to it goes away, it goes
+//! on a free list belonging to the thread that released it, and allocate() takes slabs from that list
+//! before it falls back to the heap. So, once a thread has warmed up, reading or building a packet
+//! doesn't allocate.
+class PacketPool {
+  public:
+    static constexpr size_t SLAB_SIZE = 2048;  //!< Bytes of storage per slab (a 1500-byte MTU plus link-layer headers)
+    static constexpr size_t MAX_FREE = 1024;   //!< Free slabs kept by each thread (more go back to the heap)
+
+    //! Bytes to leave in front of a payload, so that the TCP, IPv4 and Ethernet headers (with options)
+    //! can be written there (see Buffer::prepend())
+    static constexpr size_t HEADROOM = 192;
+
+  private:
+    //! Storage for one slab, with an intrusive reference count
+    struct Block {
+        std::atomic<uint32_t> refs;
+        std::atomic<uint32_t> headroom;  //!< Bytes at the front that no Buffer has claimed yet
+        char data[SLAB_SIZE];
+    };
+
+    struct FreeList;
+    static thread_local FreeList _free_list;  //!< This thread's free slabs
+
+    //! Put a block that nothing refers to any more on this thread's free list
+    static void _recycle(Block *block);
+
+  public:
+    //! \brief A counted reference to one slab (or to nothing)
+    class Slab {
+      private:
+        Block *_block{};
+
+        explicit Slab(Block *block) : _block(block) {}
+
+        void _release() {
+            if (_block and _block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                _recycle(_block);
+            }
+            _block = nullptr;
+        }
+
+        friend class PacketPool;
+
+      public:
+        Slab() = default;
+
+        Slab(const Slab &other) noexcept : _block(other._block) {
+            if (_block) {
+                _block->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        Slab(Slab &&other) noexcept : _block(std::exchange(other._block, nullptr)) {}
+
+        Slab &operator=(const Slab &other) noexcept {
+            Slab copy{other};
+            std::swap(_block, copy._block);
+            return *this;
+        }
+
+        Slab &operator=(Slab &&other) noexcept {
+            if (this != &other) {
+                _release();
+                _block = std::exchange(other._block, nullptr);
+            }
+            return *this;
+        }
+
+        ~Slab() { _release(); }
+
+        //! The slab's #SLAB_SIZE bytes of storage
+        char *data() { return _block->data; }
+        const char *data() const { return _block->data; }
+
+        //! Does this refer to a slab?
+        explicit operator bool() const { return _block != nullptr; }
+
+        //! \brief Mark the first `n` bytes as headroom that can be claimed
+        //! \note Only for a slab that nothing else refers to yet
+        void set_headroom(const size_t n) { _block->headroom.store(n, std::memory_order_relaxed); }
+
+        //! \brief Claim the `n` bytes just before `offset`, if `offset` is where the unclaimed headroom ends
+        //! \details Each byte of headroom can only be claimed once, so a header written there can't be
+        //! overwritten through another reference to the slab.
+        bool claim_headroom(const size_t offset, const size_t n) {
+            uint32_t expected = offset;
+            return n <= offset and
+                   _block->headroom.compare_exchange_strong(expected, offset - n, std::memory_order_relaxed);
+        }
+    };
+
+    //! Take a slab from this thread's free list, or from the heap if the list is empty
+    static Slab allocate();
+
+    //! \brief Turn recycling on or off (for all threads)
+    //! \details When recycling is off, every slab comes from the heap and goes back to it when released.
+    static void set_enabled(const bool enabled);
+
+    //! Is recycling on?
+    static bool enabled();
+
+    //! Number of slabs that have been taken from the heap so far, by all threads
+    static size_t heap_allocations();
+};
+
 //! \brief A reference-counted read-only string that can discard bytes from the front
+//! \details The contents can also be a PacketPool slab (for packets read from the network or built by
+//! TCPSender, and for serialized headers), so that making one doesn't allocate.
 class Buffer {
+  public:
+    //! Room to serialize one header into (any IPv4 or TCP header fits)
+    using HeaderBytes = std::array<char, 60>;
+
   private:
     std::shared_ptr<std::string> _storage{};
+    PacketPool::Slab _slab{};
     size_t _starting_offset{};
+    uint16_t _size{};  //!< Size of the contents of `_slab`
 
   public:
     Buffer() = default;
@@ -23,13 +144,26 @@ class Buffer {
     //! \brief Construct by taking ownership of a string
     Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
 
+    //! \brief Construct by copying the first `size` bytes of `bytes` to the end of a slab, after headroom
+    //! that more headers can be prepended into
+    Buffer(const HeaderBytes &bytes, const size_t size);
+
+    //! \brief Construct from `size` bytes of a slab, following `headroom` bytes that headers can be prepended into
+    Buffer(PacketPool::Slab &&slab, const size_t size, const size_t headroom = 0);
+
+    //! \brief An empty Buffer at the end of a PacketPool slab, which headers can be prepended to
+    static Buffer with_headroom();
+
     //! \name Expose contents as a std::string_view
     //!@{
     std::string_view str() const {
-        if (not _storage) {
-            return {};
+        if (_slab) {
+            return {_slab.data() + _starting_offset, _size - _starting_offset};
+        }
+        if (_storage) {
+            return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return {};
     }
 
     operator std::string_view() const { return str(); }
@@ -44,9 +178,23 @@ class Buffer {
     //! \brief Make a copy to a new std::string
     std::string copy() const { return std::string(str()); }
 
+    //! \brief Bytes of storage the string is part of, which stay allocated as long as the Buffer does
+    //! \details A whole slab, or the capacity of the std::string, however few bytes are left in the Buffer
+    size_t storage_size() const {
+        if (_slab) {
+            return PacketPool::SLAB_SIZE;
+        }
+        return _storage ? _storage->capacity() : 0;
+    }
+
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Write `bytes` in front of the string, into the headroom of its slab (does not copy the string)
+    //! \returns `false` (leaving the Buffer unchanged) if there isn't room, or if another Buffer has already
+    //! prepended something into this headroom
+    bool prepend(const std::string_view bytes);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -54,32 +202,59 @@ class Buffer {
 //! + a payload. This allows us to prepend headers (e.g., to
 //! encapsulate a TCP payload in a TCPSegment, and then encapsulate
 //! the TCPSegment in an IPv4Datagram) without copying the payload.
+//! \note The first two Buffers are stored in the BufferList itself. That is enough for a frame: its
+//! headers are prepended into the payload's slab, or, if the payload has no headroom, into one slab
+//! of their own in front of it (see prepend()).
 class BufferList {
+  public:
+    //! Number of Buffers held without a heap allocation
+    static constexpr size_t INLINE_BUFFERS = 2;
+
+    //! The sequence of Buffers
+    using Buffers = SmallVector<Buffer, INLINE_BUFFERS>;
+
   private:
-    std::deque<Buffer> _buffers{};
+    Buffers _buffers{};
+    size_t _size{};  //!< Sum of the sizes of `_buffers`
 
   public:
     //! \name Constructors
     //!@{
 
     BufferList() = default;
+    BufferList(const BufferList &other) = default;
+    BufferList &operator=(const BufferList &other) = default;
+    BufferList(BufferList &&other) noexcept
+        : _buffers(std::move(other._buffers)), _size(std::exchange(other._size, 0)) {}
+    BufferList &operator=(BufferList &&other) noexcept {
+        _buffers = std::move(other._buffers);
+        _size = std::exchange(other._size, 0);
+        return *this;
+    }
+    ~BufferList() = default;
 
     //! \brief Construct from a Buffer
-    BufferList(Buffer buffer) : _buffers{buffer} {}
+    BufferList(Buffer buffer) { append(std::move(buffer)); }
 
     //! \brief Construct by taking ownership of a std::string
     BufferList(std::string &&str) noexcept {
         Buffer buf{std::move(str)};
-        append(buf);
+        append(std::move(buf));
     }
     //!@}
 
-    //! \brief Access the underlying queue of Buffers
-    const std::deque<Buffer> &buffers() const { return _buffers; }
+    //! \brief Access the underlying sequence of Buffers
+    const Buffers &buffers() const { return _buffers; }
 
     //! \brief Append a BufferList
     void append(const BufferList &other);
 
+    //! \brief Append a Buffer
+    void append(Buffer buffer) {
+        _size += buffer.size();
+        _buffers.push_back(std::move(buffer));
+    }
+
     //! \brief Transform to a Buffer
     //! \note Throws an exception unless BufferList is contiguous
     operator Buffer() const;
@@ -87,16 +262,48 @@ class BufferList {
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     void remove_prefix(size_t n);
 
+    //! \brief Put `header` in front of the string
+    //! \details The header goes into the first Buffer's headroom if it can (see Buffer::prepend()), so that
+    //! encapsulating a payload in several layers of headers leaves a single contiguous Buffer. Otherwise it
+    //! becomes a Buffer of its own.
+    void prepend(const std::string_view header);
+
     //! \brief Size of the string
-    size_t size() const;
+    size_t size() const { return _size; }
 
     //! \brief Make a copy to a new std::string
     std::string concatenate() const;
 };
 
+//! \brief Storage to receive one packet of up to `limit` bytes into, with [readv(2)](\ref man2::readv) or
+//! [recvmsg(2)](\ref man2::recvmsg)
+
+//! The storage is a PacketPool slab, followed (for packets longer than that) by an overflow area
+//! that belongs to the thread.
+class PacketReceiveBuffer {
+  private:
+    PacketPool::Slab _slab;
+    std::array<iovec, 2> _iovecs{};
+    int _iovec_count{1};
+
+  public:
+    explicit PacketReceiveBuffer(const size_t limit);
+
+    //! \name The storage, as scatter buffers
+    //!@{
+    iovec *iovecs() { return _iovecs.data(); }
+    int iovec_count() const { return _iovec_count; }
+    //!@}
+
+    //! \brief The first `size` bytes that were received
+    //! \note Keeps the slab, unless the packet didn't fit in it and had to be copied into a string
+    Buffer finish(const size_t size);
+};
+
 //! \brief A non-owning temporary view (similar to std::string_view) of a discontiguous string
 class BufferViewList {
-    std::deque<std::string_view> _views{};
+    SmallVector<std::string_view, BufferList::INLINE_BUFFERS> _views{};
+    size_t _size{};  //!< Sum of the sizes of `_views`
 
   public:
     //! \name Constructors
@@ -112,19 +319,30 @@ class BufferViewList {
     BufferViewList(const BufferList &buffers);
 
     //! \brief Construct from a std::string_view
-    BufferViewList(std::string_view str) { _views.push_back({const_cast<char *>(str.data()), str.size()}); }
+    BufferViewList(std::string_view str) : _size(str.size()) { _views.push_back(str); }
+
+    BufferViewList(const BufferViewList &other) = default;
+    BufferViewList &operator=(const BufferViewList &other) = default;
+    BufferViewList(BufferViewList &&other) noexcept
+        : _views(std::move(other._views)), _size(std::exchange(other._size, 0)) {}
+    BufferViewList &operator=(BufferViewList &&other) noexcept {
+        _views = std::move(other._views);
+        _size = std::exchange(other._size, 0);
+        return *this;
+    }
+    ~BufferViewList() = default;
     //!@}
 
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     void remove_prefix(size_t n);
 
     //! \brief Size of the string
-    size_t size() const;
+    size_t size() const { return _size; }
 
-    //! \brief Convert to a vector of `iovec` structures
+    //! \brief Convert to a sequence of `iovec` structures
     //! \note used for system calls that write discontiguous buffers,
     //! e.g. [writev(2)](\ref man2::writev) and [sendmsg(2)](\ref man2::sendmsg)
-    std::vector<iovec> as_iovecs() const;
+    SmallVector<iovec, BufferList::INLINE_BUFFERS> as_iovecs() const;
 };
 
 #endif  // SPONGE_LIBSPONGE_BUFFER_HH
@@ -73,13 +73,30 @@ string FileDescriptor::read(const size_t limit) {
     return ret;
 }
 
+//! \param[in] limit is the maximum size of the packet
+//! \returns the packet, which shares a slab with nothing else unless it was longer than a slab
+Buffer FileDescriptor::read_packet(const size_t limit) {
+    PacketReceiveBuffer storage{limit};
+
+    const ssize_t bytes_read = SystemCall("readv", ::readv(fd_num(), storage.iovecs(), storage.iovec_count()));
+    if (limit > 0 && bytes_read == 0) {
+        _internal_fd->_eof = true;
+    }
+
+    register_read();
+    return storage.finish(bytes_read);
+}
+
 size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     size_t total_bytes_written = 0;
 
     do {
         auto iovecs = buffer.as_iovecs();
 
-        const ssize_t bytes_written = SystemCall("writev", ::writev(fd_num(), iovecs.data(), iovecs.size()));
+        // 连续的packet（header都写在了headroom里）只需要一次write()
+        const ssize_t bytes_written =
+            iovecs.size() == 1 ? SystemCall("write", ::write(fd_num(), iovecs[0].iov_base, iovecs[0].iov_len))
+                               : SystemCall("writev", ::writev(fd_num(), iovecs.data(), iovecs.size()));
         if (bytes_written == 0 and buffer.size() != 0) {
             throw runtime_error("write returned 0 given non-empty input buffer");
         }
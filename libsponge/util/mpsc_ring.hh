@@ -0,0 +1,92 @@
+#ifndef SPONGE_LIBSPONGE_MPSC_RING_HH
+#define SPONGE_LIBSPONGE_MPSC_RING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+//! \brief A bounded, lock-free queue that any number of threads push to and one thread pops from
+
+//! Each slot carries a sequence number that says whose turn it is: a producer claims the slot at
+//! the tail by advancing the tail with a compare-and-swap, fills it, and then publishes it by
+//! bumping its sequence; the consumer takes the slot at the head once it's published, and hands
+//! it back to the producers of the next lap. (This is D. Vyukov's bounded queue, with a plain head
+//! because there is only one consumer.) Neither side ever waits for the other inside push() or pop().
+template <typename T>
+class MPSCRing {
+  private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    size_t _mask;
+    std::unique_ptr<Slot[]> _slots;
+
+    // 生产者和消费者各自写的计数放在不同的cache line里
+    alignas(64) std::atomic<size_t> _tail{0};  //!< Next position for producers to claim
+    alignas(64) size_t _head{0};               //!< Next position for the consumer to take
+
+  public:
+    //! A ring with room for `capacity` elements, rounded up to a power of two
+    explicit MPSCRing(const size_t capacity) : _mask(0), _slots() {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        _mask = size - 1;
+        _slots = std::make_unique<Slot[]>(size);
+        for (size_t i = 0; i < size; i++) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    //! \brief Add `value` at the tail (from any thread)
+    //! \returns false, leaving `value` untouched, if the ring is full
+    bool push(T &&value) {
+        size_t position = _tail.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &_slots[position & _mask];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t lap = intptr_t(sequence) - intptr_t(position);
+            if (lap == 0) {
+                // 这个slot空着，轮到position：抢占它（失败时position被更新为新的tail）
+                if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lap < 0) {
+                // 消费者还没有取走上一圈的元素
+                return false;
+            } else {
+                position = _tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->value = std::move(value);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Take the element at the head (from the consumer thread only)
+    //! \returns false if the ring is empty
+    bool pop(T &value) {
+        Slot &slot = _slots[_head & _mask];
+        if (slot.sequence.load(std::memory_order_acquire) != _head + 1) {
+            return false;
+        }
+
+        value = std::move(slot.value);
+        slot.value = T{};
+        slot.sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    //! Number of elements the ring can hold
+    size_t capacity() const { return _mask + 1; }
+};
+
+#endif  // SPONGE_LIBSPONGE_MPSC_RING_HH
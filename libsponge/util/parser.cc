@@ -1,7 +1,15 @@
 #include "parser.hh"
 
+#include <cstring>
+#include <endian.h>
+
 using namespace std;
 
+// 网络字节序和主机字节序之间的转换（这个变换是自反的，两个方向通用）
+static uint8_t network_order(const uint8_t val) { return val; }
+static uint16_t network_order(const uint16_t val) { return htobe16(val); }
+static uint32_t network_order(const uint32_t val) { return htobe32(val); }
+
 //! \param[in] r is the ParseResult to show
 //! \returns a string representation of the ParseResult
 string as_string(const ParseResult r) {
@@ -17,8 +25,15 @@ string as_string(const ParseResult r) {
     return _names[static_cast<size_t>(r)];
 }
 
+Buffer NetParser::buffer() const {
+    // Buffer只在这里调整一次，解析每个整数时只移动_remaining
+    Buffer ret = _buffer;
+    ret.remove_prefix(_buffer.size() - _remaining.size());
+    return ret;
+}
+
 void NetParser::_check_size(const size_t size) {
-    if (size > _buffer.size()) {
+    if (size > _remaining.size()) {
         set_error(ParseResult::PacketTooShort);
     }
 }
@@ -31,15 +46,12 @@ T NetParser::_parse_int() {
         return 0;
     }
 
-    T ret = 0;
-    for (size_t i = 0; i < len; i++) {
-        ret <<= 8;
-        ret += uint8_t(_buffer.at(i));
-    }
-
-    _buffer.remove_prefix(len);
+    // 长度已经检查过，整个整数一次读出
+    T ret;
+    memcpy(&ret, _remaining.data(), len);
+    _remaining.remove_prefix(len);
 
-    return ret;
+    return network_order(ret);
 }
 
 void NetParser::remove_prefix(const size_t n) {
@@ -47,16 +59,20 @@ void NetParser::remove_prefix(const size_t n) {
     if (error()) {
         return;
     }
-    _buffer.remove_prefix(n);
+    _remaining.remove_prefix(n);
 }
 
 template <typename T>
 void NetUnparser::_unparse_int(string &s, T val) {
-    constexpr size_t len = sizeof(T);
-    for (size_t i = 0; i < len; ++i) {
-        const uint8_t the_byte = (val >> ((len - i - 1) * 8)) & 0xff;
-        s.push_back(the_byte);
-    }
+    const T net = network_order(val);
+    s.append(reinterpret_cast<const char *>(&net), sizeof(T));
+}
+
+template <typename T>
+void NetUnparser::_unparse_int(char *&out, T val) {
+    const T net = network_order(val);
+    memcpy(out, &net, sizeof(T));
+    out += sizeof(T);
 }
 
 uint32_t NetParser::u32() { return _parse_int<uint32_t>(); }
@@ -70,3 +86,9 @@ void NetUnparser::u32(string &s, const uint32_t val) { return _unparse_int<uint3
 void NetUnparser::u16(string &s, const uint16_t val) { return _unparse_int<uint16_t>(s, val); }
 
 void NetUnparser::u8(string &s, const uint8_t val) { return _unparse_int<uint8_t>(s, val); }
+
+void NetUnparser::u32(char *&out, const uint32_t val) { return _unparse_int<uint32_t>(out, val); }
+
+void NetUnparser::u16(char *&out, const uint16_t val) { return _unparse_int<uint16_t>(out, val); }
+
+void NetUnparser::u8(char *&out, const uint8_t val) { return _unparse_int<uint8_t>(out, val); }
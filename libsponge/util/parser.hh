@@ -5,7 +5,10 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <endian.h>
 #include <string>
+#include <string_view>
 #include <utility>
 
 //! The result of parsing or unparsing an IP datagram, TCP segment, Ethernet frame, or ARP message
@@ -25,6 +28,7 @@ std::string as_string(const ParseResult r);
 class NetParser {
   private:
     Buffer _buffer;
+    std::string_view _remaining;                //!< The part of `_buffer` that hasn't been parsed yet
     ParseResult _error = ParseResult::NoError;  //!< Result of parsing so far
 
     //! Check that there is sufficient data to parse the next token
@@ -35,9 +39,13 @@ class NetParser {
     T _parse_int();
 
   public:
-    NetParser(Buffer buffer) : _buffer(buffer) {}
+    NetParser(Buffer buffer) : _buffer(buffer), _remaining(_buffer.str()) {}
 
-    Buffer buffer() const { return _buffer; }
+    //! The data that hasn't been parsed yet
+    Buffer buffer() const;
+
+    //! Number of bytes that haven't been parsed yet
+    size_t size() const { return _remaining.size(); }
 
     //! Get the current value stored in BaseParser::_error
     ParseResult get_error() const { return _error; }
@@ -62,10 +70,15 @@ class NetParser {
     void remove_prefix(const size_t n);
 };
 
+//! \details Integers can be appended to a string, or written to a buffer that has already been
+//! allocated (e.g. for a fixed-size header) through a cursor that advances past each one.
 struct NetUnparser {
     template <typename T>
     static void _unparse_int(std::string &s, T val);
 
+    template <typename T>
+    static void _unparse_int(char *&out, T val);
+
     //! Write a 32-bit integer into the data stream in network byte order
     static void u32(std::string &s, const uint32_t val);
 
@@ -74,6 +87,36 @@ struct NetUnparser {
 
     //! Write an 8-bit integer into the data stream in network byte order
     static void u8(std::string &s, const uint8_t val);
+
+    //! Write a 32-bit integer at `out` in network byte order, and advance `out` past it
+    static void u32(char *&out, const uint32_t val);
+
+    //! Write a 16-bit integer at `out` in network byte order, and advance `out` past it
+    static void u16(char *&out, const uint16_t val);
+
+    //! Write an 8-bit integer at `out`, and advance `out` past it
+    static void u8(char *&out, const uint8_t val);
+};
+
+//! \details Reads integers in network byte order straight from bytes that are known to be there, e.g. the
+//! fields of a header whose length has already been checked (see IPv4HeaderView and TCPHeaderView).
+struct NetPeeker {
+    //! Read an 8-bit integer at `p`
+    static uint8_t u8(const char *p) { return uint8_t(*p); }
+
+    //! Read a 16-bit integer at `p` in network byte order
+    static uint16_t u16(const char *p) {
+        uint16_t val;
+        memcpy(&val, p, sizeof(val));
+        return be16toh(val);
+    }
+
+    //! Read a 32-bit integer at `p` in network byte order
+    static uint32_t u32(const char *p) {
+        uint32_t val;
+        memcpy(&val, p, sizeof(val));
+        return be32toh(val);
+    }
 };
 
 #endif  // SPONGE_LIBSPONGE_PARSER_HH
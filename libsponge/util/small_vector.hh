@@ -0,0 +1,117 @@
+#ifndef SPONGE_LIBSPONGE_SMALL_VECTOR_HH
+#define SPONGE_LIBSPONGE_SMALL_VECTOR_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//! \brief A sequence that keeps up to `N` elements inside the object and only uses the heap beyond that
+
+//! Elements are appended at the back and removed from the front (like the std::deque it replaces
+//! in BufferList), and are stored contiguously. Removed elements are reset to `T{}`, so that they
+//! don't hold on to resources.
+template <typename T, size_t N>
+class SmallVector {
+  private:
+    std::array<T, N> _inline{};
+    std::vector<T> _heap{};  //!< All of the elements, once there have been more than `N` at a time
+    size_t _begin{};         //!< Index of the first element in `_inline` or `_heap`
+    size_t _end{};           //!< Index one past the last element in `_inline` or `_heap`
+
+    T *_storage() { return _heap.empty() ? _inline.data() : _heap.data(); }
+    const T *_storage() const { return _heap.empty() ? _inline.data() : _heap.data(); }
+
+    void _reset() {
+        _heap.clear();
+        _begin = 0;
+        _end = 0;
+    }
+
+  public:
+    SmallVector() = default;
+    SmallVector(const SmallVector &other) = default;
+    SmallVector &operator=(const SmallVector &other) = default;
+
+    SmallVector(SmallVector &&other) noexcept
+        : _inline(std::move(other._inline)), _heap(std::move(other._heap)), _begin(other._begin), _end(other._end) {
+        other._reset();
+    }
+
+    SmallVector &operator=(SmallVector &&other) noexcept {
+        if (this != &other) {
+            _inline = std::move(other._inline);
+            _heap = std::move(other._heap);
+            _begin = other._begin;
+            _end = other._end;
+            other._reset();
+        }
+        return *this;
+    }
+
+    ~SmallVector() = default;
+
+    //! \name Element access
+    //!@{
+    T *data() { return _storage() + _begin; }
+    const T *data() const { return _storage() + _begin; }
+    T *begin() { return data(); }
+    T *end() { return _storage() + _end; }
+    const T *begin() const { return data(); }
+    const T *end() const { return _storage() + _end; }
+    T &front() { return *data(); }
+    const T &front() const { return *data(); }
+    T &operator[](const size_t i) { return data()[i]; }
+    const T &operator[](const size_t i) const { return data()[i]; }
+    //!@}
+
+    size_t size() const { return _end - _begin; }
+    bool empty() const { return _begin == _end; }
+
+    //! Does the sequence live in the object itself (i.e. hasn't had to go to the heap)?
+    bool is_inline() const { return _heap.empty(); }
+
+    void push_back(T value) {
+        if (_heap.empty()) {
+            if (_end == N and _begin > 0) {
+                // 前面有已经移除的位置，把剩下的元素挪到开头
+                std::move(_inline.begin() + _begin, _inline.end(), _inline.begin());
+                std::fill(_inline.end() - _begin, _inline.end(), T{});
+                _end -= _begin;
+                _begin = 0;
+            }
+            if (_end < N) {
+                _inline[_end++] = std::move(value);
+                return;
+            }
+
+            // 放不下了：全部搬到堆上
+            _heap.reserve(2 * N);
+            for (auto &element : _inline) {
+                _heap.push_back(std::exchange(element, T{}));
+            }
+        }
+        _heap.push_back(std::move(value));
+        _end++;
+    }
+
+    void pop_front() {
+        _storage()[_begin++] = T{};
+        if (_begin == _end) {
+            _reset();
+        } else if (not _heap.empty() and _begin >= N and 2 * _begin >= _end) {
+            // 当作队列用时，别让堆上已经移除的元素越积越多
+            _heap.erase(_heap.begin(), _heap.begin() + _begin);
+            _end -= _begin;
+            _begin = 0;
+        }
+    }
+
+    void clear() {
+        std::fill(begin(), end(), T{});
+        _reset();
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_SMALL_VECTOR_HH
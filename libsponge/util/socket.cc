@@ -85,29 +85,31 @@ void Socket::shutdown(const int how) {
 }
 
 //! \note If `mtu` is too small to hold the received datagram, this method throws a std::runtime_error
+//! \note Datagrams that fit in a PacketPool slab are received straight into one
 void UDPSocket::recv(received_datagram &datagram, const size_t mtu) {
     // receive source address and payload
     Address::Raw datagram_source_address;
-    datagram.payload.resize(mtu);
+    PacketReceiveBuffer storage{mtu};
 
-    socklen_t fromlen = sizeof(datagram_source_address);
+    msghdr message{};
+    message.msg_name = &datagram_source_address.storage;
+    message.msg_namelen = sizeof(datagram_source_address.storage);
+    message.msg_iov = storage.iovecs();
+    message.msg_iovlen = storage.iovec_count();
 
-    const ssize_t recv_len = SystemCall(
-        "recvfrom",
-        ::recvfrom(
-            fd_num(), datagram.payload.data(), datagram.payload.size(), MSG_TRUNC, datagram_source_address, &fromlen));
+    const ssize_t recv_len = SystemCall("recvmsg", ::recvmsg(fd_num(), &message, MSG_TRUNC));
 
     if (recv_len > ssize_t(mtu)) {
-        throw runtime_error("recvfrom (oversized datagram)");
+        throw runtime_error("recvmsg (oversized datagram)");
     }
 
     register_read();
-    datagram.source_address = {datagram_source_address, fromlen};
-    datagram.payload.resize(recv_len);
+    datagram.source_address = {datagram_source_address, message.msg_namelen};
+    datagram.payload = storage.finish(recv_len);
 }
 
 UDPSocket::received_datagram UDPSocket::recv(const size_t mtu) {
-    received_datagram ret{{nullptr, 0}, ""};
+    received_datagram ret{{nullptr, 0}, {}};
     recv(ret, mtu);
     return ret;
 }
@@ -61,7 +61,7 @@ class UDPSocket : public Socket {
     //! Returned by UDPSocket::recv; carries received data and information about the sender
     struct received_datagram {
         Address source_address;  //!< Address from which this datagram was received
-        std::string payload;     //!< UDP datagram payload
+        Buffer payload;          //!< UDP datagram payload
     };
 
     //! Receive a datagram and the Address of its sender
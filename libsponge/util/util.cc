@@ -3,11 +3,18 @@
 #include <array>
 #include <cctype>
 #include <chrono>
+#include <cstring>
+#include <endian.h>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <sys/socket.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 //! \returns the number of milliseconds since the program started
@@ -86,7 +93,239 @@ mt19937 get_random_generator() {
 //! on the Internet checksum, and consult the [IP](\ref rfc::rfc791) and [TCP](\ref rfc::rfc793) RFCs.
 InternetChecksum::InternetChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
 
+// 以下几个函数对长度为8的倍数的数据求和，把数据看作主机字节序的整数。
+// 返回值与这些16位字的和模0xffff同余（64位的反码加法和32位整数的普通加法都满足这一点），
+// 并且只有在数据全为0时才返回0
+namespace {
+
+using SumFn = uint64_t (*)(const char *, const size_t);
+using CopySumFn = uint64_t (*)(char *, const char *, const size_t);
+
+// 64位反码加法：进位绕回最低位
+inline uint64_t add_with_carry(const uint64_t a, const uint64_t b) {
+    const uint64_t sum = a + b;
+    return sum + (sum < b);
+}
+
+uint64_t sum_words_scalar(const char *data, const size_t len) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        sum = add_with_carry(sum, word);
+    }
+    return sum;
+}
+
+// 与上面相同，同时把数据复制到dst
+uint64_t copy_sum_words_scalar(char *dst, const char *src, const size_t len) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < len; i += 8) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        memcpy(dst + i, &word, sizeof(word));
+        sum = add_with_carry(sum, word);
+    }
+    return sum;
+}
+
+#if defined(__x86_64__)
+// 每个64位的lane累加零扩展的32位整数，在2^32次加法之内不会溢出
+uint64_t sum_words_sse2(const char *data, const size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero, acc1 = zero;
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, zero));
+    }
+
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), _mm_add_epi64(acc0, acc1));
+    return add_with_carry(add_with_carry(lanes[0], lanes[1]), sum_words_scalar(data + i, len - i));
+}
+
+__attribute__((target("avx2"))) uint64_t sum_words_avx2(const char *data, const size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero, acc1 = zero;
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+    }
+
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+    const uint64_t sum = add_with_carry(add_with_carry(lanes[0], lanes[1]), add_with_carry(lanes[2], lanes[3]));
+    return add_with_carry(sum, sum_words_sse2(data + i, len - i));
+}
+
+uint64_t copy_sum_words_sse2(char *dst, const char *src, const size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero, acc1 = zero;
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, zero));
+    }
+
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), _mm_add_epi64(acc0, acc1));
+    return add_with_carry(add_with_carry(lanes[0], lanes[1]), copy_sum_words_scalar(dst + i, src + i, len - i));
+}
+
+__attribute__((target("avx2"))) uint64_t copy_sum_words_avx2(char *dst, const char *src, const size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero, acc1 = zero;
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), v);
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+    }
+
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+    const uint64_t sum = add_with_carry(add_with_carry(lanes[0], lanes[1]), add_with_carry(lanes[2], lanes[3]));
+    return add_with_carry(sum, copy_sum_words_sse2(dst + i, src + i, len - i));
+}
+#endif
+
+SumFn select_sum_words() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        return sum_words_avx2;
+    }
+    return sum_words_sse2;
+#else
+    return sum_words_scalar;
+#endif
+}
+
+CopySumFn select_copy_sum_words() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        return copy_sum_words_avx2;
+    }
+    return copy_sum_words_sse2;
+#else
+    return copy_sum_words_scalar;
+#endif
+}
+
+const SumFn sum_words = select_sum_words();
+const CopySumFn copy_sum_words = select_copy_sum_words();
+
+// 把64位的和折叠成16位（结果非0当且仅当输入非0）
+inline uint16_t fold(uint64_t sum) {
+    sum = (sum >> 32) + (sum & 0xffffffff);
+    sum = (sum >> 32) + (sum & 0xffffffff);
+    sum = (sum >> 16) + (sum & 0xffff);
+    sum = (sum >> 16) + (sum & 0xffff);
+    return sum;
+}
+
+// 对4个packet开头的len字节（8的倍数）分别求和，结果与对每个packet调用sum_words()相同
+using SumX4Fn = void (*)(const char *const *data, const size_t len, uint64_t *sums);
+
+#if defined(__x86_64__)
+// 每个packet一个累加器，4条依赖链互不相关，可以同时执行
+void sum_words_x4_sse2(const char *const *data, const size_t len, uint64_t *sums) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc[4] = {zero, zero, zero, zero};
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        for (size_t k = 0; k < 4; k++) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data[k] + i));
+            acc[k] = _mm_add_epi64(acc[k], _mm_add_epi64(_mm_unpacklo_epi32(v, zero), _mm_unpackhi_epi32(v, zero)));
+        }
+    }
+
+    // 转置相加：第k个lane是第k个packet的和
+    const __m128i sum01 = _mm_add_epi64(_mm_unpacklo_epi64(acc[0], acc[1]), _mm_unpackhi_epi64(acc[0], acc[1]));
+    const __m128i sum23 = _mm_add_epi64(_mm_unpacklo_epi64(acc[2], acc[3]), _mm_unpackhi_epi64(acc[2], acc[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sums), sum01);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + 2), sum23);
+
+    for (size_t k = 0; k < 4; k++) {
+        sums[k] = add_with_carry(sums[k], sum_words_scalar(data[k] + i, len - i));
+    }
+}
+
+__attribute__((target("avx2"))) void sum_words_x4_avx2(const char *const *data, const size_t len, uint64_t *sums) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc[4] = {zero, zero, zero, zero};
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        for (size_t k = 0; k < 4; k++) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data[k] + i));
+            acc[k] = _mm256_add_epi64(acc[k],
+                                      _mm256_add_epi64(_mm256_unpacklo_epi32(v, zero), _mm256_unpackhi_epi32(v, zero)));
+        }
+    }
+
+    // 转置相加：先在每个128位的半边内两两相加，再把两个半边相加，第k个lane是第k个packet的和
+    const __m256i sum01 =
+        _mm256_add_epi64(_mm256_unpacklo_epi64(acc[0], acc[1]), _mm256_unpackhi_epi64(acc[0], acc[1]));
+    const __m256i sum23 =
+        _mm256_add_epi64(_mm256_unpacklo_epi64(acc[2], acc[3]), _mm256_unpackhi_epi64(acc[2], acc[3]));
+    const __m256i total = _mm256_add_epi64(_mm256_permute2x128_si256(sum01, sum23, 0x20),
+                                           _mm256_permute2x128_si256(sum01, sum23, 0x31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(sums), total);
+
+    for (size_t k = 0; k < 4; k++) {
+        sums[k] = add_with_carry(sums[k], sum_words_scalar(data[k] + i, len - i));
+    }
+}
+#else
+void sum_words_x4_scalar(const char *const *data, const size_t len, uint64_t *sums) {
+    for (size_t k = 0; k < 4; k++) {
+        sums[k] = sum_words(data[k], len);
+    }
+}
+#endif
+
+SumX4Fn select_sum_words_x4() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        return sum_words_x4_avx2;
+    }
+    return sum_words_x4_sse2;
+#else
+    return sum_words_x4_scalar;
+#endif
+}
+
+const SumX4Fn sum_words_x4 = select_sum_words_x4();
+
+}  // namespace
+
 void InternetChecksum::add(std::string_view data) {
+    // 上一次add()结束在奇数位置：第一个字节是一个16位字的低字节
+    if (_parity and not data.empty()) {
+        _sum += uint8_t(data.front());
+        data.remove_prefix(1);
+        _parity = false;
+    }
+
+    // 成块地按主机字节序求和，最后再换回网络字节序（反码和与字节序无关，只需交换结果的两个字节）
+    const size_t aligned = data.size() & ~size_t(7);
+    if (aligned > 0) {
+        _sum += be16toh(fold(sum_words(data.data(), aligned)));
+        data.remove_prefix(aligned);
+    }
+
     for (size_t i = 0; i < data.size(); i++) {
         uint16_t val = uint8_t(data[i]);
         if (not _parity) {
@@ -98,7 +337,7 @@ void InternetChecksum::add(std::string_view data) {
 }
 
 uint16_t InternetChecksum::value() const {
-    uint32_t ret = _sum;
+    uint64_t ret = _sum;
 
     while (ret > 0xffff) {
         ret = (ret >> 16) + (ret & 0xffff);
@@ -107,6 +346,96 @@ uint16_t InternetChecksum::value() const {
     return ~ret;
 }
 
+//! \param[in] cksum is the checksum before the change
+//! \param[in] old_word is the 16-bit word (at an even offset into the data) before the change
+//! \param[in] new_word is the same word after the change
+//! \returns the checksum of the changed data
+uint16_t InternetChecksum::adjust(const uint16_t cksum, const uint16_t old_word, const uint16_t new_word) {
+    uint32_t sum = uint16_t(~cksum) + uint16_t(~old_word) + new_word;
+
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+
+    return ~sum;
+}
+
+//! \param[out] dst is where to copy the data (at least `src.size()` bytes, not overlapping `src`)
+//! \param[in] src is the data to copy and sum
+//! \param[in,out] checksum accumulates the sum of `src`
+void copy_and_checksum(char *dst, string_view src, InternetChecksum &checksum) {
+    // 奇数位置上的第一个字节和末尾不足一个字的字节交给add()，中间的整字在复制的同时求和
+    const size_t head = checksum._parity ? min(size_t(1), src.size()) : 0;
+    const size_t aligned = (src.size() - head) & ~size_t(7);
+
+    if (head > 0) {
+        *dst++ = src.front();
+        checksum.add(src.substr(0, head));
+        src.remove_prefix(head);
+    }
+
+    if (aligned > 0) {
+        checksum._sum += be16toh(fold(copy_sum_words(dst, src.data(), aligned)));
+        src.remove_prefix(aligned);
+        dst += aligned;
+    }
+
+    if (not src.empty()) {
+        memcpy(dst, src.data(), src.size());
+        checksum.add(src);
+    }
+}
+
+//! \param[in] packets are the packets to check
+//! \param[in] initial_sums are the sums to start each packet's checksum from (or nullptr for all zero)
+//! \param[in] count is the number of packets, at most MAX_CHECKSUM_BATCH
+uint64_t verify_checksums(const string_view *packets, const uint32_t *initial_sums, const size_t count) {
+    if (count > MAX_CHECKSUM_BATCH) {
+        throw runtime_error("verify_checksums: more than " + to_string(MAX_CHECKSUM_BATCH) + " packets");
+    }
+
+    uint64_t mask = 0;
+    for (size_t first = 0; first < count; first += 4) {
+        const size_t n = min(size_t(4), count - first);
+
+        // 4个packet共同长度内的整字一起求和；不足4个时重复最后一个packet，多出的结果不用
+        array<const char *, 4> data{};
+        size_t common = SIZE_MAX;
+        for (size_t k = 0; k < 4; k++) {
+            const string_view &packet = packets[first + min(k, n - 1)];
+            data[k] = packet.data();
+            common = min(common, packet.size());
+        }
+        common &= ~size_t(7);
+
+        array<uint64_t, 4> sums{};
+        sum_words_x4(data.data(), common, sums.data());
+
+        for (size_t k = 0; k < n; k++) {
+            // 各自剩下的部分：整字，再加上补0成一个整字的末尾
+            const string_view rest = packets[first + k].substr(common);
+            const size_t aligned = rest.size() & ~size_t(7);
+            uint64_t sum = sums[k];
+            if (aligned > 0) {
+                sum = add_with_carry(sum, sum_words(rest.data(), aligned));
+            }
+            if (rest.size() > aligned) {
+                uint64_t tail = 0;
+                memcpy(&tail, rest.data() + aligned, rest.size() - aligned);
+                sum = add_with_carry(sum, tail);
+            }
+
+            uint64_t total = (initial_sums ? initial_sums[first + k] : 0) + be16toh(fold(sum));
+            while (total > 0xffff) {
+                total = (total >> 16) + (total & 0xffff);
+            }
+            mask |= uint64_t(total == 0xffff) << (first + k);
+        }
+    }
+
+    return mask;
+}
+
 //! \param[in] data is a pointer to the bytes to show
 //! \param[in] len is the number of bytes to show
 //! \param[in] indent is the number of spaces to indent
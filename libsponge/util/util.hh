@@ -52,17 +52,43 @@ std::mt19937 get_random_generator();
 uint64_t timestamp_ms();
 
 //! The internet checksum algorithm
+//! \details add() sums whole 64-bit words at a time (with SSE2 or AVX2 where the CPU has them), so
+//! the data may be split across calls at any offset, odd or even.
 class InternetChecksum {
   private:
-    uint32_t _sum;
+    uint64_t _sum;
     bool _parity{};
 
+    friend void copy_and_checksum(char *dst, std::string_view src, InternetChecksum &checksum);
+
   public:
     InternetChecksum(const uint32_t initial_sum = 0);
     void add(std::string_view data);
     uint16_t value() const;
+
+    //! The sum so far, folded to 16 bits but not complemented (e.g. a payload's contribution to a checksum)
+    uint16_t sum() const { return ~value(); }
+
+    //! \brief Update checksum `cksum` for one 16-bit word of the data changing from `old_word` to `new_word`
+    //! \details RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m')
+    static uint16_t adjust(const uint16_t cksum, const uint16_t old_word, const uint16_t new_word);
 };
 
+//! \brief Copy `src` to `dst` and add it to `checksum`, reading each byte only once
+//! \details Equivalent to `memcpy(dst, src.data(), src.size()); checksum.add(src);`
+void copy_and_checksum(char *dst, std::string_view src, InternetChecksum &checksum);
+
+//! The most packets that verify_checksums() checks in one call (one bit each in the returned mask)
+constexpr size_t MAX_CHECKSUM_BATCH = 64;
+
+//! \brief Verify the checksums of a batch of packets in one pass
+//! \details Packet `i` is valid if its bytes plus `initial_sums[i]` (e.g. a pseudo-header sum) checksum to zero,
+//! exactly as if `InternetChecksum check{initial_sums[i]}; check.add(packets[i]);` gave `check.value() == 0`.
+//! The packets are summed four at a time, each in its own vector accumulator, and the accumulators are
+//! reduced together so that each SIMD lane ends up holding one packet's sum.
+//! \returns a mask with bit `i` set for each valid packet
+uint64_t verify_checksums(const std::string_view *packets, const uint32_t *initial_sums, const size_t count);
+
 //! Hexdump the contents of a packet (or any other sequence of bytes)
 void hexdump(const char *data, const size_t len, const size_t indent = 0);
 
@@ -0,0 +1,72 @@
+#ifndef SPONGE_LIBSPONGE_VECTOR_SNAPSHOTS_HH
+#define SPONGE_LIBSPONGE_VECTOR_SNAPSHOTS_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//! \brief Read-only snapshots of a growing std::vector, which share the parts that haven't changed between them
+
+//! The vector is divided into segments of 2^SEGMENT_BITS elements. Its owner calls changed() for each
+//! element it writes in place, and take() copies into the new snapshot only the segments that have
+//! changed (or grown) since the last one, sharing the rest with it. A Snapshot never changes, so other
+//! threads can read it while the vector is changed and later snapshots are taken.
+template <typename T, unsigned SEGMENT_BITS>
+class VectorSnapshots {
+  public:
+    static constexpr size_t SEGMENT = size_t(1) << SEGMENT_BITS;  //!< Elements per segment
+
+    //! The contents of the vector when take() was called
+    class Snapshot {
+      private:
+        std::vector<std::shared_ptr<const std::array<T, SEGMENT>>> _segments{};
+        size_t _size{0};
+
+        friend class VectorSnapshots;
+
+      public:
+        //! Number of elements
+        size_t size() const { return _size; }
+
+        //! Element `i`
+        const T &operator[](const size_t i) const { return (*_segments[i >> SEGMENT_BITS])[i & (SEGMENT - 1)]; }
+    };
+
+  private:
+    Snapshot _last{};
+    std::vector<bool> _changed{};  //!< For each segment of #_last, whether it has been written since
+
+  public:
+    //! Note that element `i` has been written (appending elements needn't be noted)
+    void changed(const size_t i) {
+        const size_t segment = i >> SEGMENT_BITS;
+        if (segment < _changed.size()) {
+            _changed[segment] = true;
+        }
+    }
+
+    //! \brief A snapshot of `vector`, which must be the same vector each time (and may only grow)
+    Snapshot take(const std::vector<T> &vector) {
+        const size_t n_segments = (vector.size() + SEGMENT - 1) / SEGMENT;
+        const size_t complete = _last._size / SEGMENT;  // 上一个快照里已经满了的段
+        _last._segments.resize(n_segments);
+        for (size_t s = 0; s < n_segments; s++) {
+            if (s < complete and not _changed[s]) {
+                continue;
+            }
+            auto segment = std::make_shared<std::array<T, SEGMENT>>();
+            std::copy(vector.begin() + s * SEGMENT,
+                      vector.begin() + std::min(vector.size(), (s + 1) * SEGMENT),
+                      segment->begin());
+            _last._segments[s] = std::move(segment);
+        }
+        _last._size = vector.size();
+        _changed.assign(n_segments, false);
+        return _last;
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_VECTOR_SNAPSHOTS_HH
@@ -0,0 +1,91 @@
+#include "arp_cache.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // mappings are remembered for the TTL, and forgotten once they are older than that
+        {
+            ARPCache cache{1000};
+            const EthernetAddress mac{2, 0, 0, 0, 0, 1};
+            cache.insert(0x0a000001, mac);
+            test_err_if(not cache.lookup(0x0a000001) or *cache.lookup(0x0a000001) != mac, "mapping not found");
+            test_err_if(cache.lookup(0x0a000002), "unknown address found");
+
+            cache.tick(600);
+            cache.insert(0x0a000002, mac);
+            cache.tick(400);
+            test_err_if(not cache.lookup(0x0a000001), "mapping forgotten at exactly the TTL");
+            cache.tick(1);
+            test_err_if(cache.lookup(0x0a000001), "mapping not forgotten after the TTL");
+            test_err_if(not cache.lookup(0x0a000002), "newer mapping forgotten too early");
+
+            // re-learning a mapping restarts its TTL (the old deadline must not remove it)
+            cache.tick(500);
+            cache.insert(0x0a000002, {2, 0, 0, 0, 0, 2});
+            cache.tick(200);
+            test_err_if(not cache.lookup(0x0a000002), "re-learned mapping forgotten at its old deadline");
+            test_err_if((*cache.lookup(0x0a000002))[5] != 2, "re-learned mapping has the old address");
+            cache.tick(801);
+            test_err_if(cache.lookup(0x0a000002) or cache.size() != 0, "re-learned mapping not forgotten");
+        }
+
+        // compare against std::map with many colliding addresses, random insertions, erasures and expiry
+        {
+            auto rd = get_random_generator();
+            uniform_int_distribution<uint32_t> address_dist{0, 4095};
+            ARPCache cache{5000};
+            map<uint32_t, pair<EthernetAddress, uint64_t>> reference;
+            uint64_t now = 0;
+
+            for (size_t i = 0; i < 200000; i++) {
+                // 只有低位不同的地址（同一子网），外加少数其他地址
+                const uint32_t address = (i % 7 ? 0x0a000000 : 0xc0a80000) | address_dist(rd);
+                const EthernetAddress mac{2, 0, 0, uint8_t(i >> 16), uint8_t(i >> 8), uint8_t(i)};
+
+                switch (rd() % 8) {
+                    case 0:
+                        cache.erase(address);
+                        reference.erase(address);
+                        break;
+                    case 1: {
+                        const size_t ms = rd() % 100;
+                        cache.tick(ms);
+                        now += ms;
+                        for (auto it = reference.begin(); it != reference.end();) {
+                            it = it->second.second < now ? reference.erase(it) : next(it);
+                        }
+                        break;
+                    }
+                    default:
+                        cache.insert(address, mac);
+                        reference[address] = {mac, now + 5000};
+                }
+
+                const auto it = reference.find(address);
+                const EthernetAddress *found = cache.lookup(address);
+                test_err_if((it == reference.end()) != (found == nullptr), "lookup disagrees about presence");
+                test_err_if(found and *found != it->second.first, "lookup returned the wrong address");
+                test_err_if(cache.size() != reference.size(), "size disagrees");
+            }
+
+            for (const auto &[address, entry] : reference) {
+                const EthernetAddress *found = cache.lookup(address);
+                test_err_if(not found or *found != entry.first, "mapping lost");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
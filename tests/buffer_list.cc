@@ -0,0 +1,120 @@
+#include "buffer.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+int main() {
+    try {
+        // a few Buffers stay inline; more go to the heap, and the contents and size are unchanged
+        {
+            BufferList list;
+            string expected;
+            for (size_t i = 0; i < 10; i++) {
+                const string piece(i + 1, char('a' + i));
+                list.append(Buffer(string(piece)));
+                expected += piece;
+                test_err_if(list.size() != expected.size(), "size is wrong after " + to_string(i + 1) + " appends");
+                test_err_if(list.buffers().is_inline() != (i < BufferList::INLINE_BUFFERS),
+                            "Buffers went to the heap at the wrong time");
+            }
+            test_err_if(list.concatenate() != expected, "concatenate() returned the wrong contents");
+
+            // remove_prefix() within a Buffer and across several
+            list.remove_prefix(1);
+            list.remove_prefix(5);
+            expected = expected.substr(6);
+            test_err_if(list.size() != expected.size(), "size is wrong after remove_prefix()");
+            test_err_if(list.concatenate() != expected, "contents are wrong after remove_prefix()");
+            test_err_if(list.buffers().size() != 7, "remove_prefix() left the wrong number of Buffers");
+
+            const BufferViewList views{list};
+            test_err_if(views.size() != expected.size(), "BufferViewList has the wrong size");
+            const auto iovecs = views.as_iovecs();
+            string gathered;
+            for (size_t i = 0; i < iovecs.size(); i++) {
+                gathered.append(static_cast<const char *>(iovecs.data()[i].iov_base), iovecs.data()[i].iov_len);
+            }
+            test_err_if(gathered != expected, "as_iovecs() returned the wrong contents");
+
+            // copies are independent, and a moved-from list is empty
+            BufferList copy = list;
+            copy.remove_prefix(copy.size());
+            test_err_if(copy.size() != 0 or not copy.buffers().empty(), "remove_prefix() of everything left data");
+            test_err_if(list.concatenate() != expected, "removing from a copy changed the original");
+            BufferList moved = move(list);
+            test_err_if(list.size() != 0 or not list.buffers().empty(), "moved-from BufferList isn't empty");
+            test_err_if(moved.concatenate() != expected, "moved BufferList has the wrong contents");
+
+            bool threw = false;
+            try {
+                moved.remove_prefix(moved.size() + 1);
+            } catch (const out_of_range &) {
+                threw = true;
+            }
+            test_err_if(not threw, "remove_prefix() past the end didn't throw");
+        }
+
+        // a list used as a queue (append at the back, remove from the front) goes back to inline storage
+        {
+            BufferList list;
+            for (size_t i = 0; i < 100; i++) {
+                list.append(Buffer(string(3, 'x')));
+                if (i % 2) {
+                    list.remove_prefix(4);
+                }
+            }
+            test_err_if(list.size() != 100, "queue has the wrong size");
+            list.remove_prefix(list.size() - 2);
+            list.append(Buffer(string("yz")));
+            test_err_if(list.concatenate() != "xxyz", "queue has the wrong contents");
+            list.remove_prefix(list.size());
+            list.append(Buffer(string("abc")));
+            test_err_if(not list.buffers().is_inline(), "emptied list didn't go back to inline storage");
+            test_err_if(list.concatenate() != "abc", "emptied list has the wrong contents");
+        }
+
+        // headers are prepended into a slab's headroom, but each byte of headroom can only be claimed once
+        {
+            PacketPool::Slab slab = PacketPool::allocate();
+            string("payload").copy(slab.data() + 16, 7);
+            const Buffer payload{move(slab), 7, 16};
+            test_err_if(payload.str() != "payload", "slab Buffer has the wrong contents");
+
+            BufferList first{payload};
+            first.prepend("tcp:");
+            first.prepend("ip:");
+            test_err_if(first.buffers().size() != 1, "headers weren't prepended into the headroom");
+            test_err_if(first.concatenate() != "ip:tcp:payload", "prepended headers have the wrong contents");
+
+            // the payload's headroom now belongs to `first`, so a second encapsulation gets its own header Buffer
+            BufferList second{payload};
+            second.prepend("TCP:");
+            test_err_if(second.buffers().size() != 2, "headroom was claimed twice");
+            test_err_if(second.concatenate() != "TCP:payload", "second encapsulation has the wrong contents");
+            test_err_if(first.concatenate() != "ip:tcp:payload", "second encapsulation overwrote the first");
+
+            // more than fits in the headroom
+            BufferList third{Buffer{first}};
+            third.prepend(string(10, 'x'));
+            test_err_if(third.buffers().size() != 2 or third.concatenate() != string(10, 'x') + "ip:tcp:payload",
+                        "header longer than the headroom was mishandled");
+
+            // an empty list gets a slab with headroom
+            BufferList empty;
+            empty.prepend("ack");
+            empty.prepend("ip:");
+            test_err_if(empty.buffers().size() != 1 or empty.concatenate() != "ip:ack",
+                        "headers weren't prepended to an empty list");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
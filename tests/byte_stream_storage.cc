@@ -0,0 +1,140 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static string random_string(const size_t size, mt19937 &rd) {
+    string d(size, 0);
+    generate(d.begin(), d.end(), [&] { return 'a' + (rd() % 26); });
+    return d;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            ByteStreamTestHarness test{"no storage until the first write", 10000};
+
+            test.execute(BytesAllocated{0});
+            test.execute(Write{""}.with_bytes_written(0));
+            test.execute(BytesAllocated{0});
+            test.execute(Write{"cat"}.with_bytes_written(3));
+            test.execute(BytesAllocated{2048});
+            test.execute(Peek{"cat"});
+        }
+
+        {
+            ByteStreamTestHarness test{"grow a wrapped ring", 10000};
+
+            const string first = random_string(2000, rd);
+            test.execute(Write{first}.with_bytes_written(2000));
+            test.execute(BytesAllocated{2048});
+            test.execute(Pop{1500});
+
+            // 写位置越过buffer末尾，绕回开头
+            const string second = random_string(500, rd);
+            test.execute(Write{second}.with_bytes_written(500));
+            test.execute(BytesAllocated{2048});
+            test.execute(Peek{first.substr(1500) + second});
+
+            // 扩容时要把绕回的两段按顺序搬到新空间
+            const string third = random_string(3000, rd);
+            test.execute(Write{third}.with_bytes_written(3000));
+            test.execute(BytesAllocated{4096});
+            test.execute(BufferSize{4000});
+            test.execute(Peek{first.substr(1500) + second + third});
+
+            // 扩容之后写位置也能正常绕回
+            test.execute(Pop{3000});
+            const string fourth = random_string(3000, rd);
+            test.execute(Write{fourth}.with_bytes_written(3000));
+            test.execute(BytesAllocated{4096});
+            test.execute(Peek{third.substr(2000) + fourth});
+        }
+
+        {
+            ByteStreamTestHarness test{"growth capped at the capacity", 5000};
+
+            const string first = random_string(4000, rd);
+            test.execute(Write{first}.with_bytes_written(4000));
+            test.execute(BytesAllocated{4000});
+
+            // 倍增会要8000字节，但不会超过容量
+            const string second = random_string(2000, rd);
+            test.execute(Write{second}.with_bytes_written(1000));
+            test.execute(BytesAllocated{5000});
+            test.execute(RemainingCapacity{0});
+            test.execute(Peek{first + second.substr(0, 1000)});
+
+            test.execute(Pop{4500});
+            const string third = random_string(4500, rd);
+            test.execute(Write{third}.with_bytes_written(4500));
+            test.execute(BytesAllocated{5000});
+            test.execute(Peek{second.substr(500, 500) + third});
+        }
+
+        {
+            ByteStreamTestHarness test{"storage kept when emptied", 10000};
+
+            test.execute(Write{"cat"}.with_bytes_written(3));
+            test.execute(Pop{3});
+            test.execute(BufferEmpty{true});
+            test.execute(BytesAllocated{2048});
+        }
+
+        {
+            ByteStreamTestHarness test{"storage released when emptied", 10000};
+
+            test.execute(ReleaseWhenEmpty{true});
+            test.execute(Write{"cat"}.with_bytes_written(3));
+            test.execute(BytesAllocated{2048});
+            test.execute(Pop{2});
+            test.execute(BytesAllocated{2048});
+            test.execute(Pop{1});
+            test.execute(BufferEmpty{true});
+            test.execute(BytesAllocated{0});
+
+            // 下一次写入重新分配
+            test.execute(Write{"tac"}.with_bytes_written(3));
+            test.execute(BytesAllocated{2048});
+            test.execute(BytesWritten{6});
+            test.execute(BytesRead{3});
+            test.execute(Peek{"tac"});
+        }
+
+        {
+            ByteStreamTestHarness test{"random writes and pops", 20000};
+
+            string expected;
+            for (size_t i = 0; i < 2000; i++) {
+                if (i % 100 == 0) {
+                    test.execute(ReleaseWhenEmpty{rd() % 2 == 0});
+                }
+
+                const string d = random_string(rd() % 3000, rd);
+                const size_t accepted = min(d.size(), 20000 - expected.size());
+                test.execute(Write{d}.with_bytes_written(accepted));
+                expected += d.substr(0, accepted);
+
+                const size_t popped = min(size_t(rd() % 4000), expected.size());
+                test.execute(Pop{popped});
+                expected.erase(0, popped);
+
+                test.execute(BufferSize{expected.size()});
+                test.execute(Peek{expected});
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
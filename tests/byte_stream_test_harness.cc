@@ -102,6 +102,11 @@ Pop::Pop(const size_t len) : _len(len) {}
 std::string Pop::description() const { return "pop " + to_string(_len); }
 void Pop::execute(ByteStream &bs) const { bs.pop_output(_len); }
 
+// ReleaseWhenEmpty
+ReleaseWhenEmpty::ReleaseWhenEmpty(const bool release) : _release(release) {}
+std::string ReleaseWhenEmpty::description() const { return "release when empty: " + to_string(_release); }
+void ReleaseWhenEmpty::execute(ByteStream &bs) const { bs.set_release_when_empty(_release); }
+
 // InputEnded
 InputEnded::InputEnded(const bool input_ended) : _input_ended(input_ended) {}
 std::string InputEnded::description() const { return "input_ended: " + to_string(_input_ended); }
@@ -152,6 +157,16 @@ void RemainingCapacity::execute(ByteStream &bs) const {
     }
 }
 
+// BytesAllocated
+BytesAllocated::BytesAllocated(const size_t bytes_allocated) : _bytes_allocated(bytes_allocated) {}
+std::string BytesAllocated::description() const { return "bytes_allocated: " + to_string(_bytes_allocated); }
+void BytesAllocated::execute(ByteStream &bs) const {
+    auto bytes_allocated = bs.bytes_allocated();
+    if (bytes_allocated != _bytes_allocated) {
+        throw ByteStreamExpectationViolation::property("bytes_allocated", _bytes_allocated, bytes_allocated);
+    }
+}
+
 // BytesWritten
 BytesWritten::BytesWritten(const size_t bytes_written) : _bytes_written(bytes_written) {}
 std::string BytesWritten::description() const { return "bytes_written: " + to_string(_bytes_written); }
@@ -64,6 +64,14 @@ struct Pop : public ByteStreamAction {
     void execute(ByteStream &) const override;
 };
 
+struct ReleaseWhenEmpty : public ByteStreamAction {
+    bool _release;
+
+    ReleaseWhenEmpty(const bool release);
+    std::string description() const override;
+    void execute(ByteStream &) const override;
+};
+
 struct InputEnded : public ByteStreamExpectation {
     bool _input_ended;
 
@@ -120,6 +128,14 @@ struct RemainingCapacity : public ByteStreamExpectation {
     void execute(ByteStream &) const override;
 };
 
+struct BytesAllocated : public ByteStreamExpectation {
+    size_t _bytes_allocated;
+
+    BytesAllocated(const size_t bytes_allocated);
+    std::string description() const override;
+    void execute(ByteStream &) const override;
+};
+
 struct Peek : public ByteStreamExpectation {
     std::string _output;
 
@@ -0,0 +1,270 @@
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+static IPv4Header random_ipv4_header(mt19937 &rd) {
+    IPv4Header header;
+    header.tos = rd();
+    header.id = rd();
+    header.df = rd() % 2;
+    header.mf = rd() % 2;
+    header.offset = rd() & 0x1fff;
+    header.ttl = rd();
+    header.proto = rd();
+    header.src = rd();
+    header.dst = rd();
+    return header;
+}
+
+static TCPHeader random_tcp_header(mt19937 &rd) {
+    TCPHeader header;
+    header.sport = rd();
+    header.dport = rd();
+    header.seqno = WrappingInt32{uint32_t(rd())};
+    header.ackno = WrappingInt32{uint32_t(rd())};
+    header.urg = rd() % 2;
+    header.ack = rd() % 2;
+    header.psh = rd() % 2;
+    header.rst = rd() % 2;
+    header.syn = rd() % 2;
+    header.fin = rd() % 2;
+    header.win = rd();
+    header.uptr = rd();
+    return header;
+}
+
+static string random_bytes(const size_t size, mt19937 &rd) {
+    string bytes(size, 0);
+    generate(bytes.begin(), bytes.end(), [&] { return char(rd()); });
+    return bytes;
+}
+
+//! Write the checksum of the first `header_length` bytes of `datagram` into its IPv4 header
+static void fix_ipv4_cksum(string &datagram, const size_t header_length) {
+    fill_n(datagram.begin() + IPv4Header::CKSUM_OFFSET, 2, 0);
+    InternetChecksum check;
+    check.add(string_view(datagram).substr(0, header_length));
+    char *cksum_field = datagram.data() + IPv4Header::CKSUM_OFFSET;
+    NetUnparser::u16(cksum_field, check.value());
+}
+
+//! Write the checksum of `segment` (with the pseudo-header sum `pseudo_cksum`) into its TCP header
+static void fix_tcp_cksum(string &segment, const uint32_t pseudo_cksum) {
+    fill_n(segment.begin() + TCPHeader::CKSUM_OFFSET, 2, 0);
+    InternetChecksum check(pseudo_cksum);
+    check.add(segment);
+    char *cksum_field = segment.data() + TCPHeader::CKSUM_OFFSET;
+    NetUnparser::u16(cksum_field, check.value());
+}
+
+//! An IPv4 datagram of `header` (with `hlen` words of header, the options random) and a random payload
+static string make_datagram(IPv4Header header, const uint8_t hlen, const size_t payload_size, mt19937 &rd) {
+    header.hlen = hlen;
+    header.len = 4 * hlen + payload_size;
+    string datagram = header.serialize().copy();
+    for (size_t i = IPv4Header::LENGTH; i < datagram.size(); i++) {
+        datagram[i] = char(rd());
+    }
+    datagram += random_bytes(payload_size, rd);
+    fix_ipv4_cksum(datagram, 4 * hlen);
+    return datagram;
+}
+
+//! A TCP segment of `header` (with `doff` words of header, the options random) and `payload`
+static string make_segment(TCPHeader header,
+                           const uint8_t doff,
+                           const string &payload,
+                           const uint32_t pseudo_cksum,
+                           mt19937 &rd) {
+    header.doff = doff;
+    string segment = header.serialize().copy();
+    for (size_t i = TCPHeader::LENGTH; i < segment.size(); i++) {
+        segment[i] = char(rd());
+    }
+    segment += payload;
+    fix_tcp_cksum(segment, pseudo_cksum);
+    return segment;
+}
+
+static ParseResult old_ipv4_parse(const string &datagram, IPv4Header &header) {
+    NetParser p{Buffer(string(datagram))};
+    return header.parse(p);
+}
+
+static ParseResult old_tcp_parse(const string &segment, TCPHeader &header) {
+    NetParser p{Buffer(string(segment))};
+    return header.parse(p);
+}
+
+static bool same_ipv4(const IPv4HeaderView &view, const IPv4Header &header) {
+    return view.ver() == header.ver and view.hlen() == header.hlen and view.tos() == header.tos and
+           view.len() == header.len and view.id() == header.id and view.df() == header.df and
+           view.mf() == header.mf and view.offset() == header.offset and view.ttl() == header.ttl and
+           view.proto() == header.proto and view.cksum() == header.cksum and view.src() == header.src and
+           view.dst() == header.dst and view.payload_length() == header.payload_length() and
+           view.pseudo_cksum() == header.pseudo_cksum();
+}
+
+static bool same_tcp(const TCPHeaderView &view, const TCPHeader &header) {
+    return view.sport() == header.sport and view.dport() == header.dport and view.seqno() == header.seqno and
+           view.ackno() == header.ackno and view.doff() == header.doff and view.urg() == header.urg and
+           view.ack() == header.ack and view.psh() == header.psh and view.rst() == header.rst and
+           view.syn() == header.syn and view.fin() == header.fin and view.win() == header.win and
+           view.cksum() == header.cksum and view.uptr() == header.uptr;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // every IPv4 accessor agrees with decode() and with IPv4Header::parse() on the same bytes
+        for (size_t i = 0; i < 1000; i++) {
+            const uint8_t hlen = 5 + rd() % 11;
+            const string datagram = make_datagram(random_ipv4_header(rd), hlen, rd() % 100, rd);
+
+            IPv4HeaderView view;
+            test_err_if(view.parse(Buffer(string(datagram))) != ParseResult::NoError, "IPv4 header rejected");
+            IPv4Header old;
+            test_err_if(old_ipv4_parse(datagram, old) != ParseResult::NoError, "IPv4Header::parse() rejected");
+            test_err_if(not same_ipv4(view, old), "IPv4 view differs from IPv4Header::parse()");
+            test_err_if(not same_ipv4(view, view.decode()), "IPv4 view differs from decode()");
+            test_err_if(view.bytes() != string_view(datagram).substr(0, 4 * hlen), "IPv4 header bytes differ");
+        }
+
+        // each way an IPv4 header is rejected, with the same result as IPv4Header::parse()
+        {
+            const string good = make_datagram(random_ipv4_header(rd), 5, 40, rd);
+            const auto expect = [](const string &datagram, const ParseResult expected, const string &what) {
+                IPv4HeaderView view;
+                test_err_if(view.parse(Buffer(string(datagram))) != expected, "IPv4 view: " + what);
+                IPv4Header old;
+                test_err_if(old_ipv4_parse(datagram, old) != expected, "IPv4Header::parse(): " + what);
+            };
+
+            string bad_cksum = good;
+            bad_cksum[IPv4Header::CKSUM_OFFSET] ^= 1;
+            expect(bad_cksum, ParseResult::BadChecksum, "bad checksum");
+
+            expect(good.substr(0, IPv4Header::LENGTH - 1), ParseResult::PacketTooShort, "too short");
+
+            string short_hlen = good;
+            short_hlen[0] = char(0x44);
+            fix_ipv4_cksum(short_hlen, IPv4Header::LENGTH);
+            expect(short_hlen, ParseResult::HeaderTooShort, "hlen < 5");
+
+            string long_hlen = good.substr(0, 40);
+            long_hlen[0] = char(0x4f);
+            long_hlen[2] = 0;
+            long_hlen[3] = 40;
+            expect(long_hlen, ParseResult::PacketTooShort, "hlen past the end");
+
+            string version = good;
+            version[0] = char(0x65);
+            fix_ipv4_cksum(version, IPv4Header::LENGTH);
+            expect(version, ParseResult::WrongIPVersion, "wrong version");
+
+            expect(good.substr(0, good.size() - 1), ParseResult::TruncatedPacket, "truncated");
+
+            IPv4HeaderView view;
+            test_err_if(view.parse(Buffer(string(bad_cksum)), false) != ParseResult::NoError,
+                        "checksum checked although the caller had verified it");
+        }
+
+        // decrement_ttl() changes only the TTL, and leaves a valid checksum
+        for (size_t i = 0; i < 1000; i++) {
+            IPv4Header header = random_ipv4_header(rd);
+            header.ttl = 1 + rd() % 255;
+            const uint8_t hlen = 5 + rd() % 11;
+            const string datagram = make_datagram(header, hlen, 0, rd);
+
+            IPv4HeaderView view;
+            test_err_if(view.parse(Buffer(string(datagram))) != ParseResult::NoError, "IPv4 header rejected");
+            view.decrement_ttl();
+
+            IPv4Header expected;
+            old_ipv4_parse(datagram, expected);
+            expected.ttl--;
+            expected.cksum = view.cksum();
+            test_err_if(not same_ipv4(view, expected), "decrement_ttl() changed more than the TTL");
+
+            string decremented = datagram;
+            decremented[8]--;
+            test_err_if(view.bytes().substr(0, 10) != string_view(decremented).substr(0, 10) or
+                            view.bytes().substr(12) != string_view(decremented).substr(12, 4 * hlen - 12),
+                        "decrement_ttl() changed other bytes");
+
+            InternetChecksum check;
+            check.add(view.bytes());
+            test_err_if(check.value() != 0, "checksum wrong after decrement_ttl()");
+        }
+
+        // every TCP accessor agrees with decode() and with TCPHeader::parse(), and payload() skips the options
+        for (size_t i = 0; i < 1000; i++) {
+            const uint32_t pseudo_cksum = random_ipv4_header(rd).pseudo_cksum();
+            const uint8_t doff = 5 + rd() % 11;
+            const string payload = random_bytes(rd() % 100, rd);
+            const string segment = make_segment(random_tcp_header(rd), doff, payload, pseudo_cksum, rd);
+
+            TCPHeaderView view;
+            test_err_if(view.parse(Buffer(string(segment)), pseudo_cksum) != ParseResult::NoError,
+                        "TCP header rejected");
+            TCPHeader old;
+            test_err_if(old_tcp_parse(segment, old) != ParseResult::NoError, "TCPHeader::parse() rejected");
+            test_err_if(not same_tcp(view, old), "TCP view differs from TCPHeader::parse()");
+            test_err_if(not same_tcp(view, view.decode()), "TCP view differs from decode()");
+            test_err_if(view.payload().copy() != payload, "TCP payload differs");
+
+            TCPSegment seg;
+            test_err_if(seg.parse(Buffer(string(segment)), pseudo_cksum) != ParseResult::NoError, "segment rejected");
+            test_err_if(as_const(seg).payload().copy() != payload, "TCPSegment::parse() payload differs");
+        }
+
+        // each way a TCP header is rejected, with the same result as TCPHeader::parse()
+        {
+            const uint32_t pseudo_cksum = random_ipv4_header(rd).pseudo_cksum();
+            const string good = make_segment(random_tcp_header(rd), 5, random_bytes(40, rd), pseudo_cksum, rd);
+            const auto expect = [&](const string &segment, const ParseResult expected, const string &what) {
+                TCPHeaderView view;
+                test_err_if(view.parse(Buffer(string(segment)), pseudo_cksum) != expected, "TCP view: " + what);
+            };
+
+            string bad_cksum = good;
+            bad_cksum.back() ^= 1;
+            expect(bad_cksum, ParseResult::BadChecksum, "bad checksum");
+
+            string too_short = good.substr(0, TCPHeader::LENGTH - 1);
+            fix_tcp_cksum(too_short, pseudo_cksum);
+            expect(too_short, ParseResult::PacketTooShort, "too short");
+            TCPHeader old;
+            test_err_if(old_tcp_parse(too_short, old) != ParseResult::PacketTooShort, "TCPHeader::parse(): short");
+
+            string short_doff = good;
+            short_doff[12] = char(0x40);
+            fix_tcp_cksum(short_doff, pseudo_cksum);
+            expect(short_doff, ParseResult::HeaderTooShort, "doff < 5");
+            test_err_if(old_tcp_parse(short_doff, old) != ParseResult::HeaderTooShort, "TCPHeader::parse(): doff");
+
+            string long_doff = good.substr(0, 40);
+            long_doff[12] = char(0xf0);
+            fix_tcp_cksum(long_doff, pseudo_cksum);
+            expect(long_doff, ParseResult::PacketTooShort, "doff past the end");
+            test_err_if(old_tcp_parse(long_doff, old) != ParseResult::PacketTooShort, "TCPHeader::parse(): long");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
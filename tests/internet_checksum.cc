@@ -0,0 +1,161 @@
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// 逐字节计算的参考实现（InternetChecksum原来的做法）
+class ReferenceChecksum {
+  private:
+    uint32_t _sum;
+    bool _parity{};
+
+  public:
+    explicit ReferenceChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
+
+    void add(const string_view data) {
+        for (size_t i = 0; i < data.size(); i++) {
+            uint16_t val = uint8_t(data[i]);
+            if (not _parity) {
+                val <<= 8;
+            }
+            _sum += val;
+            _parity = !_parity;
+        }
+    }
+
+    uint16_t value() const {
+        uint32_t ret = _sum;
+        while (ret > 0xffff) {
+            ret = (ret >> 16) + (ret & 0xffff);
+        }
+        return ~ret;
+    }
+};
+
+void check(const string &data, const vector<size_t> &cuts, const uint32_t initial_sum) {
+    InternetChecksum fast{initial_sum};
+    InternetChecksum copied{initial_sum};
+    ReferenceChecksum reference{initial_sum};
+    string copy(data.size(), '\0');
+
+    size_t start = 0;
+    for (const size_t cut : cuts) {
+        fast.add({data.data() + start, cut - start});
+        copy_and_checksum(copy.data() + start, {data.data() + start, cut - start}, copied);
+        reference.add({data.data() + start, cut - start});
+        start = cut;
+    }
+    fast.add({data.data() + start, data.size() - start});
+    copy_and_checksum(copy.data() + start, {data.data() + start, data.size() - start}, copied);
+    reference.add({data.data() + start, data.size() - start});
+
+    if (copy != data or copied.value() != fast.value()) {
+        throw runtime_error("copy_and_checksum() differs from memcpy() and add() for " + to_string(data.size()) +
+                            " bytes");
+    }
+
+    if (fast.value() != reference.value()) {
+        ostringstream ss;
+        ss << "checksum mismatch: got " << fast.value() << ", expected " << reference.value() << " for "
+           << data.size() << " bytes split at";
+        for (const size_t cut : cuts) {
+            ss << " " << cut;
+        }
+        ss << " with initial sum " << initial_sum;
+        throw runtime_error(ss.str());
+    }
+}
+
+// 一批长度各异的packet，其中一部分的校验和是对的，verify_checksums()的结果应与逐个检查一致
+void check_batch(const size_t count, mt19937 &rd) {
+    uniform_int_distribution<size_t> length_dist{0, 1600};
+    uniform_int_distribution<uint32_t> byte_dist{0, 255};
+    uniform_int_distribution<uint32_t> sum_dist{0, 0x3ffff};
+
+    vector<string> packets(count);
+    vector<string_view> views(count);
+    vector<uint32_t> initial_sums(count);
+    uint64_t expected = 0;
+    for (size_t i = 0; i < count; i++) {
+        string &packet = packets[i];
+        packet.resize(length_dist(rd));
+        for (auto &ch : packet) {
+            ch = char(byte_dist(rd));
+        }
+        initial_sums[i] = i % 3 ? sum_dist(rd) : 0;
+
+        // 让一半的packet通过检查：把校验和写进开头的两个字节
+        if (i % 2 == 0 and packet.size() >= 2) {
+            packet[0] = packet[1] = 0;
+            InternetChecksum check{initial_sums[i]};
+            check.add(packet);
+            packet[0] = char(check.value() >> 8);
+            packet[1] = char(check.value() & 0xff);
+        }
+
+        InternetChecksum check{initial_sums[i]};
+        check.add(packet);
+        expected |= uint64_t(check.value() == 0) << i;
+        views[i] = packet;
+    }
+
+    const uint64_t mask = verify_checksums(views.data(), initial_sums.data(), count);
+    if (mask != expected) {
+        ostringstream ss;
+        ss << "verify_checksums() mask " << hex << mask << " differs from " << expected << " for " << dec << count
+           << " packets";
+        throw runtime_error(ss.str());
+    }
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        uniform_int_distribution<size_t> length_dist{0, 4096};
+        uniform_int_distribution<uint32_t> byte_dist{0, 255};
+        uniform_int_distribution<uint32_t> sum_dist{0, 0x3ffff};
+        uniform_int_distribution<size_t> n_cuts_dist{0, 6};
+
+        // 全0xff的数据会使部分和恰好等于0xffff的倍数
+        check(string(1500, '\xff'), {}, 0);
+        check(string(1500, '\xff'), {7, 33}, 0xffff);
+        check(string(64, '\0'), {1}, 0);
+        check("", {}, 0);
+
+        for (unsigned int i = 0; i < 20000; i++) {
+            string data(length_dist(rd), '\0');
+            // 一部分数据只含0x00和0xff，更容易触发进位
+            const bool extremes = i % 4 == 0;
+            for (auto &ch : data) {
+                ch = extremes ? (byte_dist(rd) & 1 ? '\xff' : '\0') : char(byte_dist(rd));
+            }
+
+            vector<size_t> cuts(n_cuts_dist(rd));
+            uniform_int_distribution<size_t> cut_dist{0, data.size()};
+            for (auto &cut : cuts) {
+                cut = cut_dist(rd);
+            }
+            sort(cuts.begin(), cuts.end());
+
+            check(data, cuts, i % 2 ? sum_dist(rd) : 0);
+        }
+
+        for (unsigned int i = 0; i < 2000; i++) {
+            check_batch(i % (MAX_CHECKSUM_BATCH + 1), rd);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+#include "ip_reassembler.hh"
+#include "tcp_over_ip.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static InternetDatagram make_datagram(const uint16_t id, const size_t payload_size, mt19937 &rd) {
+    InternetDatagram dgram;
+    dgram.header().src = 0x0a000001;
+    dgram.header().dst = 0x0a000002;
+    dgram.header().id = id;
+    dgram.header().df = false;
+    string payload(payload_size, 0);
+    generate(payload.begin(), payload.end(), [&] { return char(rd()); });
+    dgram.payload() = Buffer(move(payload));
+    dgram.header().len = IPv4Header::LENGTH + payload_size;
+    return dgram;
+}
+
+//! Serialize and parse `dgram`, as if it had arrived over a link
+static InternetDatagram received(const InternetDatagram &dgram) {
+    InternetDatagram parsed;
+    test_err_if(parsed.parse(Buffer(dgram.serialize().concatenate())) != ParseResult::NoError,
+                "datagram didn't parse");
+    return parsed;
+}
+
+//! Serialize and parse `dgram`, as if it had been read from a link into a PacketPool slab
+static InternetDatagram received_into_slab(const InternetDatagram &dgram) {
+    const string bytes = dgram.serialize().concatenate();
+    PacketPool::Slab slab = PacketPool::allocate();
+    copy(bytes.begin(), bytes.end(), slab.data());
+    InternetDatagram parsed;
+    test_err_if(parsed.parse(Buffer(move(slab), bytes.size())) != ParseResult::NoError, "datagram didn't parse");
+    return parsed;
+}
+
+static string wire(const InternetDatagram &dgram) { return dgram.serialize().concatenate(); }
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // fragment() splits on 8-byte boundaries, and refuses datagrams with DF set
+        {
+            InternetDatagram dgram = make_datagram(1, 1000, rd);
+            test_err_if(dgram.fragment(1020).size() != 1, "a datagram that fits was split");
+
+            const vector<InternetDatagram> fragments = dgram.fragment(300);
+            test_err_if(fragments.size() != 4, "wrong number of fragments");
+            size_t expected_offset = 0;
+            for (size_t i = 0; i < fragments.size(); i++) {
+                const IPv4Header &header = fragments[i].header();
+                test_err_if(header.len > 300, "fragment longer than the MTU");
+                test_err_if(header.offset * 8 != expected_offset, "fragment at the wrong offset");
+                test_err_if(header.mf != (i + 1 < fragments.size()), "wrong MF flag");
+                expected_offset += fragments[i].payload().size();
+            }
+
+            // 分片再分片：偏移量接着原来的算，只有原来的最后一个分片的最后一块没有MF
+            const vector<InternetDatagram> refragmented = fragments[1].fragment(100);
+            test_err_if(refragmented.front().header().offset != fragments[1].header().offset, "refragment offset");
+            test_err_if(not refragmented.back().header().mf, "refragment of a middle fragment lost MF");
+
+            dgram.header().df = true;
+            test_err_if(not dgram.fragment(300).empty(), "a datagram with DF set was fragmented");
+        }
+
+        // many datagrams at once, their fragments shuffled and some duplicated, are each put back together
+        {
+            IPv4Reassembler reassembler;
+            vector<InternetDatagram> originals;
+            vector<size_t> n_fragments;
+            vector<InternetDatagram> fragments;
+            for (uint16_t id = 0; id < 200; id++) {
+                originals.push_back(make_datagram(id, 1 + rd() % 9000, rd));
+                const vector<InternetDatagram> pieces = originals.back().fragment(68 + rd() % 1500);
+                n_fragments.push_back(pieces.size());
+                for (const auto &fragment : pieces) {
+                    fragments.push_back(received(fragment));
+                }
+                // 至多重复一个分片，这样datagram完成之后，重复的分片不可能再凑成一个
+                if (rd() % 2) {
+                    fragments.push_back(received(pieces[rd() % pieces.size()]));
+                }
+            }
+            shuffle(fragments.begin(), fragments.end(), rd);
+
+            vector<size_t> completed(originals.size(), 0);
+            for (const auto &fragment : fragments) {
+                const optional<InternetDatagram> whole = reassembler.push(fragment);
+                if (whole) {
+                    const uint16_t id = whole->header().id;
+                    test_err_if(id >= originals.size(), "unknown datagram reassembled");
+                    test_err_if(wire(*whole) != wire(originals[id]), "datagram reassembled wrong");
+                    completed[id]++;
+                }
+            }
+            for (size_t id = 0; id < originals.size(); id++) {
+                // 没有被分片的datagram每收到一次就交出一次
+                test_err_if(completed[id] == 0, "datagram " + to_string(id) + " never completed");
+                test_err_if(completed[id] > 1 and n_fragments[id] > 1, "datagram completed twice");
+            }
+
+            // 在datagram完成之后才到的重复分片会留下来，直到超时
+            reassembler.tick(IPv4ReassemblerConfig::TIMEOUT_DFLT);
+            test_err_if(reassembler.size() != 0 or reassembler.memory_usage() != 0, "state left after timeout");
+        }
+
+        // overlapping fragments drop the datagram
+        {
+            IPv4Reassembler reassembler;
+            const InternetDatagram dgram = make_datagram(7, 100, rd);
+            const vector<InternetDatagram> fragments = dgram.fragment(60);  // 40字节一片
+            InternetDatagram overlapping = make_datagram(7, 16, rd);
+            overlapping.header().offset = 4;
+            overlapping.header().mf = true;
+
+            test_err_if(reassembler.push(fragments[0]).has_value(), "completed early");
+            test_err_if(reassembler.push(overlapping).has_value(), "overlap accepted");
+            test_err_if(reassembler.counters().datagrams_invalid != 1, "overlap not counted");
+            test_err_if(reassembler.size() != 0, "overlapping datagram kept");
+            for (size_t i = 1; i < fragments.size(); i++) {
+                test_err_if(reassembler.push(fragments[i]).has_value(), "completed without its first fragment");
+            }
+
+            // 不是最后一片、长度又不是8的整数倍的分片也是错误的
+            InternetDatagram odd = make_datagram(8, 13, rd);
+            odd.header().mf = true;
+            test_err_if(reassembler.push(odd).has_value() or reassembler.counters().datagrams_invalid != 2,
+                        "malformed fragment accepted");
+        }
+
+        // incomplete datagrams time out
+        {
+            IPv4ReassemblerConfig config;
+            config.timeout_ms = 1000;
+            IPv4Reassembler reassembler{config};
+            const vector<InternetDatagram> fragments = make_datagram(9, 100, rd).fragment(60);
+
+            reassembler.push(fragments[0]);
+            reassembler.tick(999);
+            test_err_if(reassembler.size() != 1, "timed out early");
+            reassembler.push(fragments[1]);  // 后来的分片不延长超时
+            reassembler.tick(1);
+            test_err_if(reassembler.size() != 0 or reassembler.counters().datagrams_timed_out != 1, "didn't time out");
+            test_err_if(reassembler.push(fragments[2]).has_value(), "completed after timing out");
+        }
+
+        // memory stays under the limit, by dropping the oldest datagrams
+        {
+            IPv4ReassemblerConfig config;
+            config.memory_limit = 20000;
+            IPv4Reassembler reassembler{config};
+            vector<vector<InternetDatagram>> fragments;
+            for (uint16_t id = 0; id < 100; id++) {
+                fragments.push_back(make_datagram(id, 2000, rd).fragment(1020));
+                reassembler.push(fragments.back()[0]);
+                test_err_if(reassembler.memory_usage() > config.memory_limit, "memory over the limit");
+            }
+            test_err_if(reassembler.counters().datagrams_evicted == 0, "nothing evicted");
+            test_err_if(reassembler.push(fragments.front()[1]).has_value(), "evicted datagram completed");
+            test_err_if(not reassembler.push(fragments.back()[1]).has_value(), "newest datagram evicted");
+        }
+
+        // tiny fragments received into slabs count (and keep) no more memory than the slabs they hold
+        {
+            IPv4ReassemblerConfig config;
+            config.memory_limit = 64 * 1024;
+            IPv4Reassembler reassembler{config};
+            const size_t heap_slabs = PacketPool::heap_allocations();
+            for (uint16_t id = 0; id < 2000; id++) {
+                InternetDatagram first = make_datagram(id, 8, rd);
+                first.header().mf = true;
+                reassembler.push(received_into_slab(first));
+                test_err_if(reassembler.memory_usage() > config.memory_limit, "memory over the limit");
+            }
+            // 放掉的slab回到空闲链表，给下一个分片用；只有还被保留着的slab才需要从堆上拿新的
+            const size_t slabs_held = PacketPool::heap_allocations() - heap_slabs;
+            test_err_if(slabs_held * PacketPool::SLAB_SIZE > config.memory_limit, "slabs held beyond the limit");
+            test_err_if(reassembler.size() < 100, "tiny fragments charged for more than they hold");
+        }
+
+        // TCPOverIPv4Adapter reassembles before unwrapping
+        {
+            TCPOverIPv4Adapter sender;
+            sender.config_mut().source = {"10.0.0.1", 1234};
+            sender.config_mut().destination = {"10.0.0.2", 80};
+            TCPOverIPv4Adapter receiver;
+            receiver.config_mut().source = {"10.0.0.2", 80};
+            receiver.config_mut().destination = {"10.0.0.1", 1234};
+
+            TCPSegment seg;
+            seg.header().seqno = WrappingInt32(1000);
+            string data(3000, 0);
+            generate(data.begin(), data.end(), [&] { return char(rd()); });
+            seg.payload() = Buffer(string(data));
+            InternetDatagram dgram = sender.wrap_tcp_in_ip(seg);
+            dgram.header().df = false;
+
+            vector<InternetDatagram> fragments = dgram.fragment(576);
+            reverse(fragments.begin(), fragments.end());
+            for (size_t i = 0; i < fragments.size(); i++) {
+                const optional<TCPSegment> unwrapped = receiver.unwrap_tcp_in_ip(received(fragments[i]));
+                test_err_if(unwrapped.has_value() != (i + 1 == fragments.size()), "segment unwrapped at wrong time");
+                if (unwrapped) {
+                    test_err_if(unwrapped->payload().copy() != data, "segment payload differs");
+                    test_err_if(unwrapped->header().seqno != WrappingInt32(1000), "segment header differs");
+                }
+            }
+            test_err_if(receiver.reassembler().counters().datagrams_reassembled != 1, "not counted");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
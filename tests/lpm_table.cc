@@ -0,0 +1,173 @@
+#include "lpm_table.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static uint32_t prefix_mask(const uint8_t length) { return length == 0 ? 0 : ~uint32_t(0) << (32 - length); }
+
+//! The longest prefix in `reference` that matches `address`, by looking at every one
+static optional<uint32_t> linear_lookup(const map<pair<uint32_t, uint8_t>, uint32_t> &reference,
+                                        const uint32_t address) {
+    optional<uint32_t> value;
+    int longest = -1;
+    for (const auto &[prefix, v] : reference) {
+        if ((address & prefix_mask(prefix.second)) == prefix.first and prefix.second > longest) {
+            longest = prefix.second;
+            value = v;
+        }
+    }
+    return value;
+}
+
+int main() {
+    try {
+        // the longest matching prefix wins, at every level of the table
+        {
+            LPMTable table;
+            test_err_if(table.lookup(0x0a000001).has_value(), "empty table matched");
+
+            table.insert(0, 0, 1);            // default route
+            table.insert(0x0a000000, 8, 2);   // 10.0.0.0/8
+            table.insert(0x0a010000, 16, 3);  // 10.1.0.0/16
+            table.insert(0x0a010200, 24, 4);  // 10.1.2.0/24
+            table.insert(0x0a010203, 32, 5);  // 10.1.2.3/32
+            table.insert(0x0a0102ff, 25, 6);  // 10.1.2.128/25, given with host bits set
+
+            test_err_if(table.lookup(0x0b000000) != 1u, "default route not used");
+            test_err_if(table.lookup(0x0aff0000) != 2u, "/8 not matched");
+            test_err_if(table.lookup(0x0a01ff00) != 3u, "/16 not matched");
+            test_err_if(table.lookup(0x0a010201) != 4u, "/24 not matched");
+            test_err_if(table.lookup(0x0a010203) != 5u, "/32 not matched");
+            test_err_if(table.lookup(0x0a010280) != 6u, "/25 not matched");
+            test_err_if(table.find(0x0a010280, 25) != 6u, "/25 not found by its masked prefix");
+
+            // removing a prefix hands its addresses back to the next-longest one
+            test_err_if(not table.erase(0x0a010200, 24), "erase of existing prefix failed");
+            test_err_if(table.erase(0x0a010200, 24), "prefix erased twice");
+            test_err_if(table.lookup(0x0a010201) != 3u, "/24 not replaced by /16");
+            test_err_if(table.lookup(0x0a010203) != 5u, "/32 lost when /24 was erased");
+            test_err_if(not table.erase(0, 0) or table.lookup(0x0b000000), "default route not erased");
+
+            // replacing a prefix's value
+            table.insert(0x0a000000, 8, 7);
+            test_err_if(table.lookup(0x0aff0000) != 7u or table.size() != 4, "prefix not replaced");
+        }
+
+        // erased prefixes give back their chunks, to be reused
+        {
+            LPMTable table;
+            const size_t empty_memory = table.memory_usage();
+            for (uint32_t i = 0; i < 1000; i++) {
+                table.insert(0xc0a80000 | i << 4, 28, i);
+            }
+            for (uint32_t i = 0; i < 1000; i++) {
+                table.erase(0xc0a80000 | i << 4, 28);
+            }
+            test_err_if(table.size() != 0 or table.lookup(0xc0a80010), "prefixes left over");
+
+            // the freed chunks are reused rather than growing the table
+            for (uint32_t i = 0; i < 1000; i++) {
+                table.insert(0xc0a80000 | i << 4, 28, i);
+            }
+            const size_t full_memory = table.memory_usage();
+            for (uint32_t i = 0; i < 1000; i++) {
+                table.erase(0xc0a80000 | i << 4, 28);
+            }
+            for (uint32_t i = 0; i < 1000; i++) {
+                table.insert(0xc0a80000 | i << 4, 28, i);
+            }
+            test_err_if(table.memory_usage() != full_memory or full_memory == empty_memory, "chunks not reused");
+        }
+
+        // snapshots go on answering as the table did when they were taken
+        {
+            auto rd = get_random_generator();
+            LPMTable table;
+            map<pair<uint32_t, uint8_t>, uint32_t> reference;
+            vector<pair<LPMTable::Snapshot, map<pair<uint32_t, uint8_t>, uint32_t>>> snapshots;
+
+            const auto random_address = [&] { return (uint32_t(rd() % 4) << 28) | (rd() & 0x000fffff); };
+            for (uint32_t i = 0; i < 5000; i++) {
+                const uint8_t length = 8 + rd() % 25;
+                const uint32_t prefix = random_address() & prefix_mask(length);
+                if (rd() % 3 == 0 and not reference.empty()) {
+                    auto it = reference.lower_bound({prefix, length});
+                    if (it == reference.end()) {
+                        it = reference.begin();
+                    }
+                    table.erase(it->first.first, it->first.second);
+                    reference.erase(it);
+                } else {
+                    table.insert(prefix, length, i);
+                    reference[{prefix, length}] = i;
+                }
+                if (i % 500 == 0) {
+                    snapshots.emplace_back(table.snapshot(), reference);
+                    snapshots.emplace_back(table.snapshot(), reference);  // 和上一个快照之间没有变化
+                }
+            }
+            snapshots.emplace_back(table.snapshot(), reference);
+
+            for (const auto &[snapshot, expected] : snapshots) {
+                for (size_t j = 0; j < 300; j++) {
+                    const uint32_t address = random_address();
+                    test_err_if(snapshot.lookup(address) != linear_lookup(expected, address),
+                                "snapshot lookup disagrees for " + to_string(address));
+                }
+            }
+        }
+
+        // compare against a linear scan, with random overlapping insertions and erasures
+        {
+            auto rd = get_random_generator();
+            LPMTable table;
+            map<pair<uint32_t, uint8_t>, uint32_t> reference;
+
+            // 地址集中在少数几个/12里，让前缀大量重叠
+            const auto random_address = [&] { return (uint32_t(rd() % 4) << 28) | (rd() & 0x000fffff); };
+
+            for (uint32_t i = 0; i < 20000; i++) {
+                const uint8_t length = rd() % 33;
+                const uint32_t prefix = random_address() & prefix_mask(length);
+
+                if (rd() % 3 == 0 and not reference.empty()) {
+                    // 删除一个已有的前缀，或者一个不存在的前缀
+                    auto it = reference.lower_bound({prefix, length});
+                    if (it == reference.end()) {
+                        it = reference.begin();
+                    }
+                    const auto [erased_prefix, erased_length] = it->first;
+                    test_err_if(not table.erase(erased_prefix, erased_length), "erase of existing prefix failed");
+                    reference.erase(it);
+                    test_err_if(table.erase(prefix, length) != (reference.erase({prefix, length}) == 1),
+                                "erase disagrees about presence");
+                } else {
+                    table.insert(prefix, length, i);
+                    reference[{prefix, length}] = i;
+                }
+                test_err_if(table.size() != reference.size(), "size disagrees");
+
+                for (size_t j = 0; j < 4; j++) {
+                    const uint32_t address = j == 0 ? prefix | (rd() & ~prefix_mask(length)) : random_address();
+                    test_err_if(table.lookup(address) != linear_lookup(reference, address),
+                                "lookup disagrees with linear scan for " + to_string(address));
+                }
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "mpsc_ring.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        // first in, first out; full and empty are reported
+        {
+            MPSCRing<string> ring{3};
+            test_err_if(ring.capacity() != 4, "capacity not rounded up to a power of two");
+
+            string value;
+            test_err_if(ring.pop(value), "empty ring popped");
+            for (size_t lap = 0; lap < 3; lap++) {
+                for (size_t i = 0; i < 4; i++) {
+                    test_err_if(not ring.push(to_string(i)), "push to a ring with room failed");
+                }
+                string extra = "extra";
+                test_err_if(ring.push(move(extra)), "push to a full ring succeeded");
+                test_err_if(extra != "extra", "failed push took the value");
+                for (size_t i = 0; i < 4; i++) {
+                    test_err_if(not ring.pop(value) or value != to_string(i), "elements out of order");
+                }
+                test_err_if(ring.pop(value), "ring not empty after popping everything");
+            }
+        }
+
+        // several producers at once: every element arrives exactly once, each producer's in order
+        {
+            constexpr size_t n_producers = 4;
+            constexpr uint64_t per_producer = 100000;
+            MPSCRing<uint64_t> ring{64};
+
+            vector<thread> producers;
+            for (uint64_t p = 0; p < n_producers; p++) {
+                producers.emplace_back([&ring, p] {
+                    for (uint64_t i = 0; i < per_producer; i++) {
+                        while (not ring.push(p << 32 | i)) {
+                            this_thread::yield();
+                        }
+                    }
+                });
+            }
+
+            vector<uint64_t> next(n_producers, 0);
+            for (uint64_t received = 0; received < n_producers * per_producer;) {
+                uint64_t value;
+                if (not ring.pop(value)) {
+                    this_thread::yield();
+                    continue;
+                }
+                const uint64_t p = value >> 32;
+                test_err_if(p >= n_producers or (value & 0xffffffff) != next[p], "element lost or reordered");
+                next[p]++;
+                received++;
+            }
+            for (auto &producer : producers) {
+                producer.join();
+            }
+
+            uint64_t value;
+            test_err_if(ring.pop(value), "extra element");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -313,6 +313,210 @@ int main() {
                            make_arp(ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5").serialize())});
             test.execute(ExpectNoFrame{});
         }
+
+        {
+            const EthernetAddress local_eth = random_private_ethernet_address();
+            NetworkInterfaceTestHarness test{
+                "unanswered ARP requests back off and then give up", local_eth, Address("1.2.3.4", 0)};
+            const auto arp_request = make_frame(
+                local_eth,
+                ETHERNET_BROADCAST,
+                EthernetHeader::TYPE_ARP,
+                make_arp(ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1").serialize());
+
+            test.execute(SendDatagram{make_datagram("5.6.7.8", "13.12.11.10"), Address("10.0.0.1", 0)});
+            test.execute(SendDatagram{make_datagram("5.6.7.8", "13.12.11.11"), Address("10.0.0.1", 0)});
+            test.execute(ExpectFrame{arp_request});
+            test.execute(ExpectNoFrame{});
+
+            // retries come from tick(), after 5 and then 10 more seconds
+            test.execute(Tick{4999});
+            test.execute(ExpectNoFrame{});
+            test.execute(Tick{1});
+            test.execute(ExpectFrame{arp_request});
+            test.execute(ExpectNoFrame{});
+            test.execute(Tick{9999});
+            test.execute(ExpectNoFrame{});
+            test.execute(Tick{1});
+            test.execute(ExpectFrame{arp_request});
+            test.execute(ExpectNoFrame{});
+
+            // after the third request goes unanswered for 20 seconds, the queued datagrams are dropped
+            test.execute(Tick{19999});
+            test.execute(ExpectFramesDropped{0});
+            test.execute(Tick{1});
+            test.execute(ExpectNoFrame{});
+            test.execute(ExpectFramesDropped{2});
+
+            // a late reply has nothing left to deliver
+            const EthernetAddress remote_eth = random_private_ethernet_address();
+            test.execute(ReceiveFrame{
+                make_frame(
+                    remote_eth,
+                    local_eth,
+                    EthernetHeader::TYPE_ARP,
+                    make_arp(ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4").serialize()),
+                {}});
+            test.execute(ExpectNoFrame{});
+        }
+
+        {
+            const EthernetAddress local_eth = random_private_ethernet_address();
+            ARPConfig config;
+            config.max_pending_per_hop = 2;
+            config.max_pending = 3;
+            NetworkInterfaceTestHarness test{"pending frames are bounded", local_eth, Address("1.2.3.4", 0), config};
+
+            const auto datagram1 = make_datagram("5.6.7.8", "13.12.11.10");
+            const auto datagram2 = make_datagram("5.6.7.8", "13.12.11.11");
+            const auto datagram3 = make_datagram("5.6.7.8", "13.12.11.12");
+            const auto datagram4 = make_datagram("5.6.7.8", "13.12.11.13");
+
+            // the oldest frame for a next hop is dropped when its queue is full
+            test.execute(SendDatagram{datagram1, Address("10.0.0.1", 0)});
+            test.execute(SendDatagram{datagram2, Address("10.0.0.1", 0)});
+            test.execute(SendDatagram{datagram3, Address("10.0.0.1", 0)});
+            test.execute(ExpectFrame{make_frame(
+                local_eth,
+                ETHERNET_BROADCAST,
+                EthernetHeader::TYPE_ARP,
+                make_arp(ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1").serialize())});
+            test.execute(ExpectFramesDropped{1});
+
+            // a new frame is dropped (and not ARPed for) when all the queues together are full
+            test.execute(SendDatagram{datagram4, Address("10.0.0.2", 0)});
+            test.execute(SendDatagram{datagram4, Address("10.0.0.3", 0)});
+            test.execute(ExpectFrame{make_frame(
+                local_eth,
+                ETHERNET_BROADCAST,
+                EthernetHeader::TYPE_ARP,
+                make_arp(ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.2").serialize())});
+            test.execute(ExpectNoFrame{});
+            test.execute(ExpectFramesDropped{2});
+
+            const EthernetAddress remote_eth = random_private_ethernet_address();
+            test.execute(ReceiveFrame{
+                make_frame(
+                    remote_eth,
+                    local_eth,
+                    EthernetHeader::TYPE_ARP,
+                    make_arp(ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4").serialize()),
+                {}});
+            test.execute(
+                ExpectFrame{make_frame(local_eth, remote_eth, EthernetHeader::TYPE_IPv4, datagram2.serialize())});
+            test.execute(
+                ExpectFrame{make_frame(local_eth, remote_eth, EthernetHeader::TYPE_IPv4, datagram3.serialize())});
+            test.execute(ExpectNoFrame{});
+        }
+
+        {
+            const EthernetAddress local_eth = random_private_ethernet_address();
+            ARPConfig config;
+            config.max_pending_per_hop = 0;
+            NetworkInterfaceTestHarness test{
+                "no frames are queued with a cap of 0", local_eth, Address("1.2.3.4", 0), config};
+
+            // the next hop is still ARPed for, but the frame is dropped
+            const auto datagram = make_datagram("5.6.7.8", "13.12.11.10");
+            test.execute(SendDatagram{datagram, Address("10.0.0.1", 0)});
+            test.execute(ExpectFrame{make_frame(
+                local_eth,
+                ETHERNET_BROADCAST,
+                EthernetHeader::TYPE_ARP,
+                make_arp(ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1").serialize())});
+            test.execute(ExpectFramesDropped{1});
+
+            const EthernetAddress remote_eth = random_private_ethernet_address();
+            test.execute(ReceiveFrame{
+                make_frame(
+                    remote_eth,
+                    local_eth,
+                    EthernetHeader::TYPE_ARP,
+                    make_arp(ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4").serialize()),
+                {}});
+            test.execute(ExpectNoFrame{});
+            test.execute(SendDatagram{datagram, Address("10.0.0.1", 0)});
+            test.execute(
+                ExpectFrame{make_frame(local_eth, remote_eth, EthernetHeader::TYPE_IPv4, datagram.serialize())});
+        }
+
+        {
+            const EthernetAddress local_eth = random_private_ethernet_address();
+            const EthernetAddress target_eth = random_private_ethernet_address();
+            NetworkInterfaceTestHarness test{
+                "mappings in use are refreshed before they expire", local_eth, Address("4.3.2.1", 0)};
+
+            test.execute(ReceiveFrame{
+                make_frame(
+                    target_eth,
+                    local_eth,
+                    EthernetHeader::TYPE_ARP,
+                    make_arp(ARPMessage::OPCODE_REPLY, target_eth, "192.168.0.1", local_eth, "4.3.2.1").serialize()),
+                {}});
+            test.execute(ExpectNoFrame{});
+
+            // more than 2 seconds before expiry: no refresh
+            const auto datagram = make_datagram("5.6.7.8", "13.12.11.10");
+            test.execute(Tick{27999});
+            test.execute(SendDatagram{datagram, Address("192.168.0.1", 0)});
+            test.execute(
+                ExpectFrame{make_frame(local_eth, target_eth, EthernetHeader::TYPE_IPv4, datagram.serialize())});
+            test.execute(ExpectNoFrame{});
+
+            // within 2 seconds: the old mapping is still used, and a unicast ARP request refreshes it (once)
+            const auto refresh = make_frame(
+                local_eth,
+                target_eth,
+                EthernetHeader::TYPE_ARP,
+                make_arp(ARPMessage::OPCODE_REQUEST, local_eth, "4.3.2.1", {}, "192.168.0.1").serialize());
+            test.execute(Tick{1});
+            test.execute(SendDatagram{datagram, Address("192.168.0.1", 0)});
+            test.execute(
+                ExpectFrame{make_frame(local_eth, target_eth, EthernetHeader::TYPE_IPv4, datagram.serialize())});
+            test.execute(ExpectFrame{refresh});
+            test.execute(ExpectNoFrame{});
+            test.execute(Tick{1000});
+            test.execute(SendDatagram{datagram, Address("192.168.0.1", 0)});
+            test.execute(
+                ExpectFrame{make_frame(local_eth, target_eth, EthernetHeader::TYPE_IPv4, datagram.serialize())});
+            test.execute(ExpectNoFrame{});
+
+            // the reply renews the mapping, so datagrams keep flowing past the original expiry
+            test.execute(ReceiveFrame{
+                make_frame(
+                    target_eth,
+                    local_eth,
+                    EthernetHeader::TYPE_ARP,
+                    make_arp(ARPMessage::OPCODE_REPLY, target_eth, "192.168.0.1", local_eth, "4.3.2.1").serialize()),
+                {}});
+            test.execute(Tick{5000});
+            test.execute(SendDatagram{datagram, Address("192.168.0.1", 0)});
+            test.execute(
+                ExpectFrame{make_frame(local_eth, target_eth, EthernetHeader::TYPE_IPv4, datagram.serialize())});
+            test.execute(ExpectNoFrame{});
+        }
+
+        {
+            const EthernetAddress local_eth = random_private_ethernet_address();
+            ARPConfig config;
+            config.announcements = 2;
+            NetworkInterfaceTestHarness test{
+                "gratuitous ARP announcements on start", local_eth, Address("1.2.3.4", 0), config};
+            const auto announcement =
+                make_frame(local_eth,
+                           ETHERNET_BROADCAST,
+                           EthernetHeader::TYPE_ARP,
+                           make_arp(ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "1.2.3.4").serialize());
+
+            test.execute(ExpectFrame{announcement});
+            test.execute(ExpectNoFrame{});
+            test.execute(Tick{1999});
+            test.execute(ExpectNoFrame{});
+            test.execute(Tick{1});
+            test.execute(ExpectFrame{announcement});
+            test.execute(Tick{10000});
+            test.execute(ExpectNoFrame{});
+        }
     } catch (const exception &e) {
         cerr << e.what() << endl;
         return EXIT_FAILURE;
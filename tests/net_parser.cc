@@ -0,0 +1,180 @@
+#include "parser.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! An integer of 1, 2 or 4 bytes
+struct Field {
+    size_t size;
+    uint32_t value;
+};
+
+//! `field` in network byte order, worked out a byte at a time
+static string big_endian(const Field &field) {
+    string bytes;
+    for (size_t i = field.size; i > 0; i--) {
+        bytes.push_back(char(field.value >> (8 * (i - 1))));
+    }
+    return bytes;
+}
+
+static Field random_field(mt19937 &rd) {
+    const size_t sizes[] = {1, 2, 4};
+    const size_t size = sizes[rd() % 3];
+    const uint32_t value = rd();
+    return {size, size == 4 ? value : value & ((uint32_t(1) << (8 * size)) - 1)};
+}
+
+static void unparse(string &s, const Field &field) {
+    switch (field.size) {
+        case 1:
+            NetUnparser::u8(s, field.value);
+            break;
+        case 2:
+            NetUnparser::u16(s, field.value);
+            break;
+        default:
+            NetUnparser::u32(s, field.value);
+    }
+}
+
+static void unparse(char *&out, const Field &field) {
+    switch (field.size) {
+        case 1:
+            NetUnparser::u8(out, field.value);
+            break;
+        case 2:
+            NetUnparser::u16(out, field.value);
+            break;
+        default:
+            NetUnparser::u32(out, field.value);
+    }
+}
+
+static uint32_t parse(NetParser &p, const size_t size) {
+    switch (size) {
+        case 1:
+            return p.u8();
+        case 2:
+            return p.u16();
+        default:
+            return p.u32();
+    }
+}
+
+static uint32_t peek(const char *p, const size_t size) {
+    switch (size) {
+        case 1:
+            return NetPeeker::u8(p);
+        case 2:
+            return NetPeeker::u16(p);
+        default:
+            return NetPeeker::u32(p);
+    }
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // the bytes written are in network byte order, whichever way they are written
+        {
+            string s;
+            NetUnparser::u32(s, 0x01020304);
+            NetUnparser::u16(s, 0xabcd);
+            NetUnparser::u8(s, 0x7f);
+            test_err_if(s != string("\x01\x02\x03\x04\xab\xcd\x7f"), "string unparser wrote the wrong bytes");
+
+            array<char, 7> bytes{};
+            char *out = bytes.data();
+            NetUnparser::u32(out, 0x01020304);
+            NetUnparser::u16(out, 0xabcd);
+            NetUnparser::u8(out, 0x7f);
+            test_err_if(out != bytes.data() + bytes.size(), "cursor not advanced past the integers");
+            test_err_if(string(bytes.data(), bytes.size()) != s, "cursor unparser wrote the wrong bytes");
+        }
+
+        // random integers round-trip through both unparsers, NetParser and NetPeeker
+        for (size_t round = 0; round < 1000; round++) {
+            vector<Field> fields;
+            string expected;
+            for (size_t i = rd() % 20; i > 0; i--) {
+                fields.push_back(random_field(rd));
+                expected += big_endian(fields.back());
+            }
+
+            string appended;
+            vector<char> written(expected.size());
+            char *out = written.data();
+            for (const Field &field : fields) {
+                unparse(appended, field);
+                unparse(out, field);
+            }
+            test_err_if(appended != expected, "string unparser wrote the wrong bytes");
+            test_err_if(out != written.data() + written.size(), "cursor not advanced past the integers");
+            test_err_if(string(written.begin(), written.end()) != expected, "cursor unparser wrote the wrong bytes");
+
+            // 在随机的偏移处（大多没有对齐）读取
+            NetParser p{Buffer(string(expected))};
+            size_t offset = 0;
+            for (const Field &field : fields) {
+                test_err_if(peek(expected.data() + offset, field.size) != field.value, "NetPeeker read wrong");
+                test_err_if(parse(p, field.size) != field.value, "NetParser read wrong");
+                offset += field.size;
+                test_err_if(p.size() != expected.size() - offset, "NetParser size wrong");
+            }
+            test_err_if(p.error() or p.size() != 0 or p.buffer().size() != 0, "NetParser didn't finish cleanly");
+        }
+
+        // buffer() and size() after parsing part of a header: the rest of the same storage
+        {
+            const Buffer original{string("\x45\x00\x00\x14\x12\x34\x40\x00\x40\x06payload", 17)};
+            NetParser p{original};
+            test_err_if(p.u8() != 0x45 or p.u8() != 0 or p.u16() != 0x14, "header start misread");
+            test_err_if(p.size() != original.size() - 4, "size() after 4 bytes");
+            test_err_if(p.buffer().str() != original.str().substr(4), "buffer() after 4 bytes");
+            test_err_if(p.buffer().str().data() != original.str().data() + 4, "buffer() copied the data");
+
+            p.remove_prefix(6);
+            test_err_if(p.buffer().copy() != "payload" or p.size() != 7, "remove_prefix() didn't skip");
+            test_err_if(p.error(), "error without running out of data");
+        }
+
+        // running out of data partway through a header is PacketTooShort, and nothing more is consumed
+        {
+            const string truncated("\x45\x00\x00\x14\x12\x34\x40\x00\x40\x06", 10);
+            NetParser p{Buffer(string(truncated))};
+            test_err_if(p.u32() != 0x45000014 or p.u32() != 0x12344000, "header start misread");
+            test_err_if(p.u32() != 0, "u32() past the end returned data");
+            test_err_if(p.get_error() != ParseResult::PacketTooShort, "u32() past the end not an error");
+            test_err_if(p.size() != 2 or p.buffer().str() != truncated.substr(8), "u32() past the end consumed data");
+
+            // 出错之后不再继续读
+            test_err_if(p.u8() != 0 or p.size() != 2, "parsed on after an error");
+            test_err_if(p.get_error() != ParseResult::PacketTooShort, "error cleared");
+
+            NetParser q{Buffer(string(truncated))};
+            q.u16();
+            q.remove_prefix(9);
+            test_err_if(q.get_error() != ParseResult::PacketTooShort, "remove_prefix() past the end not an error");
+            test_err_if(q.size() != 8, "remove_prefix() past the end consumed data");
+
+            NetParser r{Buffer(string(truncated.substr(0, 1)))};
+            test_err_if(r.u16() != 0 or r.get_error() != ParseResult::PacketTooShort or r.size() != 1,
+                        "u16() across the end");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
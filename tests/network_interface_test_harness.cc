@@ -51,8 +51,9 @@ NetworkInterfaceAction::~NetworkInterfaceAction() {}
 
 NetworkInterfaceTestHarness::NetworkInterfaceTestHarness(const std::string &test_name,
                                                          const EthernetAddress &ethernet_address,
-                                                         const Address &ip_address)
-    : _test_name(test_name), _interface(ethernet_address, ip_address) {
+                                                         const Address &ip_address,
+                                                         const ARPConfig &config)
+    : _test_name(test_name), _interface(ethernet_address, ip_address, config) {
     std::ostringstream ss;
     ss << "Initialized with ("
        << "ethernet_address=" << to_string(ethernet_address) << ", "
@@ -167,6 +168,15 @@ void ExpectNoFrame::execute(NetworkInterface &interface) const {
     }
 }
 
+string ExpectFramesDropped::description() const { return to_string(_count) + " frames dropped in total"; }
+
+void ExpectFramesDropped::execute(NetworkInterface &interface) const {
+    if (interface.counters().frames_dropped() != _count) {
+        throw NetworkInterfaceExpectationViolation::property(
+            "frames dropped", _count, interface.counters().frames_dropped());
+    }
+}
+
 string Tick::description() const { return to_string(_ms) + " ms pass"; }
 
 void Tick::execute(NetworkInterface &interface) const { interface.tick(_ms); }
@@ -69,6 +69,15 @@ struct ExpectNoFrame : public NetworkInterfaceExpectation {
     void execute(NetworkInterface &interface) const override;
 };
 
+struct ExpectFramesDropped : public NetworkInterfaceExpectation {
+    uint64_t _count;
+
+    std::string description() const override;
+    void execute(NetworkInterface &interface) const override;
+
+    ExpectFramesDropped(const uint64_t count) : _count(count) {}
+};
+
 struct Tick : public NetworkInterfaceAction {
     size_t _ms;
 
@@ -86,7 +95,8 @@ class NetworkInterfaceTestHarness {
   public:
     NetworkInterfaceTestHarness(const std::string &test_name,
                                 const EthernetAddress &ethernet_address,
-                                const Address &ip_address);
+                                const Address &ip_address,
+                                const ARPConfig &config = ARPConfig{});
 
     void execute(const NetworkInterfaceTestStep &step);
 };
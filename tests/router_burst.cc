@@ -0,0 +1,115 @@
+#include "router_test_harness.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t n_interfaces = 4;
+
+//! A router with random routes; the gateways of all but the last interface have known Ethernet addresses
+static Router make_router(const RouterConfig &config, const vector<pair<uint32_t, uint8_t>> &prefixes) {
+    Router router{config};
+    add_interfaces(router, n_interfaces, n_interfaces - 1);
+
+    // 一半的路由直连（下一跳就是目的地址，大多没有ARP映射），一半经过网关
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        const size_t interface_num = i % n_interfaces;
+        const optional<Address> next_hop =
+            i % 2 ? optional<Address>{} : Address::from_ipv4_numeric(gateway_ip(interface_num));
+        router.add_route(prefixes[i].first, prefixes[i].second, next_hop, interface_num);
+    }
+    return router;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // 不覆盖整个地址空间，所以有些datagram没有路由
+        vector<pair<uint32_t, uint8_t>> prefixes;
+        for (size_t i = 0; i < 200; i++) {
+            const uint8_t length = 8 + rd() % 25;
+            prefixes.emplace_back(0xc0000000 | (uint32_t(rd()) & 0x00ffffff & (~uint32_t(0) << (32 - length))),
+                                  length);
+        }
+
+        for (const size_t cache_slots : {size_t(0), size_t(64)}) {
+            for (const size_t burst_size : {size_t(1), size_t(7), size_t(64)}) {
+                RouterConfig scalar_config;
+                scalar_config.route_cache_slots = cache_slots;
+                RouterConfig burst_config = scalar_config;
+                burst_config.burst_size = burst_size;
+
+                Router scalar = make_router(scalar_config, prefixes);
+                Router burst = make_router(burst_config, prefixes);
+
+                // datagram从各个网卡进来，目的地址集中在少数几个前缀里，ttl有时耗尽；
+                // burst路由器一次收下每个网卡的一批frame（有些校验和错误，有些不是发给它的）
+                for (size_t round = 0; round < 50; round++) {
+                    vector<vector<EthernetFrame>> arriving(n_interfaces);
+                    const size_t count = rd() % 200;
+                    for (size_t i = 0; i < count; i++) {
+                        const auto &prefix = prefixes[rd() % 20];
+                        InternetDatagram dgram;
+                        dgram.header().src = 0x0a000063;
+                        dgram.header().dst = prefix.first | (uint32_t(rd()) & 0x0f);
+                        dgram.header().ttl = rd() % 8;
+                        dgram.payload() = Buffer(to_string(i % 10000));
+                        dgram.header().len = IPv4Header::LENGTH + dgram.payload().size();
+
+                        const size_t interface_num = rd() % n_interfaces;
+                        string wire = dgram.serialize().concatenate();
+                        if (rd() % 16 == 0) {
+                            wire[IPv4Header::CKSUM_OFFSET] ^= 1;
+                        }
+                        EthernetFrame frame;
+                        frame.header().dst = local_mac(rd() % 16 ? interface_num : 9);
+                        frame.header().src = gateway_mac(interface_num);
+                        frame.header().type = EthernetHeader::TYPE_IPv4;
+                        frame.payload() = Buffer(move(wire));
+                        arriving[interface_num].push_back(move(frame));
+                    }
+                    for (size_t i = 0; i < n_interfaces; i++) {
+                        for (const EthernetFrame &frame : arriving[i]) {
+                            scalar.interface(i).recv_frame(frame);
+                        }
+                        burst.interface(i).recv_frames(arriving[i].data(), arriving[i].size());
+                        test_err_if(scalar.interface(i).datagrams_out().size() !=
+                                        burst.interface(i).datagrams_out().size(),
+                                    "recv_frames() received different datagrams");
+                    }
+                    scalar.route();
+                    burst.route();
+
+                    // 每个网卡发出的frame（包括ARP请求）和顺序都必须一样
+                    for (size_t i = 0; i < n_interfaces; i++) {
+                        auto &expected = scalar.interface(i).frames_out();
+                        auto &actual = burst.interface(i).frames_out();
+                        test_err_if(expected.size() != actual.size(),
+                                    "interface " + to_string(i) + " sent " + to_string(actual.size()) +
+                                        " frames in bursts of " + to_string(burst_size) + ", expected " +
+                                        to_string(expected.size()));
+                        while (not expected.empty()) {
+                            test_err_if(expected.front().serialize().concatenate() !=
+                                            actual.front().serialize().concatenate(),
+                                        "frame differs in bursts of " + to_string(burst_size));
+                            expected.pop();
+                            actual.pop();
+                        }
+                    }
+                }
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
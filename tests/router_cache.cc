@@ -0,0 +1,74 @@
+#include "router_test_harness.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+//! Route a datagram to `dst` that arrived on interface 0
+//! \returns the index of the interface it was sent from
+static size_t route_to(Router &router, const uint32_t dst) {
+    InternetDatagram dgram;
+    dgram.header().src = 0x0a000063;
+    dgram.header().dst = dst;
+    dgram.header().ttl = 64;
+    dgram.header().len = IPv4Header::LENGTH;
+    router.interface(0).datagrams_out().push(dgram);
+    router.route();
+
+    for (size_t i = 0; i < 2; i++) {
+        auto &frames = router.interface(i).frames_out();
+        if (not frames.empty()) {
+            test_err_if(frames.front().header().dst != gateway_mac(i), "datagram sent to the wrong next hop");
+            frames.pop();
+            test_err_if(not frames.empty(), "more than one frame sent");
+            return i;
+        }
+    }
+    throw runtime_error("datagram to " + Address::from_ipv4_numeric(dst).ip() + " not sent");
+}
+
+int main() {
+    try {
+        RouterConfig config;
+        config.route_cache_slots = 16;
+        Router router{config};
+        add_interfaces(router, 2);
+        router.add_route(0, 0, Address::from_ipv4_numeric(gateway_ip(0)), 0);
+
+        // the first datagram to a destination misses, the next ones hit
+        test_err_if(route_to(router, 0xc0a80101) != 0, "default route not used");
+        test_err_if(router.counters().route_cache_misses != 1, "first lookup didn't miss");
+        test_err_if(route_to(router, 0xc0a80101) != 0, "cached route not used");
+        test_err_if(router.counters().route_cache_hits != 1, "second lookup didn't hit");
+
+        // adding a more specific route takes effect at once
+        router.add_route(0xc0a80100, 24, Address::from_ipv4_numeric(gateway_ip(1)), 1);
+        test_err_if(route_to(router, 0xc0a80101) != 1, "stale cached route used after add_route");
+        test_err_if(route_to(router, 0xc0a80101) != 1, "new route not cached");
+        test_err_if(router.counters().route_cache_hits != 2 or router.counters().route_cache_misses != 2,
+                    "wrong hit/miss counts after add_route");
+
+        // and so does removing it
+        test_err_if(not router.remove_route(0xc0a80100, 24), "route not removed");
+        test_err_if(route_to(router, 0xc0a80101) != 0, "stale cached route used after remove_route");
+
+        // many destinations collide in 16 slots; each still goes the right way
+        for (uint32_t host = 1; host < 256; host += 2) {
+            router.add_route(0xc0a80000 | host << 4, 28, Address::from_ipv4_numeric(gateway_ip(1)), 1);
+        }
+        for (size_t round = 0; round < 3; round++) {
+            for (uint32_t host = 0; host < 256; host++) {
+                const size_t expected = host % 2;
+                test_err_if(route_to(router, 0xc0a80000 | host << 4) != expected, "colliding destinations mixed up");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#include "router_test_harness.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t n_interfaces = 5;  // 0是入口，1到4是通往同一个网络的等价链路
+constexpr size_t n_flows = 2000;
+constexpr uint8_t PROTO_ICMP = 1;
+
+//! A router whose interfaces each have a gateway with a known Ethernet address, and whose routes to
+//! 192.168.0.0/16 go through the gateways of interfaces 1 to 4
+static Router make_router(const RouterConfig &config) {
+    Router router{config};
+    add_interfaces(router, n_interfaces);
+
+    router.add_route(0xc0a80000, 16, Address::from_ipv4_numeric(gateway_ip(1)), 1);
+    for (size_t i = 2; i < n_interfaces; i++) {
+        router.add_equal_cost_route(0xc0a80000, 16, Address::from_ipv4_numeric(gateway_ip(i)), i);
+    }
+    return router;
+}
+
+//! A TCP or UDP flow
+struct Flow {
+    uint32_t src;
+    uint32_t dst;
+    uint16_t sport;
+    uint16_t dport;
+};
+
+//! A datagram of `flow`, whose payload starts with the ports (as a TCP or UDP header does)
+static InternetDatagram make_datagram(const Flow &flow,
+                                      const string &tag,
+                                      const uint8_t proto = IPv4Header::PROTO_TCP) {
+    InternetDatagram dgram;
+    dgram.header().src = flow.src;
+    dgram.header().dst = flow.dst;
+    dgram.header().proto = proto;
+    dgram.header().ttl = 64;
+    string payload;
+    for (const uint16_t port : {flow.sport, flow.dport}) {
+        payload.push_back(char(port >> 8));
+        payload.push_back(char(port & 0xff));
+    }
+    dgram.payload() = Buffer(payload + tag);
+    dgram.header().len = IPv4Header::LENGTH + dgram.payload().size();
+    return dgram;
+}
+
+//! Route `dgram` (arriving on interface 0)
+//! \returns the interface it was sent from, or n_interfaces if it wasn't sent
+static size_t egress(Router &router, const InternetDatagram &dgram) {
+    router.interface(0).datagrams_out().push(dgram);
+    router.route();
+    size_t sent_on = n_interfaces;
+    for (size_t i = 0; i < n_interfaces; i++) {
+        auto &frames = router.interface(i).frames_out();
+        while (not frames.empty()) {
+            test_err_if(sent_on != n_interfaces, "datagram sent more than once");
+            sent_on = i;
+            frames.pop();
+        }
+    }
+    return sent_on;
+}
+
+//! The frames an interface has sent, serialized and sorted
+static vector<string> sent_frames(Router &router, const size_t i) {
+    vector<string> frames;
+    auto &queue = router.interface(i).frames_out();
+    while (not queue.empty()) {
+        frames.push_back(queue.front().serialize().concatenate());
+        queue.pop();
+    }
+    sort(frames.begin(), frames.end());
+    return frames;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // 这个测试会大量地打印add_route()的DEBUG信息
+        const QuietCerr quiet{};
+
+        vector<Flow> flows;
+        for (size_t i = 0; i < n_flows; i++) {
+            flows.push_back({uint32_t(0x0a000000 | (rd() & 0xffff)),
+                             uint32_t(0xc0a80000 | (rd() & 0xffff)),
+                             uint16_t(rd()),
+                             uint16_t(rd())});
+        }
+
+        // every datagram of a flow takes the same route, and the flows are spread evenly
+        Router router = make_router(RouterConfig{});
+        vector<size_t> routes;
+        vector<size_t> flows_on(n_interfaces, 0);
+        for (const Flow &flow : flows) {
+            routes.push_back(egress(router, make_datagram(flow, "first")));
+            test_err_if(routes.back() == 0 or routes.back() == n_interfaces, "flow not routed over a path");
+            flows_on[routes.back()]++;
+        }
+        for (size_t i = 0; i < n_flows; i++) {
+            for (const char *tag : {"second", "third, which is longer"}) {
+                test_err_if(egress(router, make_datagram(flows[i], tag)) != routes[i], "flow changed routes");
+            }
+        }
+        for (size_t i = 1; i < n_interfaces; i++) {
+            // 期望值500，标准差大约19
+            test_err_if(flows_on[i] < 400 or flows_on[i] > 600,
+                        "interface " + to_string(i) + " carries " + to_string(flows_on[i]) + " of " +
+                            to_string(n_flows) + " flows");
+        }
+
+        // UDP is hashed by port too; other protocols, and fragments, by address only
+        {
+            size_t udp_differs = 0;
+            for (size_t i = 0; i < n_flows; i++) {
+                const InternetDatagram udp = make_datagram(flows[i], "", IPv4Header::PROTO_UDP);
+                const InternetDatagram udp_again = make_datagram(flows[i], "again", IPv4Header::PROTO_UDP);
+                test_err_if(egress(router, udp) != egress(router, udp_again), "UDP flow changed routes");
+                udp_differs += egress(router, udp) != routes[i];
+
+                Flow other_ports = flows[i];
+                other_ports.sport = uint16_t(rd());
+                other_ports.dport = uint16_t(rd());
+                test_err_if(egress(router, make_datagram(flows[i], "x", PROTO_ICMP)) !=
+                                egress(router, make_datagram(other_ports, "y", PROTO_ICMP)),
+                            "ICMP datagrams to the same address took different routes");
+
+                InternetDatagram first = make_datagram(flows[i], "first fragment");
+                first.header().mf = true;
+                InternetDatagram last = make_datagram(other_ports, "last fragment");
+                last.header().offset = 3;
+                test_err_if(egress(router, first) != egress(router, last), "fragments took different routes");
+            }
+            test_err_if(udp_differs == 0, "UDP flows hashed the same as TCP");
+        }
+
+        // adding a route the prefix already has changes nothing; add_route() replaces them all
+        router.add_equal_cost_route(0xc0a80000, 16, Address::from_ipv4_numeric(gateway_ip(3)), 3);
+        for (size_t i = 0; i < n_flows; i++) {
+            test_err_if(egress(router, make_datagram(flows[i], "dup")) != routes[i], "duplicate route moved flows");
+        }
+        router.add_route(0xc0a80000, 16, Address::from_ipv4_numeric(gateway_ip(4)), 4);
+        for (const Flow &flow : flows) {
+            test_err_if(egress(router, make_datagram(flow, "one")) != 4, "add_route() didn't replace the routes");
+        }
+        router.add_equal_cost_route(0xc0a80000, 16, Address::from_ipv4_numeric(gateway_ip(2)), 2);
+        for (const Flow &flow : flows) {
+            const size_t sent_on = egress(router, make_datagram(flow, "two"));
+            test_err_if(sent_on != 2 and sent_on != 4, "flow routed off the prefix's two routes");
+        }
+        router.remove_route(0xc0a80000, 16);
+        test_err_if(egress(router, make_datagram(flows[0], "none")) != n_interfaces, "removed routes still used");
+
+        // the route cache, bursts and worker threads choose the same routes
+        {
+            RouterConfig cached;
+            cached.route_cache_slots = 256;
+            RouterConfig burst;
+            burst.burst_size = 32;
+            RouterConfig threads;
+            threads.threads = 2;
+
+            Router scalar = make_router(RouterConfig{});
+            vector<Router> others;
+            for (const RouterConfig &config : {cached, burst, threads}) {
+                others.push_back(make_router(config));
+            }
+
+            for (size_t round = 0; round < 10; round++) {
+                for (size_t i = 0; i < 500; i++) {
+                    const InternetDatagram dgram = make_datagram(flows[rd() % n_flows], to_string(round));
+                    scalar.interface(0).datagrams_out().push(dgram);
+                    for (auto &other : others) {
+                        other.interface(0).datagrams_out().push(dgram);
+                    }
+                }
+                scalar.route();
+                for (auto &other : others) {
+                    other.route();
+                }
+
+                for (size_t i = 0; i < n_interfaces; i++) {
+                    const vector<string> expected = sent_frames(scalar, i);
+                    for (auto &other : others) {
+                        test_err_if(sent_frames(other, i) != expected,
+                                    "interface " + to_string(i) + " sent different frames");
+                    }
+                }
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#include "ip_reassembler.hh"
+#include "router_test_harness.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t n_interfaces = 3;
+constexpr size_t small_mtu = 576;
+
+//! A router whose interface 1 has a small MTU, with a route to 192.168.1.0/24 through interface 1
+//! and one to 192.168.2.0/24 through interface 2
+static Router make_router(const RouterConfig &config) {
+    Router router{config};
+    add_interfaces(router, n_interfaces);
+    router.interface(1).set_mtu(small_mtu);
+    router.add_route(0xc0a80100, 24, Address::from_ipv4_numeric(gateway_ip(1)), 1);
+    router.add_route(0xc0a80200, 24, Address::from_ipv4_numeric(gateway_ip(2)), 2);
+    return router;
+}
+
+static InternetDatagram make_datagram(const uint32_t dst, const uint16_t id, const size_t size, const bool df) {
+    InternetDatagram dgram;
+    dgram.header().src = 0x0a000063;
+    dgram.header().dst = dst;
+    dgram.header().id = id;
+    dgram.header().df = df;
+    dgram.header().ttl = 64;
+    string payload = to_string(id) + "/";
+    payload.resize(size - IPv4Header::LENGTH, 'x');
+    dgram.payload() = Buffer(move(payload));
+    dgram.header().len = size;
+    return dgram;
+}
+
+//! The datagrams in the frames an interface has sent
+static vector<InternetDatagram> sent_datagrams(Router &router, const size_t i) {
+    vector<InternetDatagram> datagrams;
+    auto &frames = router.interface(i).frames_out();
+    while (not frames.empty()) {
+        InternetDatagram dgram;
+        test_err_if(dgram.parse(Buffer(frames.front().payload().concatenate())) != ParseResult::NoError,
+                    "sent datagram didn't parse");
+        datagrams.push_back(move(dgram));
+        frames.pop();
+    }
+    return datagrams;
+}
+
+static string wire(const InternetDatagram &dgram) { return dgram.serialize().concatenate(); }
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // 路由和网卡都会打印DEBUG信息，这里不需要
+        const QuietCerr quiet{};
+
+        RouterConfig burst;
+        burst.burst_size = 16;
+        RouterConfig threads;
+        threads.threads = 2;
+
+        for (const RouterConfig &config : {RouterConfig{}, burst, threads}) {
+            Router router = make_router(config);
+
+            // 到两个子网的datagram，大小随机；有一些设置了DF
+            vector<InternetDatagram> expected_small, expected_large;
+            size_t too_big = 0;
+            for (uint16_t id = 0; id < 500; id++) {
+                const bool to_small = rd() % 2;
+                const size_t size = IPv4Header::LENGTH + 8 + rd() % 1470;
+                const bool df = rd() % 8 == 0;
+                const InternetDatagram dgram = make_datagram(to_small ? 0xc0a80105 : 0xc0a80205, id, size, df);
+                router.interface(0).datagrams_out().push(dgram);
+
+                InternetDatagram forwarded = dgram;
+                forwarded.header().ttl--;
+                if (not to_small) {
+                    expected_large.push_back(forwarded);
+                } else if (df and size > small_mtu) {
+                    too_big++;
+                } else {
+                    expected_small.push_back(forwarded);
+                }
+            }
+            router.route();
+
+            // the link with the small MTU carries fragments, which put back together are the datagrams routed to it
+            IPv4Reassembler reassembler;
+            vector<InternetDatagram> reassembled;
+            for (const auto &dgram : sent_datagrams(router, 1)) {
+                test_err_if(dgram.header().len > small_mtu, "datagram longer than the MTU sent");
+                const optional<InternetDatagram> whole = reassembler.push(dgram);
+                if (whole) {
+                    reassembled.push_back(*whole);
+                }
+            }
+            test_err_if(reassembled.size() != expected_small.size(), "datagrams lost on the small-MTU link");
+            for (size_t i = 0; i < reassembled.size(); i++) {
+                test_err_if(wire(reassembled[i]) != wire(expected_small[i]), "datagram changed by fragmentation");
+            }
+
+            const FragmentationCounters &counters = router.interface(1).fragmentation_counters();
+            test_err_if(counters.dropped_too_big != too_big, "datagrams with DF not dropped");
+            test_err_if(counters.fragments_sent != reassembler.counters().fragments_received,
+                        "fragments miscounted");
+
+            // the other link is untouched
+            const vector<InternetDatagram> large = sent_datagrams(router, 2);
+            test_err_if(large.size() != expected_large.size(), "datagrams lost on the large-MTU link");
+            for (size_t i = 0; i < large.size(); i++) {
+                test_err_if(wire(large[i]) != wire(expected_large[i]), "datagram changed on the large-MTU link");
+            }
+            test_err_if(router.interface(2).fragmentation_counters().datagrams_fragmented != 0, "fragmented");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#include "router_test_harness.hh"
+
+#include "arp_message.hh"
+
+#include <iostream>
+
+using namespace std;
+
+uint32_t local_ip(const size_t i) { return 0x0a000001 | uint32_t(i) << 16; }
+
+uint32_t gateway_ip(const size_t i) { return 0x0a000002 | uint32_t(i) << 16; }
+
+EthernetAddress local_mac(const size_t i) { return {2, 0, 0, 0, 0, uint8_t(i)}; }
+
+EthernetAddress gateway_mac(const size_t i) { return {2, 0, 0, 0, 1, uint8_t(i)}; }
+
+EthernetFrame arp_reply(const EthernetAddress &sender_mac,
+                        const uint32_t sender_ip,
+                        const EthernetAddress &target_mac,
+                        const uint32_t target_ip) {
+    ARPMessage reply;
+    reply.opcode = ARPMessage::OPCODE_REPLY;
+    reply.sender_ethernet_address = sender_mac;
+    reply.sender_ip_address = sender_ip;
+    reply.target_ethernet_address = target_mac;
+    reply.target_ip_address = target_ip;
+
+    EthernetFrame frame;
+    frame.header().dst = target_mac;
+    frame.header().src = sender_mac;
+    frame.header().type = EthernetHeader::TYPE_ARP;
+    frame.payload() = reply.serialize();
+    return frame;
+}
+
+void add_interfaces(Router &router, const size_t count, const size_t known_gateways) {
+    for (size_t i = 0; i < count; i++) {
+        router.add_interface(AsyncNetworkInterface{local_mac(i), Address::from_ipv4_numeric(local_ip(i))});
+        if (i < known_gateways) {
+            router.interface(i).recv_frame(arp_reply(gateway_mac(i), gateway_ip(i), local_mac(i), local_ip(i)));
+        }
+    }
+}
+
+QuietCerr::QuietCerr() { cerr.setstate(ios::badbit); }
+
+QuietCerr::~QuietCerr() { cerr.clear(); }
@@ -0,0 +1,45 @@
+#ifndef SPONGE_ROUTER_TEST_HARNESS_HH
+#define SPONGE_ROUTER_TEST_HARNESS_HH
+
+#include "router.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+//! \brief The address of interface `i` of a test router: 10.i.0.1
+uint32_t local_ip(const size_t i);
+
+//! \brief The address of the gateway on interface `i`'s link: 10.i.0.2
+uint32_t gateway_ip(const size_t i);
+
+//! \brief The Ethernet address of interface `i` of a test router: 02:00:00:00:00:i
+EthernetAddress local_mac(const size_t i);
+
+//! \brief The Ethernet address of the gateway on interface `i`'s link: 02:00:00:00:01:i
+EthernetAddress gateway_mac(const size_t i);
+
+//! \brief An ARP reply from `sender_mac`/`sender_ip` to `target_mac`/`target_ip`, framed as it arrives at the target
+EthernetFrame arp_reply(const EthernetAddress &sender_mac,
+                        const uint32_t sender_ip,
+                        const EthernetAddress &target_mac,
+                        const uint32_t target_ip);
+
+//! \brief Add interfaces 0 to `count - 1` to `router`, at local_mac(i) and local_ip(i)
+//! \param[in] known_gateways the first this many interfaces are sent an ARP reply from their gateway,
+//! so that they know its Ethernet address
+void add_interfaces(Router &router,
+                    const size_t count,
+                    const size_t known_gateways = std::numeric_limits<size_t>::max());
+
+//! \brief Keeps std::cerr quiet while it exists (the interfaces and the router print DEBUG messages)
+class QuietCerr {
+  public:
+    QuietCerr();
+    ~QuietCerr();
+
+    QuietCerr(const QuietCerr &other) = delete;
+    QuietCerr &operator=(const QuietCerr &other) = delete;
+};
+
+#endif  // SPONGE_ROUTER_TEST_HARNESS_HH
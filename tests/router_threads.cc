@@ -0,0 +1,130 @@
+#include "router_test_harness.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t n_interfaces = 6;
+
+//! A router whose interfaces each have a gateway with a known Ethernet address
+static Router make_router(const RouterConfig &config) {
+    Router router{config};
+    add_interfaces(router, n_interfaces);
+    return router;
+}
+
+static InternetDatagram make_datagram(const uint32_t dst, const uint8_t ttl, const string &payload) {
+    InternetDatagram dgram;
+    dgram.header().src = 0x0a000063;
+    dgram.header().dst = dst;
+    dgram.header().ttl = ttl;
+    dgram.payload() = Buffer(string(payload));
+    dgram.header().len = IPv4Header::LENGTH + dgram.payload().size();
+    return dgram;
+}
+
+//! The frames an interface has sent, serialized and sorted
+static vector<string> sent_frames(Router &router, const size_t i) {
+    vector<string> frames;
+    auto &queue = router.interface(i).frames_out();
+    while (not queue.empty()) {
+        frames.push_back(queue.front().serialize().concatenate());
+        queue.pop();
+    }
+    sort(frames.begin(), frames.end());
+    return frames;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // each interface sends the same frames as without threads (though not in the same order across ingresses)
+        for (const size_t threads : {size_t(1), size_t(2), size_t(4), size_t(8)}) {
+            RouterConfig config;
+            config.threads = threads;
+            config.transmit_ring_size = 16;  // 小的环，经常满
+            Router parallel = make_router(config);
+            Router scalar = make_router(RouterConfig{});
+
+            // 192.0.0.0/8里的随机路由，其他地址没有路由
+            for (size_t i = 0; i < 100; i++) {
+                const uint8_t length = 8 + rd() % 17;
+                const uint32_t prefix = 0xc0000000 | (uint32_t(rd()) & 0x00ffffff & (~uint32_t(0) << (32 - length)));
+                const size_t interface_num = rd() % n_interfaces;
+                const Address gateway = Address::from_ipv4_numeric(gateway_ip(interface_num));
+                parallel.add_route(prefix, length, gateway, interface_num);
+                scalar.add_route(prefix, length, gateway, interface_num);
+            }
+
+            for (size_t round = 0; round < 20; round++) {
+                for (size_t i = 0; i < 500; i++) {
+                    const uint32_t dst = (rd() % 8 ? 0xc0000000 : 0xc1000000) | (uint32_t(rd()) & 0x00ffffff);
+                    const string payload = to_string(round) + "/" + to_string(i);
+                    const InternetDatagram dgram = make_datagram(dst, rd() % 8, payload);
+                    const size_t ingress = rd() % n_interfaces;
+                    parallel.interface(ingress).datagrams_out().push(dgram);
+                    scalar.interface(ingress).datagrams_out().push(dgram);
+                }
+                parallel.route();
+                scalar.route();
+
+                for (size_t i = 0; i < n_interfaces; i++) {
+                    test_err_if(not parallel.interface(i).datagrams_out().empty(), "datagrams left unrouted");
+                    test_err_if(sent_frames(parallel, i) != sent_frames(scalar, i),
+                                "interface " + to_string(i) + " sent different frames with " + to_string(threads) +
+                                    " threads");
+                }
+            }
+        }
+
+        // routes change on another thread while route() runs: each datagram goes one way or the other
+        {
+            RouterConfig config;
+            config.threads = 3;
+            Router router = make_router(config);
+            router.add_route(0, 0, Address::from_ipv4_numeric(gateway_ip(0)), 0);
+
+            // add_route()每次都打印DEBUG信息，这里不需要
+            const QuietCerr quiet{};
+            atomic<bool> stop{false};
+            thread updater([&] {
+                for (uint32_t i = 0; not stop.load(); i++) {
+                    const size_t interface_num = 1 + i % (n_interfaces - 1);
+                    const Address gateway = Address::from_ipv4_numeric(gateway_ip(interface_num));
+                    router.add_route(0xc0a80000, 16, gateway, interface_num);
+                    router.remove_route(0xc0a80000, 16);
+                }
+            });
+
+            size_t sent = 0, received = 0;
+            for (size_t round = 0; round < 200; round++) {
+                for (size_t i = 0; i < 50; i++) {
+                    router.interface(i % n_interfaces).datagrams_out().push(make_datagram(0xc0a80101, 64, "x"));
+                    sent++;
+                }
+                router.route();
+                for (size_t i = 0; i < n_interfaces; i++) {
+                    received += sent_frames(router, i).size();
+                }
+            }
+            stop = true;
+            updater.join();
+            test_err_if(sent != received, "datagrams lost while routes changed");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#include "tcp_demux.hh"
+#include "test_err_if.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static TCPFourTuple server_side(const uint16_t client_port) {
+    return {0x0a000001, 80, 0x0a000002, client_port};
+}
+
+static size_t move_segments(TCPDemultiplexer &x, TCPDemultiplexer &y) {
+    size_t count = 0;
+    while (not x.segments_out().empty()) {
+        y.segment_received(x.segments_out().front().first.reversed(), x.segments_out().front().second);
+        x.segments_out().pop();
+        count++;
+    }
+    return count;
+}
+
+int main() {
+    try {
+        TCPConfig cfg;
+
+        // connections are established independently and accepted in order of completion
+        {
+            TCPDemultiplexer client{cfg, 16}, server{cfg, 16};
+            client.connect(server_side(2000).reversed());
+            client.connect(server_side(2001).reversed());
+            move_segments(client, server);
+            test_err_if(server.size() != 2, "server should have two half-open connections");
+            test_err_if(server.accept().has_value(), "accept() returned a half-open connection");
+
+            move_segments(server, client);
+            move_segments(client, server);
+            const auto first = server.accept();
+            const auto second = server.accept();
+            test_err_if(not first.has_value() or not second.has_value(), "accept() failed after handshake");
+            test_err_if(server.accept().has_value(), "accept() returned a connection twice");
+            test_err_if(not(first.value() == server_side(2000)) or not(second.value() == server_side(2001)),
+                        "accept() returned connections out of order");
+            test_err_if(server.pending() != 0, "accepted connections are still pending");
+
+            // data is demultiplexed by 4-tuple
+            client.write(server_side(2001).reversed(), "hello");
+            client.write(server_side(2000).reversed(), "world");
+            move_segments(client, server);
+            test_err_if(server.connection(server_side(2000)).inbound_stream().read(5) != "world",
+                        "wrong data on first connection");
+            test_err_if(server.connection(server_side(2001)).inbound_stream().read(5) != "hello",
+                        "wrong data on second connection");
+        }
+
+        // SYNs beyond the backlog are dropped, and the backlog frees up once a connection is accepted
+        {
+            TCPDemultiplexer client{cfg, 16}, server{cfg, 2};
+            for (uint16_t port = 3000; port < 3003; port++) {
+                client.connect(server_side(port).reversed());
+            }
+            move_segments(client, server);
+            test_err_if(server.size() != 2, "backlog of 2 admitted " + to_string(server.size()) + " connections");
+            test_err_if(server.syns_dropped() != 1, "expected one SYN to be dropped");
+            test_err_if(server.contains(server_side(3002)), "third connection should not exist");
+
+            move_segments(server, client);
+            move_segments(client, server);
+            test_err_if(not server.accept().has_value(), "accept() failed after handshake");
+            test_err_if(server.pending() != 1, "pending count is wrong after accept()");
+
+            // the client retransmits its SYN, which now fits
+            client.tick(cfg.rt_timeout);
+            move_segments(client, server);
+            test_err_if(not server.contains(server_side(3002)), "retransmitted SYN was not admitted");
+        }
+
+        // with SYN cookies, nothing is held until the final ACK of the handshake
+        {
+            TCPDemultiplexer client{cfg, 16}, server{cfg, 16, true};
+            client.connect(server_side(5000).reversed());
+            move_segments(client, server);
+            test_err_if(server.size() != 0, "SYN created a connection in SYN-cookie mode");
+            test_err_if(server.cookies_sent() != 1, "SYN was not answered with a cookie");
+
+            // a forged ACK (wrong cookie) is ignored
+            TCPSegment forged = server.segments_out().front().second;
+            forged.header().syn = false;
+            forged.header().seqno = forged.header().ackno;
+            forged.header().ackno = forged.header().ackno + 12345;
+            server.segment_received(server_side(5001), forged);
+            test_err_if(server.size() != 0, "ACK with an invalid cookie created a connection");
+
+            move_segments(server, client);
+            client.write(server_side(5000).reversed(), "cookie");
+            move_segments(client, server);
+            test_err_if(server.cookies_validated() != 1, "valid cookie was not accepted");
+            const auto id = server.accept();
+            test_err_if(not id.has_value() or not(id.value() == server_side(5000)), "accept() failed after cookie");
+            test_err_if(server.connection(id.value()).inbound_stream().read(6) != "cookie",
+                        "data in the final ACK was lost");
+
+            // a cookie expires after two time slots
+            client.connect(server_side(5002).reversed());
+            move_segments(client, server);
+            server.tick(2 * SYNCookies::SLOT_MS);
+            move_segments(server, client);
+            move_segments(client, server);
+            test_err_if(server.contains(server_side(5002)), "expired cookie was accepted");
+        }
+
+        // segments for unknown connections without a SYN are ignored
+        {
+            TCPDemultiplexer server{cfg, 16};
+            TCPSegment seg;
+            seg.header().ack = true;
+            server.segment_received(server_side(4000), seg);
+            test_err_if(server.size() != 0, "ACK without SYN created a connection");
+            test_err_if(not server.segments_out().empty(), "ACK without SYN produced a reply");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}